@@ -0,0 +1,236 @@
+#include "ByteSource.h"
+#include "FilePath.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace gost;
+
+namespace
+{
+    size_t ReadFromStream(std::istream& stream, unsigned char* buffer, size_t size)
+    {
+        if (!stream.good())
+        {
+            return 0;
+        }
+
+        stream.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(size));
+        return static_cast<size_t>(stream.gcount());
+    }
+}
+
+size_t ByteSource::Next(const unsigned char*& data, unsigned char* scratch, size_t scratchSize)
+{
+    data = scratch;
+    return Read(scratch, scratchSize);
+}
+
+size_t MemoryByteSource::Read(unsigned char* buffer, size_t size)
+{
+    size_t count = std::min(size, m_size - m_offset);
+    if (count > 0)
+    {
+        std::memcpy(buffer, m_data + m_offset, count);
+        m_offset += count;
+    }
+    return count;
+}
+
+size_t MemoryByteSource::Next(const unsigned char*& data, unsigned char*, size_t)
+{
+    data = m_data + m_offset;
+    size_t count = m_size - m_offset;
+    m_offset = m_size;
+    return count;
+}
+
+size_t StreamByteSource::Read(unsigned char* buffer, size_t size)
+{
+    return ReadFromStream(m_stream, buffer, size);
+}
+
+FileByteSource::FileByteSource(const std::wstring& path)
+    : m_file(ToPath(path), std::ios::binary)
+{
+}
+
+bool FileByteSource::Seek(unsigned long long offset)
+{
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    return !m_file.fail();
+}
+
+size_t FileByteSource::Read(unsigned char* buffer, size_t size)
+{
+    return ReadFromStream(m_file, buffer, size);
+}
+
+MappedFileSource::MappedFileSource(const std::wstring& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size{};
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        Close();
+        return;
+    }
+
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+    {
+        Close();
+        return;
+    }
+    m_fileSize = static_cast<unsigned long long>(size.QuadPart);
+#else
+    m_fd = open(ToPath(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0)
+    {
+        return;
+    }
+
+    struct stat info {};
+    if (fstat(m_fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0)
+    {
+        Close();
+        return;
+    }
+    m_fileSize = static_cast<unsigned long long>(info.st_size);
+#endif
+}
+
+MappedFileSource::~MappedFileSource()
+{
+    Close();
+}
+
+void MappedFileSource::Close()
+{
+    UnmapView();
+#ifdef _WIN32
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+bool MappedFileSource::MapView(unsigned long long offset)
+{
+    UnmapView();
+    size_t size = static_cast<size_t>(std::min<unsigned long long>(VIEW_SIZE, m_fileSize - offset));
+
+#ifdef _WIN32
+    void* view = MapViewOfFile(m_mapping, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset & 0xFFFFFFFFu), size);
+    if (!view)
+    {
+        return false;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range{ view, size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, m_fd, static_cast<off_t>(offset));
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    madvise(view, size, MADV_SEQUENTIAL);
+    madvise(view, size, MADV_WILLNEED);
+#endif
+
+    m_view = static_cast<const unsigned char*>(view);
+    m_viewSize = size;
+    m_viewOffset = offset;
+    return true;
+}
+
+void MappedFileSource::UnmapView()
+{
+    if (!m_view)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_view);
+#else
+    munmap(const_cast<unsigned char*>(m_view), m_viewSize);
+#endif
+    m_view = nullptr;
+    m_viewSize = 0;
+}
+
+size_t MappedFileSource::Borrow(const unsigned char*& data, size_t maxSize)
+{
+    if (m_failed || m_position >= m_fileSize)
+    {
+        return 0;
+    }
+
+    if (!m_view || m_position >= m_viewOffset + m_viewSize)
+    {
+        if (!MapView(m_position))
+        {
+            m_failed = true;
+            return 0;
+        }
+    }
+
+    size_t offsetInView = static_cast<size_t>(m_position - m_viewOffset);
+    size_t count = std::min(maxSize, m_viewSize - offsetInView);
+    data = m_view + offsetInView;
+    m_position += count;
+    return count;
+}
+
+size_t MappedFileSource::Read(unsigned char* buffer, size_t size)
+{
+    const unsigned char* data = nullptr;
+    size_t count = Borrow(data, size);
+    if (count > 0)
+    {
+        std::memcpy(buffer, data, count);
+    }
+    return count;
+}
+
+size_t MappedFileSource::Next(const unsigned char*& data, unsigned char*, size_t)
+{
+    return Borrow(data, VIEW_SIZE);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <string>
+
+namespace gost
+{
+    // Pull-based input for streaming hashing: data is read in chunks into a
+    // caller-owned buffer, so nothing holds the whole input in memory.
+    class ByteSource
+    {
+    public:
+        virtual ~ByteSource() = default;
+
+        // Returns the number of bytes read; 0 means end of input or an error.
+        virtual size_t Read(unsigned char* buffer, size_t size) = 0;
+        virtual bool Failed() const { return false; }
+
+        // Returns a view of the next chunk. Sources that already hold their data
+        // in memory point straight into it; the rest copy into scratch.
+        virtual size_t Next(const unsigned char*& data, unsigned char* scratch, size_t scratchSize);
+    };
+
+    class MemoryByteSource : public ByteSource
+    {
+    public:
+        MemoryByteSource(const unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+
+        size_t Read(unsigned char* buffer, size_t size) override;
+        size_t Next(const unsigned char*& data, unsigned char* scratch, size_t scratchSize) override;
+
+    private:
+        const unsigned char* m_data;
+        size_t m_size;
+        size_t m_offset = 0;
+    };
+
+    class StreamByteSource : public ByteSource
+    {
+    public:
+        explicit StreamByteSource(std::istream& stream) : m_stream(stream) {}
+
+        size_t Read(unsigned char* buffer, size_t size) override;
+        bool Failed() const override { return m_stream.bad(); }
+
+    private:
+        std::istream& m_stream;
+    };
+
+    class FileByteSource : public ByteSource
+    {
+    public:
+        explicit FileByteSource(const std::wstring& path);
+
+        bool IsOpen() const { return m_file.is_open(); }
+        // Positions the next Read at an absolute byte offset.
+        bool Seek(unsigned long long offset);
+        size_t Read(unsigned char* buffer, size_t size) override;
+        bool Failed() const override { return m_file.bad(); }
+
+    private:
+        std::ifstream m_file;
+    };
+
+    // Maps a regular file view by view and hands the mapped pages to the hash
+    // without copying. Views are bounded so 32-bit builds can map large files.
+    class MappedFileSource : public ByteSource
+    {
+    public:
+        static constexpr size_t VIEW_SIZE = 64u << 20;
+
+        explicit MappedFileSource(const std::wstring& path);
+        ~MappedFileSource() override;
+
+        MappedFileSource(const MappedFileSource&) = delete;
+        MappedFileSource& operator=(const MappedFileSource&) = delete;
+
+        // False for pipes, devices, empty files and mapping failures; callers
+        // fall back to FileByteSource in that case.
+        bool IsMapped() const { return m_fileSize > 0; }
+        unsigned long long Size() const { return m_fileSize; }
+
+        size_t Read(unsigned char* buffer, size_t size) override;
+        size_t Next(const unsigned char*& data, unsigned char* scratch, size_t scratchSize) override;
+        bool Failed() const override { return m_failed; }
+
+    private:
+        size_t Borrow(const unsigned char*& data, size_t maxSize);
+        bool MapView(unsigned long long offset);
+        void UnmapView();
+        void Close();
+
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        unsigned long long m_fileSize = 0;
+        unsigned long long m_position = 0;
+        unsigned long long m_viewOffset = 0;
+        const unsigned char* m_view = nullptr;
+        size_t m_viewSize = 0;
+        bool m_failed = false;
+    };
+}
@@ -0,0 +1,102 @@
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#if defined(GOST_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(GOST_ARM64)
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+using namespace gost;
+
+namespace
+{
+#if defined(GOST_X86)
+    void CpuId(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+    {
+#if defined(_MSC_VER)
+        int values[4];
+        __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i)
+        {
+            registers[i] = static_cast<uint32_t>(values[i]);
+        }
+#else
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    // XCR0: which register states the OS saves on a context switch.
+    uint64_t ExtendedControlRegister()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        uint32_t low = 0;
+        uint32_t high = 0;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+    }
+#endif
+
+    CpuFeatures Detect()
+    {
+        CpuFeatures features;
+#if defined(GOST_X86)
+        uint32_t registers[4] = {};
+        CpuId(0, 0, registers);
+        const uint32_t maxLeaf = registers[0];
+        if (maxLeaf < 1)
+        {
+            return features;
+        }
+
+        CpuId(1, 0, registers);
+        features.ssse3 = (registers[2] & (1u << 9)) != 0;
+        features.sse41 = (registers[2] & (1u << 19)) != 0;
+        const uint64_t savedStates = (registers[2] & (1u << 27)) != 0 ? ExtendedControlRegister() : 0;
+        const bool osSavesYmm = (savedStates & 0x6) == 0x6;
+        // Opmask and both halves of the 32 ZMM registers as well.
+        const bool osSavesZmm = (savedStates & 0xE6) == 0xE6;
+
+        if (maxLeaf >= 7)
+        {
+            CpuId(7, 0, registers);
+            features.avx2 = osSavesYmm && (registers[1] & (1u << 5)) != 0;
+            features.avx512f = osSavesZmm && (registers[1] & (1u << 16)) != 0;
+            features.bmi2 = (registers[1] & (1u << 8)) != 0;
+            // The SHA extensions work on XMM registers and need SSE4.1 beside them.
+            features.sha1 = features.sse41 && (registers[1] & (1u << 29)) != 0;
+            features.sha256 = features.sha1;
+        }
+#elif defined(GOST_ARM64)
+#if defined(_WIN32)
+        features.sha1 = features.sha256 = IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+#elif defined(__linux__)
+        const unsigned long hwcaps = getauxval(AT_HWCAP);
+        features.sha1 = (hwcaps & (1ul << 5)) != 0;
+        features.sha256 = (hwcaps & (1ul << 6)) != 0;
+#elif defined(__APPLE__)
+        // Every Apple ARM64 CPU has them.
+        features.sha1 = features.sha256 = true;
+#endif
+#endif
+        return features;
+    }
+}
+
+const CpuFeatures& CpuFeatures::Get()
+{
+    static const CpuFeatures features = Detect();
+    return features;
+}
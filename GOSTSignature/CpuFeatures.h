@@ -0,0 +1,47 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GOST_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define GOST_ARM64 1
+#endif
+
+// Lets one translation unit carry kernels for instruction sets beyond the
+// build baseline; MSVC accepts the intrinsics without it.
+#if defined(GOST_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GOST_TARGET(features) __attribute__((target(features)))
+#else
+#define GOST_TARGET(features)
+#endif
+
+// The same for the ARMv8 SHA-1/SHA-256 instructions, which GCC and Clang
+// spell differently.
+#if defined(GOST_ARM64) && defined(__clang__)
+#define GOST_TARGET_ARM_CRYPTO __attribute__((target("crypto")))
+#elif defined(GOST_ARM64) && defined(__GNUC__)
+#define GOST_TARGET_ARM_CRYPTO __attribute__((target("+crypto")))
+#else
+#define GOST_TARGET_ARM_CRYPTO
+#endif
+
+namespace gost
+{
+    // Instruction set extensions that this CPU and OS both support, detected
+    // once. Kernels check these before taking a vectorized path.
+    struct CpuFeatures
+    {
+        bool ssse3 = false;
+        bool sse41 = false;
+        bool avx2 = false;
+        bool bmi2 = false;
+        bool avx512f = false;
+        // SHA-1 and SHA-256 instructions: the x86 SHA extensions, or the ARMv8
+        // crypto extension.
+        bool sha1 = false;
+        bool sha256 = false;
+
+        static const CpuFeatures& Get();
+    };
+}
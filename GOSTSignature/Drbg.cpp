@@ -0,0 +1,296 @@
+#include "Drbg.h"
+#include "Streebog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <random>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#else
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <sys/random.h>
+#endif
+#endif
+
+using namespace gost;
+
+namespace
+{
+    // Bumped in the child after fork() so every generator inherited from the
+    // parent reseeds before its next output.
+    std::atomic<unsigned> g_forkGeneration{ 0 };
+
+    void SecureZero(void* data, size_t size)
+    {
+        volatile unsigned char* bytes = static_cast<volatile unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            bytes[i] = 0;
+        }
+    }
+
+    inline uint32_t Rotl(uint32_t x, int n)
+    {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    inline void QuarterRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+    {
+        a += b; d ^= a; d = Rotl(d, 16);
+        c += d; b ^= c; b = Rotl(b, 12);
+        a += b; d ^= a; d = Rotl(d, 8);
+        c += d; b ^= c; b = Rotl(b, 7);
+    }
+
+    // One ChaCha20 block with a 64-bit block counter and a zero nonce.
+    void ChaChaBlock(const uint32_t key[8], uint64_t counter, unsigned char* output)
+    {
+        const uint32_t input[16] = {
+            0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+            key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+            static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0, 0
+        };
+
+        uint32_t x[16];
+        std::memcpy(x, input, sizeof(x));
+        for (int round = 0; round < 10; ++round)
+        {
+            QuarterRound(x[0], x[4], x[8], x[12]);
+            QuarterRound(x[1], x[5], x[9], x[13]);
+            QuarterRound(x[2], x[6], x[10], x[14]);
+            QuarterRound(x[3], x[7], x[11], x[15]);
+            QuarterRound(x[0], x[5], x[10], x[15]);
+            QuarterRound(x[1], x[6], x[11], x[12]);
+            QuarterRound(x[2], x[7], x[8], x[13]);
+            QuarterRound(x[3], x[4], x[9], x[14]);
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t word = x[i] + input[i];
+            output[4 * i] = static_cast<unsigned char>(word);
+            output[4 * i + 1] = static_cast<unsigned char>(word >> 8);
+            output[4 * i + 2] = static_cast<unsigned char>(word >> 16);
+            output[4 * i + 3] = static_cast<unsigned char>(word >> 24);
+        }
+        SecureZero(x, sizeof(x));
+    }
+
+    uint32_t LoadLittleEndian(const unsigned char* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    struct HmacPart
+    {
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // HMAC-Streebog over the concatenation of parts. The key is never longer
+    // than the digest, so it always fits one block without hashing.
+    void Hmac(size_t digestSize, const unsigned char* key, size_t keySize, std::initializer_list<HmacPart> parts, unsigned char* output)
+    {
+        unsigned char pad[Streebog::BLOCK_SIZE];
+        unsigned char inner[HmacDrbg::MAX_DIGEST_SIZE];
+
+        std::memset(pad, 0x36, sizeof(pad));
+        for (size_t i = 0; i < keySize; ++i)
+        {
+            pad[i] ^= key[i];
+        }
+        Streebog streebog(digestSize);
+        streebog.Update(pad, sizeof(pad));
+        for (const HmacPart& part : parts)
+        {
+            if (part.size != 0)
+            {
+                streebog.Update(part.data, part.size);
+            }
+        }
+        streebog.Finish(inner);
+
+        for (size_t i = 0; i < sizeof(pad); ++i)
+        {
+            pad[i] ^= 0x36 ^ 0x5C;
+        }
+        streebog.Update(pad, sizeof(pad));
+        streebog.Update(inner, digestSize);
+        streebog.Finish(output);
+
+        SecureZero(pad, sizeof(pad));
+        SecureZero(inner, sizeof(inner));
+    }
+}
+
+ChaChaDrbg::ChaChaDrbg()
+{
+#ifndef _WIN32
+    static std::once_flag registered;
+    std::call_once(registered, []
+    {
+        pthread_atfork(nullptr, nullptr, [] { g_forkGeneration.fetch_add(1, std::memory_order_relaxed); });
+    });
+#endif
+    m_forkGeneration = g_forkGeneration.load(std::memory_order_relaxed);
+    Reseed();
+}
+
+ChaChaDrbg::~ChaChaDrbg()
+{
+    SecureZero(m_key, sizeof(m_key));
+    SecureZero(m_buffer, sizeof(m_buffer));
+}
+
+ChaChaDrbg& ChaChaDrbg::ForThread()
+{
+    thread_local ChaChaDrbg drbg;
+    return drbg;
+}
+
+bool ChaChaDrbg::SystemRandom(unsigned char* output, size_t size)
+{
+#ifdef _WIN32
+    if (BCryptGenRandom(nullptr, output, static_cast<ULONG>(size), BCRYPT_USE_SYSTEM_PREFERRED_RNG) == 0)
+    {
+        return true;
+    }
+#else
+    // getentropy() serves at most 256 bytes per call.
+    size_t done = 0;
+    while (done < size && getentropy(output + done, std::min<size_t>(size - done, 256)) == 0)
+    {
+        done += std::min<size_t>(size - done, 256);
+    }
+    if (done == size)
+    {
+        return true;
+    }
+#endif
+
+    try
+    {
+        std::random_device device;
+        for (size_t i = 0; i < size; ++i)
+        {
+            output[i] = static_cast<unsigned char>(device());
+        }
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+void ChaChaDrbg::Reseed()
+{
+    unsigned char seed[KEY_SIZE];
+    if (!SystemRandom(seed, sizeof(seed)))
+    {
+        // Nonces from an unseeded generator would give away the private key.
+        std::abort();
+    }
+    for (int i = 0; i < 8; ++i)
+    {
+        m_key[i] ^= LoadLittleEndian(seed + 4 * i);
+    }
+    SecureZero(seed, sizeof(seed));
+
+    // Output buffered under the old key is dropped.
+    SecureZero(m_buffer, sizeof(m_buffer));
+    m_offset = sizeof(m_buffer);
+    m_sinceReseed = 0;
+}
+
+void ChaChaDrbg::Refill()
+{
+    for (size_t block = 0; block < BUFFER_BLOCKS; ++block)
+    {
+        ChaChaBlock(m_key, m_counter++, m_buffer + block * BLOCK_SIZE);
+    }
+
+    // Fast key erasure: the old key cannot be recovered from the new state.
+    for (int i = 0; i < 8; ++i)
+    {
+        m_key[i] = LoadLittleEndian(m_buffer + 4 * i);
+    }
+    SecureZero(m_buffer, KEY_SIZE);
+    m_offset = KEY_SIZE;
+}
+
+void ChaChaDrbg::Generate(unsigned char* output, size_t size)
+{
+    unsigned forkGeneration = g_forkGeneration.load(std::memory_order_relaxed);
+    if (forkGeneration != m_forkGeneration || m_sinceReseed >= RESEED_INTERVAL)
+    {
+        m_forkGeneration = forkGeneration;
+        Reseed();
+    }
+    m_sinceReseed += size;
+
+    while (size > 0)
+    {
+        if (m_offset == sizeof(m_buffer))
+        {
+            Refill();
+        }
+        size_t count = std::min(size, sizeof(m_buffer) - m_offset);
+        std::memcpy(output, m_buffer + m_offset, count);
+        SecureZero(m_buffer + m_offset, count);
+        m_offset += count;
+        output += count;
+        size -= count;
+    }
+}
+
+HmacDrbg::HmacDrbg(size_t digestSize, const unsigned char* privateKey, size_t privateKeySize, const unsigned char* hash, size_t hashSize)
+    : m_digestSize(digestSize == 32 ? 32 : 64)
+{
+    std::memset(m_v, 0x01, m_digestSize);
+    Update(0x00, privateKey, privateKeySize, hash, hashSize);
+    Update(0x01, privateKey, privateKeySize, hash, hashSize);
+}
+
+HmacDrbg::~HmacDrbg()
+{
+    SecureZero(m_k, sizeof(m_k));
+    SecureZero(m_v, sizeof(m_v));
+}
+
+void HmacDrbg::Update(unsigned char separator, const unsigned char* privateKey, size_t privateKeySize, const unsigned char* hash, size_t hashSize)
+{
+    Hmac(m_digestSize, m_k, m_digestSize, { { m_v, m_digestSize }, { &separator, 1 }, { privateKey, privateKeySize }, { hash, hashSize } }, m_k);
+    Hmac(m_digestSize, m_k, m_digestSize, { { m_v, m_digestSize } }, m_v);
+}
+
+void HmacDrbg::Generate(unsigned char* output, size_t size)
+{
+    if (m_started)
+    {
+        Update(0x00, nullptr, 0, nullptr, 0);
+    }
+    m_started = true;
+
+    while (size > 0)
+    {
+        Hmac(m_digestSize, m_k, m_digestSize, { { m_v, m_digestSize } }, m_v);
+        size_t count = std::min(size, m_digestSize);
+        std::memcpy(output, m_v, count);
+        output += count;
+        size -= count;
+    }
+}
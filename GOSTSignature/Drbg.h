@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gost
+{
+    // ChaCha20 deterministic random bit generator with fast key erasure: each
+    // refill produces BUFFER_BLOCKS blocks, the first 32 bytes become the next
+    // key and the rest is handed out, wiped as it goes. The key is seeded from
+    // the OS generator and mixed with fresh OS entropy every RESEED_INTERVAL
+    // bytes and in a child after fork().
+    class ChaChaDrbg
+    {
+    public:
+        static constexpr size_t KEY_SIZE = 32;
+        static constexpr size_t BLOCK_SIZE = 64;
+        static constexpr size_t BUFFER_BLOCKS = 16;
+        static constexpr unsigned long long RESEED_INTERVAL = 1ull << 20;
+
+        ChaChaDrbg();
+        ~ChaChaDrbg();
+
+        ChaChaDrbg(const ChaChaDrbg&) = delete;
+        ChaChaDrbg& operator=(const ChaChaDrbg&) = delete;
+
+        void Generate(unsigned char* output, size_t size);
+
+        // The calling thread's generator; no locking and, between reseeds, no
+        // system calls.
+        static ChaChaDrbg& ForThread();
+
+        // size bytes straight from the OS generator; false if it failed.
+        static bool SystemRandom(unsigned char* output, size_t size);
+
+    private:
+        void Reseed();
+        void Refill();
+
+        uint32_t m_key[8] = {};
+        uint64_t m_counter = 0;
+        unsigned char m_buffer[BUFFER_BLOCKS * BLOCK_SIZE] = {};
+        size_t m_offset = sizeof(m_buffer);
+        unsigned long long m_sinceReseed = 0;
+        unsigned m_forkGeneration = 0;
+    };
+
+    // RFC 6979 section 3.2 generator over HMAC-Streebog, keyed with a private
+    // key and a message digest: the same pair always yields the same output
+    // and no system entropy is involved. Every Generate call after the first
+    // is the RFC's "try again" step, so a signer that rejects a candidate
+    // nonce simply asks for the next one.
+    class HmacDrbg
+    {
+    public:
+        static constexpr size_t MAX_DIGEST_SIZE = 64;
+
+        // digestSize selects Streebog-256 (32) or Streebog-512 (64). Both
+        // inputs are big-endian octet strings.
+        HmacDrbg(size_t digestSize, const unsigned char* privateKey, size_t privateKeySize, const unsigned char* hash, size_t hashSize);
+        ~HmacDrbg();
+
+        HmacDrbg(const HmacDrbg&) = delete;
+        HmacDrbg& operator=(const HmacDrbg&) = delete;
+
+        void Generate(unsigned char* output, size_t size);
+
+    private:
+        // m_k = HMAC(m_k, m_v || separator || privateKey || hash), then m_v = HMAC(m_k, m_v).
+        void Update(unsigned char separator, const unsigned char* privateKey, size_t privateKeySize, const unsigned char* hash, size_t hashSize);
+
+        size_t m_digestSize;
+        unsigned char m_k[MAX_DIGEST_SIZE] = {};
+        unsigned char m_v[MAX_DIGEST_SIZE] = {};
+        bool m_started = false;
+    };
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace gost
+{
+#ifndef _WIN32
+    // POSIX file names are bytes in no particular encoding. Valid UTF-8
+    // decodes as usual and any other byte b becomes the lone surrogate
+    // U+DC00 + b, which valid UTF-8 never decodes to, so every name converts
+    // without failing and converts back to the same bytes.
+    inline std::wstring NativeToWide(const std::string& native)
+    {
+        std::wstring output;
+        output.reserve(native.size());
+        for (size_t i = 0; i < native.size();)
+        {
+            const unsigned char lead = static_cast<unsigned char>(native[i]);
+            const size_t length = lead < 0x80 ? 1 : lead >= 0xC2 && lead < 0xE0 ? 2 : lead >= 0xE0 && lead < 0xF0 ? 3 : lead >= 0xF0 && lead < 0xF5 ? 4 : 0;
+            char32_t code = length == 1 ? lead : lead & (0x7F >> length);
+            bool valid = length != 0 && i + length <= native.size();
+            for (size_t j = 1; valid && j < length; ++j)
+            {
+                const unsigned char next = static_cast<unsigned char>(native[i + j]);
+                valid = (next & 0xC0) == 0x80;
+                code = (code << 6) | (next & 0x3F);
+            }
+            // Overlong forms, surrogates and code points past U+10FFFF.
+            valid = valid && !(length == 3 && (code < 0x800 || (code >= 0xD800 && code < 0xE000)))
+                && !(length == 4 && (code < 0x10000 || code > 0x10FFFF));
+
+            if (!valid)
+            {
+                output.push_back(static_cast<wchar_t>(0xDC00 + lead));
+                ++i;
+                continue;
+            }
+            output.push_back(static_cast<wchar_t>(code));
+            i += length;
+        }
+        return output;
+    }
+
+    inline std::string WideToNative(const std::wstring& path)
+    {
+        std::string output;
+        output.reserve(path.size());
+        for (wchar_t c : path)
+        {
+            const char32_t code = static_cast<char32_t>(c);
+            if (code < 0x80)
+            {
+                output.push_back(static_cast<char>(code));
+            }
+            else if (code >= 0xDC80 && code < 0xDD00)
+            {
+                output.push_back(static_cast<char>(code - 0xDC00));
+            }
+            else if (code < 0x800)
+            {
+                output.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else if (code < 0x10000)
+            {
+                output.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else
+            {
+                output.push_back(static_cast<char>(0xF0 | ((code >> 18) & 0x07)));
+                output.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+        }
+        return output;
+    }
+#endif
+
+    // Conversions between the wide paths used throughout the API and
+    // std::filesystem::path. Outside Windows the path keeps its native bytes:
+    // libstdc++ converts wchar_t with the "C" locale, and its UTF-32
+    // conversion throws on names that are not valid UTF-8.
+    inline std::filesystem::path ToPath(const std::wstring& path)
+    {
+#ifdef _WIN32
+        return std::filesystem::path(path);
+#else
+        return std::filesystem::path(WideToNative(path));
+#endif
+    }
+
+    inline std::wstring FromPath(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        return path.wstring();
+#else
+        return NativeToWide(path.native());
+#endif
+    }
+}
@@ -1,18 +1,20 @@
 #include "GOSTSignature.h"
+#include "Drbg.h"
+#include "GostCurve.h"
+#include "KeyStore.h"
 
 #include <algorithm>
-#include <bcrypt.h>
-#include <chrono>
 #include <commctrl.h>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <optional>
 #include <shellapi.h>
 #include <shobjidl.h>
 #include <string>
 #include <vector>
 
 #pragma execution_character_set("utf-8")
-#pragma comment(lib, "bcrypt.lib")
 #pragma comment(lib, "comctl32.lib")
 
 using namespace gost;
@@ -24,38 +26,26 @@ namespace
     const wchar_t CREATE_USER_CLASS[] = L"GOSTCreateUserWindow";
     const wchar_t SELECT_USER_CLASS[] = L"GOSTSelectUserWindow";
     const wchar_t KEY_WINDOW_CLASS[] = L"GOSTKeyWindow";
+    const wchar_t STORE_FILE_NAME[] = L"users.gks";
+
+    // Posted by the signing thread: wParam is the percentage hashed, or for
+    // completion lParam owns a heap-allocated GostSignature.
+    const UINT WM_SIGN_PROGRESS = WM_APP + 1;
+    const UINT WM_SIGN_COMPLETE = WM_APP + 2;
 
     HWND g_signatureWindow = nullptr;
-    std::vector<std::wstring> g_users = { L"Администратор" };
+    // Users and their keys, in a file next to the executable.
+    std::unique_ptr<KeyStore> g_store;
     std::wstring g_activeUser = L"Не выбран";
     std::wstring g_savedPrivateKey;
     std::wstring g_savedPublicKey;
+    // Index into DefaultParameterSets of the set the session key belongs to.
+    size_t g_savedParameterSet = 0;
     HINSTANCE g_hInstance = nullptr;
-
-    std::vector<unsigned char> HexToBytes(const std::wstring& hex)
-    {
-        std::vector<unsigned char> bytes;
-        bytes.reserve(hex.size() / 2);
-        for (size_t i = 0; i + 1 < hex.size(); i += 2)
-        {
-            std::wstring token = hex.substr(i, 2);
-            unsigned int value = 0;
-            swscanf_s(token.c_str(), L"%x", &value);
-            bytes.push_back(static_cast<unsigned char>(value));
-        }
-        return bytes;
-    }
-
-    std::vector<unsigned char> XORMix(const std::vector<unsigned char>& lhs, const std::vector<unsigned char>& rhs)
-    {
-        std::vector<unsigned char> output(lhs.size());
-        for (size_t i = 0; i < lhs.size(); ++i)
-        {
-            unsigned char r = i < rhs.size() ? rhs[i] : 0;
-            output[i] = lhs[i] ^ r;
-        }
-        return output;
-    }
+    // Set while a signature is being computed in the background.
+    std::optional<CancellationToken> g_signing;
+    // Last signature produced in this window, for its signing time.
+    GostSignature g_lastSignature;
 
     void AddLabel(HWND hwnd, int x, int y, int w, int h, const wchar_t* text)
     {
@@ -120,12 +110,48 @@ namespace
         }
     }
 
+    std::wstring StorePath()
+    {
+        wchar_t buffer[MAX_PATH]{};
+        DWORD length = GetModuleFileNameW(nullptr, buffer, MAX_PATH);
+        if (length == 0 || length == MAX_PATH)
+        {
+            return STORE_FILE_NAME;
+        }
+        return (std::filesystem::path(buffer).parent_path() / STORE_FILE_NAME).wstring();
+    }
+
+    // The public key is always computed from the private one, so the store
+    // and the verify field only ever see pairs that belong together.
+    bool DerivePublicKey(size_t parameterSet, const std::wstring& privateKeyHex, std::wstring& publicKeyHex, std::wstring& error)
+    {
+        auto key = SigningKey::Create(GostSigner::DefaultParameterSets()[parameterSet].name, privateKeyHex, error);
+        if (!key)
+        {
+            return false;
+        }
+        publicKeyHex = FormatHex(key->PublicKey());
+        return true;
+    }
+
+    // The active user's newest key becomes the session key; a user without
+    // a valid key starts with empty fields.
+    void LoadActiveUserKey()
+    {
+        auto key = g_store->LatestKey(g_activeUser);
+        auto parameterSet = key ? StoredKeyParameterSet(*key) : std::nullopt;
+        g_savedPrivateKey = parameterSet ? FormatHex(key->privateKey) : std::wstring();
+        g_savedPublicKey = parameterSet ? FormatHex(key->publicKey) : std::wstring();
+        g_savedParameterSet = parameterSet.value_or(0);
+    }
+
     void UpdateActiveUserLabel(HWND hwnd)
     {
         SetWindowTextString(hwnd, IDC_ACTIVE_USER, g_activeUser);
         if (!g_savedPrivateKey.empty())
         {
             SetWindowTextString(hwnd, IDC_PRIVATE_KEY, g_savedPrivateKey);
+            SendMessageW(GetDlgItem(hwnd, IDC_PARAM_SET), CB_SETCURSEL, g_savedParameterSet, 0);
         }
     }
 
@@ -133,7 +159,7 @@ namespace
     {
         HWND list = GetDlgItem(hwnd, controlId);
         SendMessageW(list, LB_RESETCONTENT, 0, 0);
-        for (const auto& user : g_users)
+        for (const auto& user : g_store->Users())
         {
             SendMessageW(list, LB_ADDSTRING, 0, reinterpret_cast<LPARAM>(user.c_str()));
         }
@@ -143,6 +169,34 @@ namespace
     {
         SetWindowTextString(hwnd, IDC_KEY_PRIVATE, g_savedPrivateKey);
         SetWindowTextString(hwnd, IDC_KEY_PUBLIC, g_savedPublicKey);
+        SendMessageW(GetDlgItem(hwnd, IDC_KEY_PARAM_SET), CB_SETCURSEL, g_savedParameterSet, 0);
+    }
+
+    void SyncSignatureWindowKeys()
+    {
+        if (g_signatureWindow)
+        {
+            SetWindowTextString(g_signatureWindow, IDC_PRIVATE_KEY, g_savedPrivateKey);
+            SetWindowTextString(g_signatureWindow, IDC_PUBLIC_KEY_BOX, g_savedPublicKey);
+            if (!g_savedPrivateKey.empty())
+            {
+                SendMessageW(GetDlgItem(g_signatureWindow, IDC_PARAM_SET), CB_SETCURSEL, g_savedParameterSet, 0);
+            }
+        }
+    }
+
+    void RefreshKeyList(HWND hwnd)
+    {
+        HWND list = GetDlgItem(hwnd, IDC_LIST_KEYS);
+        SendMessageW(list, LB_RESETCONTENT, 0, 0);
+        auto keys = g_store->Keys(g_activeUser);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            std::wstring publicKey = FormatHex(keys[i].publicKey);
+            std::wstring text = L"Ключ " + std::to_wstring(i + 1) + L": "
+                + (publicKey.size() > 32 ? publicKey.substr(0, 32) + L"..." : publicKey);
+            SendMessageW(list, LB_ADDSTRING, 0, reinterpret_cast<LPARAM>(text.c_str()));
+        }
     }
 
     void SignOnCreate(HWND hwnd)
@@ -171,20 +225,23 @@ namespace
         }
         SendMessageW(comboHash, CB_SETCURSEL, 0, 0);
 
-        AddButton(hwnd, IDC_RANDOM_CHECK, 20, 140, 200, 20, L"Усиленная случайность", BS_AUTOCHECKBOX);
-        AddButton(hwnd, IDC_SETTINGS_BUTTON, 240, 136, 140, 24, L"Доп. настройки");
+        AddButton(hwnd, IDC_SETTINGS_BUTTON, 20, 136, 140, 24, L"Доп. настройки");
+        AddButton(hwnd, IDC_DETERMINISTIC_CHECK, 180, 140, 210, 20, L"Детерминированный nonce", BS_AUTOCHECKBOX);
+        AddButton(hwnd, IDC_TREE_CHECK, 400, 140, 240, 20, L"Дерево хешей (параллельно)", BS_AUTOCHECKBOX);
 
         AddLabel(hwnd, 20, 180, 140, 20, L"Публичный ключ:");
-        AddEdit(hwnd, IDC_PUBLIC_KEY_BOX, 20, 200, 780, 24, ES_READONLY);
+        AddEdit(hwnd, IDC_PUBLIC_KEY_BOX, 20, 200, 780, 24);
 
         AddLabel(hwnd, 20, 230, 120, 20, L"Подпись (hex):");
-        HWND signatureBox = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", nullptr, WS_CHILD | WS_VISIBLE | ES_MULTILINE | WS_VSCROLL | ES_AUTOVSCROLL | ES_READONLY,
+        HWND signatureBox = CreateWindowExW(WS_EX_CLIENTEDGE, L"EDIT", nullptr, WS_CHILD | WS_VISIBLE | ES_MULTILINE | WS_VSCROLL | ES_AUTOVSCROLL,
             20, 250, 780, 140, hwnd, reinterpret_cast<HMENU>(IDC_SIGNATURE_BOX), nullptr, nullptr);
         SendMessageW(signatureBox, EM_SETLIMITTEXT, 0, 0);
 
         AddLabel(hwnd, 20, 400, 120, 20, L"Статус:");
-        AddEdit(hwnd, IDC_STATUS_TEXT, 20, 420, 520, 24, ES_READONLY);
-        AddButton(hwnd, IDC_SAVE_SIGNATURE, 560, 418, 240, 26, L"Сохранить подпись");
+        AddEdit(hwnd, IDC_STATUS_TEXT, 20, 420, 380, 24, ES_READONLY);
+        AddButton(hwnd, IDC_VERIFY_BUTTON, 410, 418, 140, 26, L"Проверить");
+        AddButton(hwnd, IDC_SAVE_SIGNATURE, 560, 418, 115, 26, L"Сохранить");
+        AddButton(hwnd, IDC_LOAD_SIGNATURE, 685, 418, 115, 26, L"Открыть");
         AddLabel(hwnd, 560, 20, 240, 20, L"Текущий пользователь:");
         AddEdit(hwnd, IDC_ACTIVE_USER, 560, 40, 240, 24, ES_READONLY);
         UpdateActiveUserLabel(hwnd);
@@ -192,6 +249,13 @@ namespace
 
     void UpdateSignature(HWND hwnd)
     {
+        if (g_signing)
+        {
+            g_signing->Cancel();
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Отмена...");
+            return;
+        }
+
         std::wstring path = GetWindowTextString(hwnd, IDC_FILEPATH_EDIT);
         std::wstring privKey = GetWindowTextString(hwnd, IDC_PRIVATE_KEY);
 
@@ -209,71 +273,232 @@ namespace
         auto parameters = GostSigner::DefaultParameterSets()[paramIndex];
         auto hash = GostSigner::SupportedHashes()[hashIndex];
 
-        GostSigner signer;
-        bool strongRandom = SendMessageW(GetDlgItem(hwnd, IDC_RANDOM_CHECK), BM_GETCHECK, 0, 0) == BST_CHECKED;
+        AsyncSignOptions options;
+        options.treeHash = SendMessageW(GetDlgItem(hwnd, IDC_TREE_CHECK), BM_GETCHECK, 0, 0) == BST_CHECKED;
+        if (SendMessageW(GetDlgItem(hwnd, IDC_DETERMINISTIC_CHECK), BM_GETCHECK, 0, 0) == BST_CHECKED)
+        {
+            options.nonceMode = NonceMode::Deterministic;
+        }
+        options.onProgress = [hwnd, lastPercent = -1](unsigned long long hashed, unsigned long long total) mutable
+        {
+            int percent = total != 0 ? static_cast<int>(std::min<unsigned long long>(100, hashed * 100 / total)) : 0;
+            if (percent != lastPercent)
+            {
+                lastPercent = percent;
+                PostMessageW(hwnd, WM_SIGN_PROGRESS, static_cast<WPARAM>(percent), 0);
+            }
+        };
+        options.onComplete = [hwnd](const GostSignature& signature)
+        {
+            auto result = new GostSignature(signature);
+            if (!PostMessageW(hwnd, WM_SIGN_COMPLETE, 0, reinterpret_cast<LPARAM>(result)))
+            {
+                delete result;
+            }
+        };
 
-        auto signature = signer.SignFile(path, parameters, privKey, hash, strongRandom);
-        SetWindowTextString(hwnd, IDC_SIGNATURE_BOX, signature.signatureHex);
-        SetWindowTextString(hwnd, IDC_PUBLIC_KEY_BOX, signature.publicKeyHex);
-        SetWindowTextString(hwnd, IDC_STATUS_TEXT, signature.statusMessage);
+        g_signing = options.cancellation;
+        SetWindowTextString(hwnd, IDC_SIGN_BUTTON, L"Отмена");
+        SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Хеширование: 0%");
+        GostSigner().SignFileAsync(path, parameters, privKey, hash, std::move(options));
     }
 
-    void SaveSignature(HWND hwnd)
+    void SignProgress(HWND hwnd, WPARAM percent)
     {
-        std::wstring signature = GetWindowTextString(hwnd, IDC_SIGNATURE_BOX);
-        if (signature.empty())
+        if (g_signing && !g_signing->IsCancelled())
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Хеширование: " + std::to_wstring(percent) + L"%");
+        }
+    }
+
+    void SignComplete(HWND hwnd, LPARAM lParam)
+    {
+        std::unique_ptr<GostSignature> signature(reinterpret_cast<GostSignature*>(lParam));
+        g_signing.reset();
+        SetWindowTextString(hwnd, IDC_SIGN_BUTTON, L"Подписать");
+        if (!signature->signatureHex.empty())
+        {
+            g_lastSignature = *signature;
+            SetWindowTextString(hwnd, IDC_SIGNATURE_BOX, signature->signatureHex);
+            SetWindowTextString(hwnd, IDC_PUBLIC_KEY_BOX, signature->publicKeyHex);
+        }
+        SetWindowTextString(hwnd, IDC_STATUS_TEXT, signature->statusMessage);
+    }
+
+    // Parameter set, hash, tree mode and signature as currently shown.
+    std::optional<GostSignature> ReadSignatureFields(HWND hwnd)
+    {
+        HWND comboParams = GetDlgItem(hwnd, IDC_PARAM_SET);
+        int paramIndex = static_cast<int>(SendMessageW(comboParams, CB_GETCURSEL, 0, 0));
+        HWND comboHash = GetDlgItem(hwnd, IDC_HASH_COMBO);
+        int hashIndex = static_cast<int>(SendMessageW(comboHash, CB_GETCURSEL, 0, 0));
+
+        if (paramIndex < 0 || hashIndex < 0)
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Выберите набор параметров и хеш");
+            return std::nullopt;
+        }
+
+        GostSignature signature{};
+        signature.parameterSet = GostSigner::DefaultParameterSets()[paramIndex].name;
+        signature.hashAlgorithm = GostSigner::SupportedHashes()[hashIndex];
+        signature.signatureHex = GetWindowTextString(hwnd, IDC_SIGNATURE_BOX);
+        if (SendMessageW(GetDlgItem(hwnd, IDC_TREE_CHECK), BM_GETCHECK, 0, 0) == BST_CHECKED)
+        {
+            signature.treeChunkSize = TreeHashOptions::DEFAULT_CHUNK_SIZE;
+            signature.treeLayout = MerkleTree::LAYOUT;
+        }
+        return signature;
+    }
+
+    void VerifySignature(HWND hwnd)
+    {
+        auto signature = ReadSignatureFields(hwnd);
+        if (!signature)
         {
-            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Подпись отсутствует");
             return;
         }
 
-        IFileSaveDialog* pSave = nullptr;
+        GostSigner signer;
+        std::wstring path = GetWindowTextString(hwnd, IDC_FILEPATH_EDIT);
+        std::wstring publicKey = GetWindowTextString(hwnd, IDC_PUBLIC_KEY_BOX);
+        if (signer.VerifyFile(path, *signature, publicKey, FileInputMode::Mapped))
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Подпись верна");
+        }
+        else
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, signer.GetLastError());
+        }
+    }
+
+    // Save or open dialog for signature containers; nullopt if cancelled.
+    std::optional<std::wstring> PickSignatureFile(HWND hwnd, bool save)
+    {
+        std::optional<std::wstring> result;
         HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
         if (SUCCEEDED(hr))
         {
-            hr = CoCreateInstance(CLSID_FileSaveDialog, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&pSave));
+            IFileDialog* pDialog = nullptr;
+            hr = CoCreateInstance(save ? CLSID_FileSaveDialog : CLSID_FileOpenDialog, nullptr, CLSCTX_ALL, IID_PPV_ARGS(&pDialog));
             if (SUCCEEDED(hr))
             {
-                COMDLG_FILTERSPEC filter[] = { { L"Подпись (*.sig)", L"*.sig" } };
-                pSave->SetFileTypes(1, filter);
-                pSave->SetFileName(L"signature.sig");
+                COMDLG_FILTERSPEC filter[] = { { L"Подпись (*.gsig)", L"*.gsig" } };
+                pDialog->SetFileTypes(1, filter);
+                pDialog->SetDefaultExtension(L"gsig");
+                if (save)
+                {
+                    pDialog->SetFileName(L"signature.gsig");
+                }
 
-                if (SUCCEEDED(pSave->Show(hwnd)))
+                if (SUCCEEDED(pDialog->Show(hwnd)))
                 {
                     IShellItem* pItem = nullptr;
-                    if (SUCCEEDED(pSave->GetResult(&pItem)))
+                    if (SUCCEEDED(pDialog->GetResult(&pItem)))
                     {
                         PWSTR pszFilePath = nullptr;
                         if (SUCCEEDED(pItem->GetDisplayName(SIGDN_FILESYSPATH, &pszFilePath)))
                         {
-                            std::filesystem::path filePath{ pszFilePath };
-                            std::ofstream out(filePath, std::ios::out | std::ios::binary);
-                            if (out)
-                            {
-                                auto utf8Signature = gost::ToNarrow(signature);
-                                out.write(utf8Signature.data(), static_cast<std::streamsize>(utf8Signature.size()));
-                                SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Подпись сохранена");
-                            }
-                            else
-                            {
-                                SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Не удалось сохранить подпись");
-                            }
-                            out.close();
+                            result = pszFilePath;
                             CoTaskMemFree(pszFilePath);
                         }
                         pItem->Release();
                     }
                 }
-                pSave->Release();
+                pDialog->Release();
             }
             CoUninitialize();
         }
+        return result;
+    }
+
+    void SaveSignature(HWND hwnd)
+    {
+        auto signature = ReadSignatureFields(hwnd);
+        if (!signature)
+        {
+            return;
+        }
+        if (signature->signatureHex.empty())
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Подпись отсутствует");
+            return;
+        }
+
+        signature->publicKeyHex = GetWindowTextString(hwnd, IDC_PUBLIC_KEY_BOX);
+        if (signature->signatureHex == g_lastSignature.signatureHex)
+        {
+            signature->signedAt = g_lastSignature.signedAt;
+        }
+        std::vector<unsigned char> container = EncodeSignature(*signature);
+        if (container.empty())
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Подпись или ключ не соответствуют параметрам");
+            return;
+        }
+
+        auto path = PickSignatureFile(hwnd, true);
+        if (!path)
+        {
+            return;
+        }
+
+        std::ofstream out(std::filesystem::path(*path), std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(container.data()), static_cast<std::streamsize>(container.size()));
+        SetWindowTextString(hwnd, IDC_STATUS_TEXT, out ? L"Подпись сохранена" : L"Не удалось сохранить подпись");
+    }
+
+    void LoadSignature(HWND hwnd)
+    {
+        auto path = PickSignatureFile(hwnd, false);
+        if (!path)
+        {
+            return;
+        }
+
+        std::ifstream in(std::filesystem::path(*path), std::ios::binary);
+        std::vector<unsigned char> container((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        auto view = SignatureView::Parse(container.data(), container.size());
+        if (!view)
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Файл не является подписью");
+            return;
+        }
+
+        GostSignature signature = DecodeSignature(*view);
+        auto parameterSets = GostSigner::DefaultParameterSets();
+        auto parameters = std::find_if(parameterSets.begin(), parameterSets.end(),
+            [&signature](const GostParameters& entry) { return entry.name == signature.parameterSet; });
+        auto hashes = GostSigner::SupportedHashes();
+        auto hash = std::find(hashes.begin(), hashes.end(), signature.hashAlgorithm);
+        if (parameters == parameterSets.end() || hash == hashes.end())
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Неизвестный набор параметров");
+            return;
+        }
+        // The window verifies tree signatures with the default chunk size only.
+        if (signature.treeChunkSize != 0 && signature.treeChunkSize != TreeHashOptions::DEFAULT_CHUNK_SIZE)
+        {
+            SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Недопустимый размер блока дерева хешей");
+            return;
+        }
+
+        SendMessageW(GetDlgItem(hwnd, IDC_PARAM_SET), CB_SETCURSEL, static_cast<WPARAM>(parameters - parameterSets.begin()), 0);
+        SendMessageW(GetDlgItem(hwnd, IDC_HASH_COMBO), CB_SETCURSEL, static_cast<WPARAM>(hash - hashes.begin()), 0);
+        SendMessageW(GetDlgItem(hwnd, IDC_TREE_CHECK), BM_SETCHECK, signature.treeChunkSize != 0 ? BST_CHECKED : BST_UNCHECKED, 0);
+        SetWindowTextString(hwnd, IDC_SIGNATURE_BOX, signature.signatureHex);
+        if (!signature.publicKeyHex.empty())
+        {
+            SetWindowTextString(hwnd, IDC_PUBLIC_KEY_BOX, signature.publicKeyHex);
+        }
+        g_lastSignature = signature;
+        SetWindowTextString(hwnd, IDC_STATUS_TEXT, L"Подпись загружена");
     }
 
     void ShowSettings(HWND hwnd)
     {
-        MessageBoxW(hwnd, L"Все настройки выводятся в окне: выбор хеша, параметров и уровень случайности.\n"
-            L"Реализация использует демонстрационную подпись поверх SHA для удобной отладки.",
+        MessageBoxW(hwnd, L"Все настройки выводятся в окне: выбор хеша, параметров, режима дерева хешей и детерминированного nonce.\n"
+            L"Подпись вычисляется по ГОСТ Р 34.10-2012 на кривых tc26; подпись выводится как r || s.",
             L"О программе", MB_OK | MB_ICONINFORMATION);
     }
 
@@ -287,9 +512,15 @@ namespace
         case IDC_SIGN_BUTTON:
             UpdateSignature(hwnd);
             break;
+        case IDC_VERIFY_BUTTON:
+            VerifySignature(hwnd);
+            break;
         case IDC_SAVE_SIGNATURE:
             SaveSignature(hwnd);
             break;
+        case IDC_LOAD_SIGNATURE:
+            LoadSignature(hwnd);
+            break;
         case IDC_SETTINGS_BUTTON:
             ShowSettings(hwnd);
             break;
@@ -309,7 +540,18 @@ namespace
         case WM_COMMAND:
             SignOnCommand(hwnd, wParam);
             return 0;
+        case WM_SIGN_PROGRESS:
+            SignProgress(hwnd, wParam);
+            return 0;
+        case WM_SIGN_COMPLETE:
+            SignComplete(hwnd, lParam);
+            return 0;
         case WM_DESTROY:
+            if (g_signing)
+            {
+                g_signing->Cancel();
+                g_signing.reset();
+            }
             g_signatureWindow = nullptr;
             return 0;
         default:
@@ -376,7 +618,7 @@ namespace
             break;
         case IDC_MENU_KEY_WINDOW:
             CreateWindowExW(0, KEY_WINDOW_CLASS, L"Работа с ключами", WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU,
-                CW_USEDEFAULT, CW_USEDEFAULT, 560, 320, hwnd, nullptr, g_hInstance, nullptr);
+                CW_USEDEFAULT, CW_USEDEFAULT, 560, 440, hwnd, nullptr, g_hInstance, nullptr);
             break;
         case IDC_MENU_OPEN_SIGN:
             OpenSignatureWindow();
@@ -434,16 +676,18 @@ namespace
                 return;
             }
 
-            auto it = std::find(g_users.begin(), g_users.end(), name);
-            if (it == g_users.end())
+            if (g_store->HasUser(name))
+            {
+                SetWindowTextString(hwnd, IDC_CREATE_USER_STATUS, L"Такой пользователь уже есть");
+            }
+            else if (g_store->AddUser(name))
             {
-                g_users.push_back(name);
                 RefreshUserList(hwnd, IDC_CREATE_USER_LIST);
                 SetWindowTextString(hwnd, IDC_CREATE_USER_STATUS, L"Пользователь добавлен");
             }
             else
             {
-                SetWindowTextString(hwnd, IDC_CREATE_USER_STATUS, L"Такой пользователь уже есть");
+                SetWindowTextString(hwnd, IDC_CREATE_USER_STATUS, L"Не удалось сохранить пользователя");
             }
             break;
         }
@@ -492,14 +736,19 @@ namespace
                 return;
             }
 
-            wchar_t buffer[256]{};
-            SendMessageW(list, LB_GETTEXT, index, reinterpret_cast<LPARAM>(buffer));
+            // Stored names may be longer than any fixed buffer.
+            int length = static_cast<int>(SendMessageW(list, LB_GETTEXTLEN, index, 0));
+            std::wstring buffer(length + 1, L'\0');
+            SendMessageW(list, LB_GETTEXT, index, reinterpret_cast<LPARAM>(buffer.data()));
+            buffer.resize(length);
             g_activeUser = buffer;
+            LoadActiveUserKey();
             SetWindowTextString(hwnd, IDC_SELECT_USER_STATUS, L"Активный пользователь обновлен");
 
             if (g_signatureWindow)
             {
                 UpdateActiveUserLabel(g_signatureWindow);
+                SyncSignatureWindowKeys();
             }
             break;
         }
@@ -524,6 +773,12 @@ namespace
         return DefWindowProc(hwnd, message, wParam, lParam);
     }
 
+    size_t KeyWindowParameterSet(HWND hwnd)
+    {
+        LRESULT index = SendMessageW(GetDlgItem(hwnd, IDC_KEY_PARAM_SET), CB_GETCURSEL, 0, 0);
+        return index == CB_ERR ? 0 : static_cast<size_t>(index);
+    }
+
     void KeyOnCreate(HWND hwnd)
     {
         AddLabel(hwnd, 20, 20, 160, 20, L"Приватный ключ:");
@@ -532,10 +787,22 @@ namespace
         AddLabel(hwnd, 20, 80, 160, 20, L"Публичный ключ:");
         AddEdit(hwnd, IDC_KEY_PUBLIC, 20, 100, 500, 24, ES_READONLY);
 
-        AddButton(hwnd, IDC_KEY_GENERATE, 20, 140, 200, 28, L"Сгенерировать демо");
-        AddButton(hwnd, IDC_KEY_SAVE, 240, 140, 200, 28, L"Сохранить ключи");
-        AddEdit(hwnd, IDC_KEY_STATUS, 20, 190, 500, 24, ES_READONLY);
+        AddLabel(hwnd, 20, 140, 140, 20, L"Набор параметров:");
+        HWND comboParams = CreateWindowW(L"COMBOBOX", nullptr, CBS_DROPDOWNLIST | CBS_HASSTRINGS | WS_CHILD | WS_VISIBLE, 170, 136, 350, 200, hwnd, reinterpret_cast<HMENU>(IDC_KEY_PARAM_SET), nullptr, nullptr);
+        for (const auto& p : GostSigner::DefaultParameterSets())
+        {
+            SendMessageW(comboParams, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(p.name.c_str()));
+        }
+
+        AddButton(hwnd, IDC_KEY_GENERATE, 20, 176, 200, 28, L"Сгенерировать демо");
+        AddButton(hwnd, IDC_KEY_SAVE, 240, 176, 200, 28, L"Сохранить ключи");
+        AddEdit(hwnd, IDC_KEY_STATUS, 20, 220, 500, 24, ES_READONLY);
+
+        AddLabel(hwnd, 20, 256, 300, 20, L"Сохранённые ключи пользователя:");
+        CreateWindowW(L"LISTBOX", nullptr, WS_CHILD | WS_VISIBLE | WS_BORDER | WS_VSCROLL | LBS_NOTIFY,
+            20, 276, 500, 100, hwnd, reinterpret_cast<HMENU>(IDC_LIST_KEYS), nullptr, nullptr);
         SyncKeyFields(hwnd);
+        RefreshKeyList(hwnd);
     }
 
     void KeyOnCommand(HWND hwnd, WPARAM wParam)
@@ -543,26 +810,113 @@ namespace
         switch (LOWORD(wParam))
         {
         case IDC_KEY_GENERATE:
-            g_savedPrivateKey = L"00112233445566778899AABBCCDDEEFF";
-            g_savedPublicKey = L"A1B2C3D4E5F6A7B8C9D0E1F2A3B4C5D6";
+        {
+            const size_t parameterSet = KeyWindowParameterSet(hwnd);
+            const GostCurve* curve = GostCurve::Find(GostSigner::DefaultParameterSets()[parameterSet].name);
+            if (!curve)
+            {
+                SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Неизвестный набор параметров");
+                break;
+            }
+            std::vector<unsigned char> random(curve->Size());
+            std::vector<unsigned char> privateKey(curve->Size());
+            do
+            {
+                ChaChaDrbg::ForThread().Generate(random.data(), random.size());
+            } while (!curve->NormalizePrivateKey(random.data(), random.size(), privateKey.data()));
+
+            std::wstring publicKey;
+            std::wstring error;
+            if (!DerivePublicKey(parameterSet, FormatHex(privateKey), publicKey, error))
+            {
+                SetWindowTextString(hwnd, IDC_KEY_STATUS, error);
+                break;
+            }
+            g_savedPrivateKey = FormatHex(privateKey);
+            g_savedPublicKey = publicKey;
+            g_savedParameterSet = parameterSet;
             SyncKeyFields(hwnd);
             SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Демо-ключи сгенерированы");
-            if (g_signatureWindow)
+            SyncSignatureWindowKeys();
+            break;
+        }
+        case IDC_KEY_PARAM_SET:
+        {
+            // The same private key gives another public key on another curve.
+            std::wstring publicKey;
+            std::wstring error;
+            if (HIWORD(wParam) != CBN_SELCHANGE
+                || !DerivePublicKey(KeyWindowParameterSet(hwnd), GetWindowTextString(hwnd, IDC_KEY_PRIVATE), publicKey, error))
             {
-                SetWindowTextString(g_signatureWindow, IDC_PRIVATE_KEY, g_savedPrivateKey);
-                SetWindowTextString(g_signatureWindow, IDC_PUBLIC_KEY_BOX, g_savedPublicKey);
+                break;
             }
+            SetWindowTextString(hwnd, IDC_KEY_PUBLIC, publicKey);
             break;
+        }
         case IDC_KEY_SAVE:
-            g_savedPrivateKey = GetWindowTextString(hwnd, IDC_KEY_PRIVATE);
-            g_savedPublicKey = GetWindowTextString(hwnd, IDC_KEY_PUBLIC);
-            SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Ключи сохранены в сессию");
-            if (g_signatureWindow)
+        {
+            const size_t parameterSet = KeyWindowParameterSet(hwnd);
+            const std::wstring privateKeyHex = GetWindowTextString(hwnd, IDC_KEY_PRIVATE);
+            std::wstring publicKeyHex;
+            std::wstring error;
+            if (!DerivePublicKey(parameterSet, privateKeyHex, publicKeyHex, error))
+            {
+                SetWindowTextString(hwnd, IDC_KEY_STATUS, error);
+                break;
+            }
+            g_savedPrivateKey = privateKeyHex;
+            g_savedPublicKey = publicKeyHex;
+            g_savedParameterSet = parameterSet;
+            SyncKeyFields(hwnd);
+            SyncSignatureWindowKeys();
+            if (!g_store->HasUser(g_activeUser))
+            {
+                SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Ключи сохранены в сессию");
+                break;
+            }
+
+            StoredKey key;
+            auto privateKey = ParseHex(g_savedPrivateKey);
+            auto publicKey = ParseHex(g_savedPublicKey);
+            if (!privateKey || !publicKey)
+            {
+                SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Ключи должны быть в hex");
+                break;
+            }
+            key.privateKey = std::move(*privateKey);
+            key.publicKey = std::move(*publicKey);
+            SetWindowTextString(hwnd, IDC_KEY_STATUS, g_store->AddKey(g_activeUser, key)
+                ? L"Ключи сохранены для пользователя " + g_activeUser
+                : std::wstring(L"Не удалось сохранить ключи"));
+            RefreshKeyList(hwnd);
+            break;
+        }
+        case IDC_LIST_KEYS:
+        {
+            if (HIWORD(wParam) != LBN_SELCHANGE)
+            {
+                break;
+            }
+            int index = static_cast<int>(SendMessageW(GetDlgItem(hwnd, IDC_LIST_KEYS), LB_GETCURSEL, 0, 0));
+            auto keys = g_store->Keys(g_activeUser);
+            if (index == LB_ERR || static_cast<size_t>(index) >= keys.size())
+            {
+                break;
+            }
+            auto parameterSet = StoredKeyParameterSet(keys[index]);
+            if (!parameterSet)
             {
-                SetWindowTextString(g_signatureWindow, IDC_PRIVATE_KEY, g_savedPrivateKey);
-                SetWindowTextString(g_signatureWindow, IDC_PUBLIC_KEY_BOX, g_savedPublicKey);
+                SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Публичный ключ не соответствует приватному");
+                break;
             }
+            g_savedPrivateKey = FormatHex(keys[index].privateKey);
+            g_savedPublicKey = FormatHex(keys[index].publicKey);
+            g_savedParameterSet = *parameterSet;
+            SyncKeyFields(hwnd);
+            SyncSignatureWindowKeys();
+            SetWindowTextString(hwnd, IDC_KEY_STATUS, L"Ключ выбран");
             break;
+        }
         default:
             break;
         }
@@ -585,178 +939,6 @@ namespace
     }
 }
 
-// ---------------- GostSigner implementation ----------------
-std::vector<GostParameters> GostSigner::DefaultParameterSets()
-{
-    return {
-        {L"id-tc26-gost-3410-2012-256-paramSetA", L"P-256", L"CryptoPro CSP"},
-        {L"id-tc26-gost-3410-2012-256-paramSetB", L"P-256", L"CryptoPro CSP"},
-        {L"id-tc26-gost-3410-2012-512-paramSetC", L"P-512", L"CryptoPro CSP"}
-    };
-}
-
-std::vector<std::wstring> GostSigner::SupportedHashes()
-{
-    return { L"SHA-256", L"SHA-1" };
-}
-
-std::optional<std::vector<unsigned char>> GostSigner::ReadFile(const std::wstring& path)
-{
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open())
-    {
-        m_lastError = L"Не удалось открыть файл";
-        return std::nullopt;
-    }
-
-    std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    if (buffer.empty())
-    {
-        m_lastError = L"Файл пустой";
-        return std::nullopt;
-    }
-    return buffer;
-}
-
-std::optional<std::vector<unsigned char>> GostSigner::ComputeHash(const std::vector<unsigned char>& data, const std::wstring& hashName)
-{
-    LPCWSTR algorithmId = BCRYPT_SHA256_ALGORITHM;
-    if (hashName == L"SHA-1")
-    {
-        algorithmId = BCRYPT_SHA1_ALGORITHM;
-    }
-
-    BCRYPT_ALG_HANDLE hAlg = nullptr;
-    if (BCryptOpenAlgorithmProvider(&hAlg, algorithmId, nullptr, 0) != 0)
-    {
-        m_lastError = L"Не удалось открыть алгоритм хеширования";
-        return std::nullopt;
-    }
-
-    DWORD hashObjectSize = 0;
-    DWORD result = 0;
-    if (BCryptGetProperty(hAlg, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PUCHAR>(&hashObjectSize), sizeof(DWORD), &result, 0) != 0)
-    {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        m_lastError = L"Не удалось получить размер объекта хеша";
-        return std::nullopt;
-    }
-
-    std::vector<unsigned char> hashObject(hashObjectSize);
-    DWORD hashLength = 0;
-    if (BCryptGetProperty(hAlg, BCRYPT_HASH_LENGTH, reinterpret_cast<PUCHAR>(&hashLength), sizeof(DWORD), &result, 0) != 0)
-    {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        m_lastError = L"Не удалось получить длину хеша";
-        return std::nullopt;
-    }
-
-    BCRYPT_HASH_HANDLE hHash = nullptr;
-    if (BCryptCreateHash(hAlg, &hHash, hashObject.data(), hashObjectSize, nullptr, 0, 0) != 0)
-    {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        m_lastError = L"Не удалось создать хеш";
-        return std::nullopt;
-    }
-
-    if (BCryptHashData(hHash, const_cast<PUCHAR>(data.data()), static_cast<ULONG>(data.size()), 0) != 0)
-    {
-        BCryptDestroyHash(hHash);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        m_lastError = L"Ошибка обновления хеша";
-        return std::nullopt;
-    }
-
-    std::vector<unsigned char> hash(hashLength);
-    if (BCryptFinishHash(hHash, hash.data(), hashLength, 0) != 0)
-    {
-        BCryptDestroyHash(hHash);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        m_lastError = L"Ошибка завершения хеша";
-        return std::nullopt;
-    }
-
-    BCryptDestroyHash(hHash);
-    BCryptCloseAlgorithmProvider(hAlg, 0);
-    return hash;
-}
-
-std::vector<unsigned char> GostSigner::RandomBytes(size_t size, bool useStrongRandom)
-{
-    std::vector<unsigned char> buffer(size);
-    if (useStrongRandom)
-    {
-        BCryptGenRandom(nullptr, buffer.data(), static_cast<ULONG>(buffer.size()), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
-    }
-    else
-    {
-        auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-        for (size_t i = 0; i < size; ++i)
-        {
-            now = (now * 48271) % 0x7fffffff;
-            buffer[i] = static_cast<unsigned char>(now & 0xFF);
-        }
-    }
-    return buffer;
-}
-
-std::vector<unsigned char> GostSigner::MakeSignature(const std::vector<unsigned char>& hash, const std::vector<unsigned char>& privateKey, bool useStrongRandom)
-{
-    auto randomPart = RandomBytes(hash.size(), useStrongRandom);
-    auto mixed = XORMix(hash, privateKey);
-    auto signature = XORMix(mixed, randomPart);
-    signature.insert(signature.end(), randomPart.begin(), randomPart.end());
-    return signature;
-}
-
-std::vector<unsigned char> GostSigner::DerivePublicKey(const std::vector<unsigned char>& privateKey, const std::vector<unsigned char>& hash)
-{
-    auto pub = XORMix(privateKey, hash);
-    std::reverse(pub.begin(), pub.end());
-    return pub;
-}
-
-GostSignature GostSigner::SignFile(
-    const std::wstring& path,
-    const GostParameters& parameters,
-    const std::wstring& privateKeyHex,
-    const std::wstring& hashName,
-    bool useStrongRandom)
-{
-    GostSignature signature{};
-    signature.parameterSet = parameters.name;
-    signature.hashAlgorithm = hashName;
-
-    auto fileData = ReadFile(path);
-    if (!fileData)
-    {
-        signature.statusMessage = m_lastError;
-        return signature;
-    }
-
-    auto hash = ComputeHash(*fileData, hashName);
-    if (!hash)
-    {
-        signature.statusMessage = m_lastError;
-        return signature;
-    }
-
-    auto privateKey = HexToBytes(privateKeyHex);
-    if (privateKey.empty())
-    {
-        signature.statusMessage = L"Приватный ключ не задан";
-        return signature;
-    }
-
-    auto signBlob = MakeSignature(*hash, privateKey, useStrongRandom);
-    auto publicKey = DerivePublicKey(privateKey, *hash);
-
-    signature.signatureHex = FormatHex(signBlob);
-    signature.publicKeyHex = FormatHex(publicKey);
-    signature.statusMessage = L"Подпись сформирована (учебная демонстрация)";
-    return signature;
-}
-
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
     _In_opt_ HINSTANCE hPrevInstance,
     _In_ LPWSTR    lpCmdLine,
@@ -767,6 +949,17 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
 
     g_hInstance = hInstance;
 
+    g_store = std::make_unique<KeyStore>(StorePath());
+    if (!g_store->IsOpen())
+    {
+        MessageBoxW(nullptr, L"Не удалось открыть файл пользователей; пользователи и ключи не будут сохранены.",
+            L"ГОСТ 34.10 ЭЦП", MB_OK | MB_ICONWARNING);
+    }
+    else if (g_store->UserCount() == 0)
+    {
+        g_store->AddUser(L"Администратор");
+    }
+
     WNDCLASSEXW wcex{};
     wcex.cbSize = sizeof(WNDCLASSEX);
     wcex.style = CS_HREDRAW | CS_VREDRAW;
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <string>
-#include <vector>
-#include <optional>
-#include <sstream>
-#include <iomanip>
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
 
+#include "GostSigner.h"
+
 // ---------------- Resource identifiers ----------------
 #define IDC_FILEPATH_EDIT 101
 #define IDC_BROWSE_BUTTON 102
@@ -16,11 +17,14 @@
 #define IDC_PARAM_SET     106
 #define IDC_HASH_COMBO    107
 #define IDC_STATUS_TEXT   108
-#define IDC_RANDOM_CHECK  109
 #define IDC_PUBLIC_KEY_BOX 110
 #define IDC_SAVE_SIGNATURE 111
 #define IDC_SETTINGS_BUTTON 112
 #define IDC_ACTIVE_USER   113
+#define IDC_VERIFY_BUTTON 114
+#define IDC_TREE_CHECK    115
+#define IDC_LOAD_SIGNATURE 116
+#define IDC_DETERMINISTIC_CHECK 117
 
 #define IDC_MENU_ACTIVE_USER 150
 #define IDC_MENU_CREATE_USER 151
@@ -42,6 +46,7 @@
 #define IDC_KEY_GENERATE 192
 #define IDC_KEY_SAVE 193
 #define IDC_KEY_STATUS 194
+#define IDC_KEY_PARAM_SET 195
 
 #define IDD_LOGIN 300
 #define IDC_CMB_USERS 301
@@ -100,46 +105,6 @@
 
 namespace gost
 {
-    struct GostParameters
-    {
-        std::wstring name;
-        std::wstring curve;
-        std::wstring provider;
-    };
-
-    struct GostSignature
-    {
-        std::wstring parameterSet;
-        std::wstring hashAlgorithm;
-        std::wstring signatureHex;
-        std::wstring publicKeyHex;
-        std::wstring statusMessage;
-    };
-
-    class GostSigner
-    {
-    public:
-        GostSignature SignFile(
-            const std::wstring& path,
-            const GostParameters& parameters,
-            const std::wstring& privateKeyHex,
-            const std::wstring& hashName,
-            bool useStrongRandom);
-
-        const std::wstring& GetLastError() const { return m_lastError; }
-        static std::vector<GostParameters> DefaultParameterSets();
-        static std::vector<std::wstring> SupportedHashes();
-
-    private:
-        std::wstring m_lastError;
-
-        std::optional<std::vector<unsigned char>> ReadFile(const std::wstring& path);
-        std::optional<std::vector<unsigned char>> ComputeHash(const std::vector<unsigned char>& data, const std::wstring& hashName);
-        std::vector<unsigned char> MakeSignature(const std::vector<unsigned char>& hash, const std::vector<unsigned char>& privateKey, bool useStrongRandom);
-        std::vector<unsigned char> DerivePublicKey(const std::vector<unsigned char>& privateKey, const std::vector<unsigned char>& hash);
-        std::vector<unsigned char> RandomBytes(size_t size, bool useStrongRandom);
-    };
-
     inline std::wstring ToWide(const std::string& value)
     {
         if (value.empty())
@@ -175,32 +140,4 @@ namespace gost
         WideCharToMultiByte(CP_UTF8, 0, value.c_str(), static_cast<int>(value.size()), output.data(), required, nullptr, nullptr);
         return output;
     }
-
-    inline std::wstring FormatHex(const std::vector<unsigned char>& data)
-    {
-        std::wstringstream ss;
-        ss << std::hex << std::setfill(L'0');
-        for (unsigned char b : data)
-        {
-            ss << std::setw(2) << static_cast<int>(b);
-        }
-        return ss.str();
-    }
-
-    inline std::vector<unsigned char> ParseHex(const std::wstring& hex)
-    {
-        std::vector<unsigned char> bytes;
-        std::wstringstream ss(hex);
-        while (!ss.eof())
-        {
-            unsigned int byte;
-            ss >> std::hex >> byte;
-            if (!ss.fail())
-            {
-                bytes.push_back(static_cast<unsigned char>(byte));
-            }
-        }
-        return bytes;
-    }
 }
-
@@ -0,0 +1,1061 @@
+#include "GostCurve.h"
+
+#include "GostField.h"
+
+#include <cstdint>
+#include <cwchar>
+
+using namespace gost;
+
+namespace
+{
+    template <size_t N>
+    Limbs<N> FromBigEndian(const unsigned char* bytes)
+    {
+        Limbs<N> value{};
+        for (size_t i = 0; i < N * 8; ++i)
+        {
+            value[i / 8] |= static_cast<uint64_t>(bytes[N * 8 - 1 - i]) << (8 * (i % 8));
+        }
+        return value;
+    }
+
+    template <size_t N>
+    void ToBigEndian(const Limbs<N>& value, unsigned char* bytes)
+    {
+        for (size_t i = 0; i < N * 8; ++i)
+        {
+            bytes[N * 8 - 1 - i] = static_cast<unsigned char>(value[i / 8] >> (8 * (i % 8)));
+        }
+    }
+
+    // Clears a secret scalar or buffer before its stack slot is reused.
+    template <typename T>
+    void Wipe(T& value)
+    {
+        volatile unsigned char* bytes = reinterpret_cast<volatile unsigned char*>(&value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            bytes[i] = 0;
+        }
+    }
+
+    // ---------------- Curve ----------------
+    // The moduli p and q live in GostField.h as compile-time constants.
+    struct CurveDefinition
+    {
+        const char* a;
+        const char* b;
+        const char* x;
+        const char* y;
+        // d of the twisted Edwards curve u^2 + v^2 = 1 + d * u^2 * v^2 that
+        // RFC 7836 (A.2) gives as equivalent to this one, or nullptr.
+        const char* d;
+    };
+
+    const CurveDefinition TC26_256_A = {
+        "C2173F1513981673AF4892C23035A27CE25E2013BF95AA33B22C656F277E7335",
+        "295F9BAE7428ED9CCC20E7C359A9D41A22FCCD9108E17BF7BA9337A6F8AE9513",
+        "91E38443A5E82C0D880923425712B2BB658B9196932E02C78B2582FE742DAA28",
+        "32879423AB1A0375895786C4BB46E9565FDE0B5344766740AF268ADB32322E5C",
+        "0605F6B7C183FA81578BC39CFAD518132B9DF62897009AF7E522C32D6DC7BFFB"
+    };
+
+    const CurveDefinition TC26_256_B = {
+        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFD94",
+        "A6",
+        "1",
+        "8D91E471E0989CDA27DF505A453F2B7635294F2DDF23E3B122ACC99C9E9F1E14",
+        nullptr
+    };
+
+    const CurveDefinition TC26_512_C = {
+        "DC9203E514A721875485A529D2C722FB187BC8980EB866644DE41C68E1430645"
+        "46E861C0E2C9EDD92ADE71F46FCF50FF2AD97F951FDA9F2A2EB6546F39689BD3",
+        "B4C4EE28CEBC6C2C8AC12952CF37F16AC7EFB6A9F69F4B57FFDA2E4F0DE5ADE0"
+        "38CBC2FFF719D2C18DE0284B8BFEF3B52B8CC7A5F5BF0A3C8D2319A5312557E1",
+        "E2E31EDFC23DE7BDEBE241CE593EF5DE2295B7A9CBAEF021D385F7074CEA043A"
+        "A27272A7AE602BF2A7B9033DB9ED3610C6FB85487EAE97AAC5BC7928C1950148",
+        "F5CE40D95B5EB899ABBCCFF5911CB8577939804D6527378B8C108C3D2090FF9B"
+        "E18E2D33E3021ED2EF32D85822423B6304F726AA854BAE07D0396E9A9ADDC40F",
+        "9E4F5D8C017D8D9F13A5CF3CDF5BFE4DAB402D54198E31EBDE28A0621050439C"
+        "A6B39E0A515C06B304E2CE43E79E369E91A0CFC2BC2A22B4CA302DBB33EE7550"
+    };
+
+    template <size_t N>
+    struct AffinePoint
+    {
+        Limbs<N> x;
+        Limbs<N> y;
+    };
+
+    // Jacobian coordinates (X / Z^2, Y / Z^3); Z == 0 is the point at infinity.
+    template <size_t N>
+    struct JacobianPoint
+    {
+        Limbs<N> x;
+        Limbs<N> y;
+        Limbs<N> z;
+    };
+
+    // Extended Edwards coordinates: u = X / Z, v = Y / Z and T = X * Y / Z.
+    template <size_t N>
+    struct ExtendedPoint
+    {
+        Limbs<N> x;
+        Limbs<N> y;
+        Limbs<N> z;
+        Limbs<N> t;
+    };
+
+    // Affine Edwards point with d * u * v precomputed for mixed addition.
+    template <size_t N>
+    struct EdwardsEntry
+    {
+        Limbs<N> u;
+        Limbs<N> v;
+        Limbs<N> dt;
+    };
+
+    // ---------------- Point arithmetic ----------------
+    // WeierstrassCurve adds points through one of the two classes below. Point
+    // is what a scalar multiplication accumulates in, Entry an affine table
+    // point for mixed addition. Points enter from and leave to the affine
+    // Weierstrass coordinates that keys and signatures are defined on.
+
+    // Jacobian coordinates on y^2 = x^3 + ax + b itself. Add and AddMixed branch
+    // on their exceptional cases, and an Entry cannot be the point at infinity.
+    template <size_t N, const Limbs<N>& P>
+    class JacobianArithmetic
+    {
+    public:
+        using Fp = MontgomeryField<N, P>;
+        using Element = Limbs<N>;
+        using Point = JacobianPoint<N>;
+        using Entry = AffinePoint<N>;
+
+        static constexpr bool COMPLETE = false;
+
+        explicit JacobianArithmetic(const CurveDefinition& definition)
+            : m_a(Fp::ToMontgomery(field_detail::ParseHex<N>(definition.a)))
+        {
+        }
+
+        Point Identity() const
+        {
+            return { Fp::One(), Fp::One(), Element{} };
+        }
+
+        bool FromAffine(const AffinePoint<N>& point, Point& result) const
+        {
+            result = { point.x, point.y, Fp::One() };
+            return true;
+        }
+
+        AffinePoint<N> ToAffine(const Point& p) const
+        {
+            Element zInv = Fp::Inv(p.z);
+            Element zInv2 = Fp::Sqr(zInv);
+            return { Fp::Mul(p.x, zInv2), Fp::Mul(p.y, Fp::Mul(zInv2, zInv)) };
+        }
+
+        // x = numerator / denominator; the denominator is zero only at infinity.
+        void X(const Point& p, Element& numerator, Element& denominator) const
+        {
+            numerator = p.x;
+            denominator = Fp::Sqr(p.z);
+        }
+
+        // dbl-2007-bl, valid for any a.
+        Point Double(const Point& p) const
+        {
+            if (IsZero(p.z))
+            {
+                return p;
+            }
+
+            Element xx = Fp::Sqr(p.x);
+            Element yy = Fp::Sqr(p.y);
+            Element yyyy = Fp::Sqr(yy);
+            Element zz = Fp::Sqr(p.z);
+            Element s = Fp::Sub(Fp::Sub(Fp::Sqr(Fp::Add(p.x, yy)), xx), yyyy);
+            s = Fp::Add(s, s);
+            Element m = Fp::Add(Fp::Add(xx, xx), xx);
+            m = Fp::Add(m, Fp::Mul(m_a, Fp::Sqr(zz)));
+            Element t = Fp::Sub(Fp::Sqr(m), Fp::Add(s, s));
+
+            Point r;
+            r.x = t;
+            Element yyyy8 = Fp::Add(yyyy, yyyy);
+            yyyy8 = Fp::Add(yyyy8, yyyy8);
+            yyyy8 = Fp::Add(yyyy8, yyyy8);
+            r.y = Fp::Sub(Fp::Mul(m, Fp::Sub(s, t)), yyyy8);
+            r.z = Fp::Sub(Fp::Sub(Fp::Sqr(Fp::Add(p.y, p.z)), yy), zz);
+            return r;
+        }
+
+        // add-2007-bl with the exceptional cases handled explicitly.
+        Point Add(const Point& p, const Point& q) const
+        {
+            if (IsZero(p.z))
+            {
+                return q;
+            }
+            if (IsZero(q.z))
+            {
+                return p;
+            }
+
+            Element z1z1 = Fp::Sqr(p.z);
+            Element z2z2 = Fp::Sqr(q.z);
+            Element u1 = Fp::Mul(p.x, z2z2);
+            Element u2 = Fp::Mul(q.x, z1z1);
+            Element s1 = Fp::Mul(Fp::Mul(p.y, q.z), z2z2);
+            Element s2 = Fp::Mul(Fp::Mul(q.y, p.z), z1z1);
+            Element h = Fp::Sub(u2, u1);
+            Element rr = Fp::Sub(s2, s1);
+            if (IsZero(h))
+            {
+                return IsZero(rr) ? Double(p) : Identity();
+            }
+
+            Element i = Fp::Add(h, h);
+            i = Fp::Sqr(i);
+            Element j = Fp::Mul(h, i);
+            rr = Fp::Add(rr, rr);
+            Element v = Fp::Mul(u1, i);
+
+            Point r;
+            r.x = Fp::Sub(Fp::Sub(Fp::Sqr(rr), j), Fp::Add(v, v));
+            Element s1j = Fp::Mul(s1, j);
+            r.y = Fp::Sub(Fp::Mul(rr, Fp::Sub(v, r.x)), Fp::Add(s1j, s1j));
+            r.z = Fp::Mul(Fp::Sub(Fp::Sub(Fp::Sqr(Fp::Add(p.z, q.z)), z1z1), z2z2), h);
+            return r;
+        }
+
+        // madd-2007-bl: Jacobian + affine.
+        Point AddMixed(const Point& p, const Entry& q) const
+        {
+            if (IsZero(p.z))
+            {
+                return { q.x, q.y, Fp::One() };
+            }
+
+            Element z1z1 = Fp::Sqr(p.z);
+            Element u2 = Fp::Mul(q.x, z1z1);
+            Element s2 = Fp::Mul(Fp::Mul(q.y, p.z), z1z1);
+            Element h = Fp::Sub(u2, p.x);
+            Element rr = Fp::Sub(s2, p.y);
+            if (IsZero(h))
+            {
+                return IsZero(rr) ? Double(p) : Identity();
+            }
+
+            Element hh = Fp::Sqr(h);
+            Element i = Fp::Add(hh, hh);
+            i = Fp::Add(i, i);
+            Element j = Fp::Mul(h, i);
+            rr = Fp::Add(rr, rr);
+            Element v = Fp::Mul(p.x, i);
+
+            Point r;
+            r.x = Fp::Sub(Fp::Sub(Fp::Sqr(rr), j), Fp::Add(v, v));
+            Element y1j = Fp::Mul(p.y, j);
+            r.y = Fp::Sub(Fp::Mul(rr, Fp::Sub(v, r.x)), Fp::Add(y1j, y1j));
+            r.z = Fp::Sub(Fp::Sub(Fp::Sqr(Fp::Add(p.z, h)), z1z1), hh);
+            return r;
+        }
+
+        static Point Negate(Point p)
+        {
+            p.y = Fp::Neg(p.y);
+            return p;
+        }
+
+        static Entry Negate(Entry e)
+        {
+            e.y = Fp::Neg(e.y);
+            return e;
+        }
+
+        // Never added: the scalar loops skip zero digits for this arithmetic.
+        Entry IdentityEntry() const
+        {
+            return {};
+        }
+
+        static Entry Select(const Entry& a, const Entry& b, bool chooseB)
+        {
+            return { Fp::Select(a.x, b.x, chooseB), Fp::Select(a.y, b.y, chooseB) };
+        }
+
+        // All points to affine with a single shared inversion.
+        std::vector<Entry> ToEntries(const std::vector<Point>& points) const
+        {
+            std::vector<Element> prefix(points.size());
+            Element acc = Fp::One();
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                prefix[i] = acc;
+                acc = Fp::Mul(acc, points[i].z);
+            }
+
+            Element inv = Fp::Inv(acc);
+            std::vector<Entry> affine(points.size());
+            for (size_t i = points.size(); i-- > 0;)
+            {
+                Element zInv = Fp::Mul(inv, prefix[i]);
+                inv = Fp::Mul(inv, points[i].z);
+                Element zInv2 = Fp::Sqr(zInv);
+                affine[i].x = Fp::Mul(points[i].x, zInv2);
+                affine[i].y = Fp::Mul(points[i].y, Fp::Mul(zInv2, zInv));
+            }
+            return affine;
+        }
+
+    private:
+        Element m_a;
+    };
+
+    // Extended coordinates on the equivalent Edwards curve u^2 + v^2 = 1 +
+    // d * u^2 * v^2. With d not a square the addition law is complete: the
+    // same formulas add, double and take the identity, without branches, so
+    // secret scalars can be walked with an unconditional addition per window.
+    // The map from y^2 = x^3 + ax + b, with s = (1 - d) / 4 and t = (1 + d) / 6,
+    // is u = (x - t) / y, v = (x - t - s) / (x - t + s).
+    template <size_t N, const Limbs<N>& P>
+    class EdwardsArithmetic
+    {
+    public:
+        using Fp = MontgomeryField<N, P>;
+        using Element = Limbs<N>;
+        using Point = ExtendedPoint<N>;
+        using Entry = EdwardsEntry<N>;
+
+        static constexpr bool COMPLETE = true;
+
+        explicit EdwardsArithmetic(const CurveDefinition& definition)
+            : m_d(Fp::ToMontgomery(field_detail::ParseHex<N>(definition.d)))
+        {
+            Element one = Fp::One();
+            Element two = Fp::Add(one, one);
+            Element four = Fp::Add(two, two);
+            Element six = Fp::Add(four, two);
+            m_s = Fp::Mul(Fp::Sub(one, m_d), Fp::Inv(four));
+            m_t = Fp::Mul(Fp::Add(one, m_d), Fp::Inv(six));
+        }
+
+        Point Identity() const
+        {
+            return { Element{}, Fp::One(), Fp::One(), Element{} };
+        }
+
+        // False for the few curve points the map leaves out (y == 0 or
+        // x - t + s == 0); none of them has order q.
+        bool FromAffine(const AffinePoint<N>& point, Point& result) const
+        {
+            // u = X / Z and v = Y / Z over the common denominator y * (w + s),
+            // scaled by Z once more so that T = X * Y / Z needs no inversion.
+            Element w = Fp::Sub(point.x, m_t);
+            Element wPlusS = Fp::Add(w, m_s);
+            Element x = Fp::Mul(w, wPlusS);
+            Element y = Fp::Mul(Fp::Sub(w, m_s), point.y);
+            Element z = Fp::Mul(point.y, wPlusS);
+            if (IsZero(z))
+            {
+                return false;
+            }
+            result = { Fp::Mul(x, z), Fp::Mul(y, z), Fp::Sqr(z), Fp::Mul(x, y) };
+            return true;
+        }
+
+        // x = s * (1 + v) / (1 - v) + t and y = s * (1 + v) / ((1 - v) * u).
+        AffinePoint<N> ToAffine(const Point& p) const
+        {
+            Element k = Fp::Mul(Fp::Mul(m_s, Fp::Add(p.z, p.y)), Fp::Inv(Fp::Mul(Fp::Sub(p.z, p.y), p.x)));
+            return { Fp::Add(Fp::Mul(k, p.x), m_t), Fp::Mul(k, p.z) };
+        }
+
+        // x = numerator / denominator; the denominator is zero only at the identity.
+        void X(const Point& p, Element& numerator, Element& denominator) const
+        {
+            denominator = Fp::Sub(p.z, p.y);
+            numerator = Fp::Add(Fp::Mul(m_s, Fp::Add(p.z, p.y)), Fp::Mul(m_t, denominator));
+        }
+
+        // dbl-2008-hwcd with a = 1: 4M + 4S.
+        Point Double(const Point& p) const
+        {
+            Element a = Fp::Sqr(p.x);
+            Element b = Fp::Sqr(p.y);
+            Element c = Fp::Sqr(p.z);
+            c = Fp::Add(c, c);
+            Element e = Fp::Sub(Fp::Sub(Fp::Sqr(Fp::Add(p.x, p.y)), a), b);
+            Element g = Fp::Add(a, b);
+            Element f = Fp::Sub(g, c);
+            Element h = Fp::Sub(a, b);
+            return { Fp::Mul(e, f), Fp::Mul(g, h), Fp::Mul(f, g), Fp::Mul(e, h) };
+        }
+
+        // add-2008-hwcd with a = 1: 10M.
+        Point Add(const Point& p, const Point& q) const
+        {
+            Element a = Fp::Mul(p.x, q.x);
+            Element b = Fp::Mul(p.y, q.y);
+            Element c = Fp::Mul(Fp::Mul(p.t, q.t), m_d);
+            Element d = Fp::Mul(p.z, q.z);
+            return Combine(p, Fp::Add(q.x, q.y), a, b, c, d);
+        }
+
+        // The same with Z2 = 1 and d * T2 from the table: 8M.
+        Point AddMixed(const Point& p, const Entry& q) const
+        {
+            Element a = Fp::Mul(p.x, q.u);
+            Element b = Fp::Mul(p.y, q.v);
+            Element c = Fp::Mul(p.t, q.dt);
+            return Combine(p, Fp::Add(q.u, q.v), a, b, c, p.z);
+        }
+
+        static Point Negate(Point p)
+        {
+            p.x = Fp::Neg(p.x);
+            p.t = Fp::Neg(p.t);
+            return p;
+        }
+
+        static Entry Negate(Entry e)
+        {
+            e.u = Fp::Neg(e.u);
+            e.dt = Fp::Neg(e.dt);
+            return e;
+        }
+
+        Entry IdentityEntry() const
+        {
+            return { Element{}, Fp::One(), Element{} };
+        }
+
+        static Entry Select(const Entry& a, const Entry& b, bool chooseB)
+        {
+            return { Fp::Select(a.u, b.u, chooseB), Fp::Select(a.v, b.v, chooseB), Fp::Select(a.dt, b.dt, chooseB) };
+        }
+
+        // All points to affine with a single shared inversion.
+        std::vector<Entry> ToEntries(const std::vector<Point>& points) const
+        {
+            std::vector<Element> prefix(points.size());
+            Element acc = Fp::One();
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                prefix[i] = acc;
+                acc = Fp::Mul(acc, points[i].z);
+            }
+
+            Element inv = Fp::Inv(acc);
+            std::vector<Entry> entries(points.size());
+            for (size_t i = points.size(); i-- > 0;)
+            {
+                Element zInv = Fp::Mul(inv, prefix[i]);
+                inv = Fp::Mul(inv, points[i].z);
+                entries[i].u = Fp::Mul(points[i].x, zInv);
+                entries[i].v = Fp::Mul(points[i].y, zInv);
+                entries[i].dt = Fp::Mul(Fp::Mul(entries[i].u, entries[i].v), m_d);
+            }
+            return entries;
+        }
+
+    private:
+        // The shared tail of both additions, from A = X1 X2, B = Y1 Y2,
+        // C = d T1 T2, D = Z1 Z2 and the second point's u + v.
+        static Point Combine(const Point& p, const Element& sum2, const Element& a, const Element& b, const Element& c, const Element& d)
+        {
+            Element e = Fp::Sub(Fp::Sub(Fp::Mul(Fp::Add(p.x, p.y), sum2), a), b);
+            Element f = Fp::Sub(d, c);
+            Element g = Fp::Add(d, c);
+            Element h = Fp::Sub(b, a);
+            return { Fp::Mul(e, f), Fp::Mul(g, h), Fp::Mul(f, g), Fp::Mul(e, h) };
+        }
+
+        Element m_d;
+        Element m_s;
+        Element m_t;
+    };
+
+    // GOST R 34.10-2012 on y^2 = x^3 + ax + b. Keys, signatures and the checks
+    // on them are defined on this form; Arithmetic decides which coordinates
+    // the scalar multiplications run in.
+    template <size_t N, const Limbs<N>& P, const Limbs<N>& Q, typename Arithmetic>
+    class WeierstrassCurve : public GostCurve
+    {
+    public:
+        using Fp = MontgomeryField<N, P>;
+        using Fq = MontgomeryField<N, Q>;
+        using Point = typename Arithmetic::Point;
+        using Entry = typename Arithmetic::Entry;
+
+        // Fixed-base signed windows: k = sum d_i * 2^(5i) with |d_i| <= 16, so
+        // k * P costs one table lookup and one mixed addition per window.
+        static constexpr size_t WINDOW_BITS = 5;
+        static constexpr size_t WINDOW_ENTRIES = size_t{ 1 } << (WINDOW_BITS - 1);
+        static constexpr size_t WINDOWS = (64 * N + WINDOW_BITS - 1) / WINDOW_BITS + 1;
+
+        // Verification uses width-w NAF digits: the base point gets a wider,
+        // precomputed table, the public key a small one built per call.
+        static constexpr size_t BASE_NAF_WIDTH = 7;
+        static constexpr size_t POINT_NAF_WIDTH = 5;
+        static constexpr size_t NAF_DIGITS = 64 * N + 2;
+
+        explicit WeierstrassCurve(const CurveDefinition& definition)
+            : m_arithmetic(definition)
+        {
+            m_a = Fp::ToMontgomery(field_detail::ParseHex<N>(definition.a));
+            m_b = Fp::ToMontgomery(field_detail::ParseHex<N>(definition.b));
+            m_base.x = Fp::ToMontgomery(field_detail::ParseHex<N>(definition.x));
+            m_base.y = Fp::ToMontgomery(field_detail::ParseHex<N>(definition.y));
+            BuildTable();
+        }
+
+        size_t Size() const override { return N * 8; }
+
+        bool NormalizePrivateKey(const unsigned char* key, size_t size, unsigned char* output) const override
+        {
+            Limbs<N> d = Fq::FromMontgomery(Fq::FromBigEndian(key, size));
+            bool valid = !IsZero(d);
+            ToBigEndian(d, output);
+            Wipe(d);
+            return valid;
+        }
+
+        std::vector<unsigned char> PublicKey(const unsigned char* privateKey) const override
+        {
+            Limbs<N> d = FromBigEndian<N>(privateKey);
+            AffinePoint<N> q = m_arithmetic.ToAffine(MulBase(d));
+            Wipe(d);
+            std::vector<unsigned char> output = Encode(Fp::FromMontgomery(q.x));
+            std::vector<unsigned char> y = Encode(Fp::FromMontgomery(q.y));
+            output.insert(output.end(), y.begin(), y.end());
+            return output;
+        }
+
+        std::vector<unsigned char> Sign(
+            const std::vector<unsigned char>& digest,
+            const unsigned char* privateKey,
+            const RandomSource& random) const override
+        {
+            Limbs<N> e = Fq::FromLittleEndian(digest.data(), digest.size());
+            if (IsZero(e))
+            {
+                e = Fq::One();
+            }
+            Limbs<N> d = Fq::ToMontgomery(FromBigEndian<N>(privateKey));
+
+            // Masking to the bit length of q keeps the rejection rate below one half.
+            uint64_t topByte = Fq::Mod()[N - 1] >> 56;
+            unsigned char topMask = 0xFF;
+            while ((topMask >> 1) >= topByte)
+            {
+                topMask >>= 1;
+            }
+
+            unsigned char nonceBytes[N * 8];
+            for (;;)
+            {
+                random(nonceBytes, sizeof(nonceBytes));
+                nonceBytes[0] &= topMask;
+                Limbs<N> k = FromBigEndian<N>(nonceBytes);
+                if (IsZero(k) || !LessThan(k, Fq::Mod()))
+                {
+                    continue;
+                }
+
+                Element numerator;
+                Element denominator;
+                m_arithmetic.X(MulBase(k), numerator, denominator);
+                Element x = Fp::Mul(numerator, Fp::Inv(denominator));
+                Limbs<N> r = Fq::ToMontgomery(Fp::FromMontgomery(x));
+                if (IsZero(r))
+                {
+                    continue;
+                }
+
+                Limbs<N> s = Fq::Add(Fq::Mul(r, d), Fq::Mul(Fq::ToMontgomery(k), e));
+                if (IsZero(s))
+                {
+                    continue;
+                }
+
+                Wipe(d);
+                Wipe(k);
+                Wipe(nonceBytes);
+                std::vector<unsigned char> signature = Encode(Fq::FromMontgomery(r));
+                std::vector<unsigned char> sBytes = Encode(Fq::FromMontgomery(s));
+                signature.insert(signature.end(), sBytes.begin(), sBytes.end());
+                return signature;
+            }
+        }
+
+        using GostCurve::Verify;
+
+        bool Verify(
+            const std::vector<unsigned char>& digest,
+            const unsigned char* signature,
+            size_t signatureSize,
+            const unsigned char* publicKey,
+            size_t publicKeySize) const override
+        {
+            Element r;
+            Element s;
+            Point q;
+            if (!ParseSignature(signature, signatureSize, r, s) || !DecodeKey(publicKey, publicKeySize, q))
+            {
+                return false;
+            }
+
+            Element z1;
+            Element z2;
+            Coefficients(r, s, Fq::Inv(DigestElement(digest)), z1, z2);
+            return MatchesR(MulDouble(z1, q, z2), r);
+        }
+
+        std::unique_ptr<PreparedKey> PrepareKey(const std::vector<unsigned char>& publicKey, bool withTable) const override
+        {
+            auto key = std::make_unique<KeyPoint>();
+            if (!DecodeKey(publicKey.data(), publicKey.size(), key->point))
+            {
+                return nullptr;
+            }
+            if (withTable)
+            {
+                key->table = m_arithmetic.ToEntries(WindowMultiples(key->point));
+            }
+            return key;
+        }
+
+        std::vector<bool> VerifyBatch(const std::vector<BatchEntry>& entries) const override
+        {
+            std::vector<bool> results(entries.size(), false);
+            std::vector<Element> r(entries.size());
+            std::vector<Element> s(entries.size());
+            std::vector<size_t> wellFormed;
+            std::vector<Element> inverses;
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                if (entries[i].key && ParseSignature(entries[i].signature->data(), entries[i].signature->size(), r[i], s[i]))
+                {
+                    wellFormed.push_back(i);
+                    inverses.push_back(DigestElement(*entries[i].digest));
+                }
+            }
+            BatchInvert(inverses);
+
+            for (size_t k = 0; k < wellFormed.size(); ++k)
+            {
+                const size_t i = wellFormed[k];
+                const KeyPoint& key = static_cast<const KeyPoint&>(*entries[i].key);
+                Element z1;
+                Element z2;
+                Coefficients(r[i], s[i], inverses[k], z1, z2);
+                Point c = key.table.empty()
+                    ? MulDouble(z1, key.point, z2)
+                    : AddFixedBase(AddFixedBase(m_arithmetic.Identity(), m_table, z1), key.table, z2);
+                results[i] = MatchesR(c, r[i]);
+            }
+            return results;
+        }
+
+    private:
+        using Element = Limbs<N>;
+
+        struct KeyPoint : PreparedKey
+        {
+            Point point;
+            // WINDOWS * WINDOW_ENTRIES entries laid out like m_table, or empty.
+            std::vector<Entry> table;
+        };
+
+        // r and s as integers, both in [1, q).
+        static bool ParseSignature(const unsigned char* signature, size_t size, Element& r, Element& s)
+        {
+            if (size != 2 * N * 8)
+            {
+                return false;
+            }
+            r = FromBigEndian<N>(signature);
+            s = FromBigEndian<N>(signature + N * 8);
+            return !IsZero(r) && !IsZero(s) && LessThan(r, Fq::Mod()) && LessThan(s, Fq::Mod());
+        }
+
+        // e = digest mod q in Montgomery form, with 0 replaced by 1.
+        static Element DigestElement(const std::vector<unsigned char>& digest)
+        {
+            Element e = Fq::FromLittleEndian(digest.data(), digest.size());
+            return IsZero(e) ? Fq::One() : e;
+        }
+
+        // z1 = s / e and z2 = -r / e as integers, from v = 1 / e in Montgomery form.
+        static void Coefficients(const Element& r, const Element& s, const Element& v, Element& z1, Element& z2)
+        {
+            z1 = Fq::FromMontgomery(Fq::Mul(Fq::ToMontgomery(s), v));
+            z2 = Fq::FromMontgomery(Fq::Neg(Fq::Mul(Fq::ToMontgomery(r), v)));
+        }
+
+        // Montgomery's trick: every value replaced by its inverse for one field
+        // inversion and three multiplications each. No value may be zero.
+        static void BatchInvert(std::vector<Element>& values)
+        {
+            if (values.empty())
+            {
+                return;
+            }
+
+            std::vector<Element> prefix(values.size());
+            Element acc = Fq::One();
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                prefix[i] = acc;
+                acc = Fq::Mul(acc, values[i]);
+            }
+
+            Element inv = Fq::Inv(acc);
+            for (size_t i = values.size(); i-- > 0;)
+            {
+                Element valueInv = Fq::Mul(inv, prefix[i]);
+                inv = Fq::Mul(inv, values[i]);
+                values[i] = valueInv;
+            }
+        }
+
+        // x(C) mod q == r checked without an inversion: with x(C) as a fraction
+        // n / m, n == (r + jq) * m for every r + jq below p.
+        bool MatchesR(const Point& c, const Element& r) const
+        {
+            Element numerator;
+            Element denominator;
+            m_arithmetic.X(c, numerator, denominator);
+            if (IsZero(denominator))
+            {
+                return false;
+            }
+
+            Element candidate = r;
+            for (;;)
+            {
+                if (Fp::Mul(Fp::ToMontgomery(candidate), denominator) == numerator)
+                {
+                    return true;
+                }
+
+                uint64_t carry = 0;
+                for (size_t i = 0; i < N; ++i)
+                {
+                    candidate[i] = field_detail::AddCarry(candidate[i], Fq::Mod()[i], carry);
+                }
+                if (carry || !LessThan(candidate, Fp::Mod()))
+                {
+                    return false;
+                }
+            }
+        }
+
+        static std::vector<unsigned char> Encode(const Element& value)
+        {
+            std::vector<unsigned char> bytes(N * 8);
+            ToBigEndian(value, bytes.data());
+            return bytes;
+        }
+
+        // Accepts x || y only for an affine point that lies on the curve.
+        bool DecodePoint(const unsigned char* bytes, AffinePoint<N>& point) const
+        {
+            Element x = FromBigEndian<N>(bytes);
+            Element y = FromBigEndian<N>(bytes + N * 8);
+            if (!LessThan(x, Fp::Mod()) || !LessThan(y, Fp::Mod()))
+            {
+                return false;
+            }
+
+            point.x = Fp::ToMontgomery(x);
+            point.y = Fp::ToMontgomery(y);
+            Element rhs = Fp::Mul(Fp::Add(Fp::Sqr(point.x), m_a), point.x);
+            rhs = Fp::Add(rhs, m_b);
+            return Fp::Sqr(point.y) == rhs;
+        }
+
+        // A public key x || y in the working coordinates.
+        bool DecodeKey(const unsigned char* publicKey, size_t size, Point& point) const
+        {
+            AffinePoint<N> affine;
+            return size == 2 * N * 8 && DecodePoint(publicKey, affine) && m_arithmetic.FromAffine(affine, point);
+        }
+
+        // points[w * WINDOW_ENTRIES + j] = (j + 1) * 2^(5w) * B.
+        std::vector<Point> WindowMultiples(const Point& base) const
+        {
+            std::vector<Point> points;
+            points.reserve(WINDOWS * WINDOW_ENTRIES);
+
+            Point windowBase = base;
+            for (size_t w = 0; w < WINDOWS; ++w)
+            {
+                Point multiple = windowBase;
+                points.push_back(multiple);
+                for (size_t j = 1; j < WINDOW_ENTRIES; ++j)
+                {
+                    multiple = m_arithmetic.Add(multiple, windowBase);
+                    points.push_back(multiple);
+                }
+                windowBase = m_arithmetic.Double(multiple);
+            }
+            return points;
+        }
+
+        // The windows of P followed by its odd multiples, converted to table
+        // entries with a single shared inversion.
+        void BuildTable()
+        {
+            Point base;
+            m_arithmetic.FromAffine(m_base, base);
+            std::vector<Point> points = WindowMultiples(base);
+
+            // Odd multiples P, 3P, ..., (2^(w-1) - 1)P for the verification NAF.
+            Point twice = m_arithmetic.Double(base);
+            points.push_back(base);
+            for (size_t j = 1; j < (size_t{ 1 } << (BASE_NAF_WIDTH - 2)); ++j)
+            {
+                points.push_back(m_arithmetic.Add(points.back(), twice));
+            }
+
+            m_table = m_arithmetic.ToEntries(points);
+            m_oddBase.assign(m_table.begin() + WINDOWS * WINDOW_ENTRIES, m_table.end());
+            m_table.resize(WINDOWS * WINDOW_ENTRIES);
+        }
+
+        static unsigned Window(const Element& k, size_t offset)
+        {
+            size_t limb = offset / 64;
+            size_t shift = offset % 64;
+            if (limb >= N)
+            {
+                return 0;
+            }
+
+            uint64_t bits = k[limb] >> shift;
+            if (shift + WINDOW_BITS > 64 && limb + 1 < N)
+            {
+                bits |= k[limb + 1] << (64 - shift);
+            }
+            return static_cast<unsigned>(bits & ((1u << WINDOW_BITS) - 1));
+        }
+
+        // Reads every entry of the window so the access pattern does not depend
+        // on the digit; index 0 gives the identity entry.
+        Entry Lookup(size_t window, unsigned index) const
+        {
+            Entry result = m_arithmetic.IdentityEntry();
+            const Entry* entries = &m_table[window * WINDOW_ENTRIES];
+            for (unsigned j = 0; j < WINDOW_ENTRIES; ++j)
+            {
+                result = Arithmetic::Select(result, entries[j], j + 1 == index);
+            }
+            return result;
+        }
+
+        // Signed digit of window w in [-16, 16]; carry moves into the next window.
+        static int WindowDigit(const Element& k, size_t w, unsigned& carry)
+        {
+            unsigned value = Window(k, w * WINDOW_BITS) + carry;
+            carry = value > WINDOW_ENTRIES ? 1 : 0;
+            return static_cast<int>(value) - static_cast<int>(carry << WINDOW_BITS);
+        }
+
+        // With complete formulas every window costs one addition, zero digits
+        // included, and the sign is applied by selection rather than a branch.
+        Point MulBase(const Element& k) const
+        {
+            Point acc = m_arithmetic.Identity();
+            unsigned carry = 0;
+            for (size_t w = 0; w < WINDOWS; ++w)
+            {
+                int digit = WindowDigit(k, w, carry);
+                if (!Arithmetic::COMPLETE && digit == 0)
+                {
+                    continue;
+                }
+
+                const bool negative = digit < 0;
+                Entry point = Lookup(w, static_cast<unsigned>(negative ? -digit : digit));
+                point = Arithmetic::Select(point, Arithmetic::Negate(point), negative);
+                acc = m_arithmetic.AddMixed(acc, point);
+            }
+            return acc;
+        }
+
+        // acc + k * B from B's window table. For verification only: k is public,
+        // so entries are indexed directly instead of through Lookup.
+        Point AddFixedBase(Point acc, const std::vector<Entry>& table, const Element& k) const
+        {
+            unsigned carry = 0;
+            for (size_t w = 0; w < WINDOWS; ++w)
+            {
+                int digit = WindowDigit(k, w, carry);
+                if (digit == 0)
+                {
+                    continue;
+                }
+
+                const Entry& point = table[w * WINDOW_ENTRIES + static_cast<size_t>(digit < 0 ? -digit : digit) - 1];
+                acc = m_arithmetic.AddMixed(acc, digit < 0 ? Arithmetic::Negate(point) : point);
+            }
+            return acc;
+        }
+
+        // Width-w NAF, least significant digit first: every non-zero digit is odd,
+        // below 2^(w-1) in magnitude and followed by at least w - 1 zeros.
+        static size_t ComputeNaf(const Element& k, size_t width, int* digits)
+        {
+            Limbs<N + 1> value{};
+            for (size_t i = 0; i < N; ++i)
+            {
+                value[i] = k[i];
+            }
+
+            const int modulus = 1 << width;
+            size_t length = 0;
+            while (!IsZero(value))
+            {
+                int digit = 0;
+                if (value[0] & 1)
+                {
+                    digit = static_cast<int>(value[0] & static_cast<uint64_t>(modulus - 1));
+                    if (digit >= modulus / 2)
+                    {
+                        digit -= modulus;
+                    }
+
+                    if (digit > 0)
+                    {
+                        uint64_t borrow = 0;
+                        value[0] = field_detail::SubBorrow(value[0], static_cast<uint64_t>(digit), borrow);
+                        for (size_t i = 1; i <= N; ++i)
+                        {
+                            value[i] = field_detail::SubBorrow(value[i], 0, borrow);
+                        }
+                    }
+                    else
+                    {
+                        uint64_t carry = 0;
+                        value[0] = field_detail::AddCarry(value[0], static_cast<uint64_t>(-digit), carry);
+                        for (size_t i = 1; i <= N; ++i)
+                        {
+                            value[i] = field_detail::AddCarry(value[i], 0, carry);
+                        }
+                    }
+                }
+                digits[length++] = digit;
+
+                for (size_t i = 0; i < N; ++i)
+                {
+                    value[i] = (value[i] >> 1) | (value[i + 1] << 63);
+                }
+                value[N] >>= 1;
+            }
+            return length;
+        }
+
+        // u1 * P + u2 * Q with Straus' trick: both NAFs are walked together so
+        // the two multiplications share a single chain of doublings.
+        Point MulDouble(const Element& u1, const Point& q, const Element& u2) const
+        {
+            int baseDigits[NAF_DIGITS];
+            int pointDigits[NAF_DIGITS];
+            size_t baseLength = ComputeNaf(u1, BASE_NAF_WIDTH, baseDigits);
+            size_t pointLength = ComputeNaf(u2, POINT_NAF_WIDTH, pointDigits);
+
+            Point pointTable[size_t{ 1 } << (POINT_NAF_WIDTH - 2)];
+            pointTable[0] = q;
+            Point twice = m_arithmetic.Double(pointTable[0]);
+            for (size_t j = 1; j < sizeof(pointTable) / sizeof(pointTable[0]); ++j)
+            {
+                pointTable[j] = m_arithmetic.Add(pointTable[j - 1], twice);
+            }
+
+            Point acc = m_arithmetic.Identity();
+            for (size_t i = baseLength > pointLength ? baseLength : pointLength; i-- > 0;)
+            {
+                acc = m_arithmetic.Double(acc);
+
+                int digit = i < baseLength ? baseDigits[i] : 0;
+                if (digit != 0)
+                {
+                    const Entry& point = m_oddBase[static_cast<size_t>(digit < 0 ? -digit : digit) / 2];
+                    acc = m_arithmetic.AddMixed(acc, digit < 0 ? Arithmetic::Negate(point) : point);
+                }
+
+                digit = i < pointLength ? pointDigits[i] : 0;
+                if (digit != 0)
+                {
+                    const Point& point = pointTable[static_cast<size_t>(digit < 0 ? -digit : digit) / 2];
+                    acc = m_arithmetic.Add(acc, digit < 0 ? Arithmetic::Negate(point) : point);
+                }
+            }
+            return acc;
+        }
+
+        Arithmetic m_arithmetic;
+        Element m_a;
+        Element m_b;
+        AffinePoint<N> m_base;
+        std::vector<Entry> m_table;
+        std::vector<Entry> m_oddBase;
+    };
+}
+
+const GostCurve* GostCurve::Find(const std::wstring& parameterSet)
+{
+    return Find(parameterSet.c_str());
+}
+
+const GostCurve* GostCurve::Find(const wchar_t* parameterSet)
+{
+    if (!parameterSet)
+    {
+        return nullptr;
+    }
+    // paramSetA and paramSetC have Edwards forms (RFC 7836) and use them for
+    // all point arithmetic; paramSetB has none.
+    if (std::wcscmp(parameterSet, L"id-tc26-gost-3410-2012-256-paramSetA") == 0)
+    {
+        static const WeierstrassCurve<4, TC26_P256, TC26_Q256_A, EdwardsArithmetic<4, TC26_P256>> curve(TC26_256_A);
+        return &curve;
+    }
+    if (std::wcscmp(parameterSet, L"id-tc26-gost-3410-2012-256-paramSetB") == 0)
+    {
+        static const WeierstrassCurve<4, TC26_P256, TC26_Q256_B, JacobianArithmetic<4, TC26_P256>> curve(TC26_256_B);
+        return &curve;
+    }
+    if (std::wcscmp(parameterSet, L"id-tc26-gost-3410-2012-512-paramSetC") == 0)
+    {
+        static const WeierstrassCurve<8, TC26_P512, TC26_Q512_C, EdwardsArithmetic<8, TC26_P512>> curve(TC26_512_C);
+        return &curve;
+    }
+    return nullptr;
+}
+
+const GostCurve* GostCurve::FindJacobian(const wchar_t* parameterSet)
+{
+    if (!parameterSet)
+    {
+        return nullptr;
+    }
+    if (std::wcscmp(parameterSet, L"id-tc26-gost-3410-2012-256-paramSetA") == 0)
+    {
+        static const WeierstrassCurve<4, TC26_P256, TC26_Q256_A, JacobianArithmetic<4, TC26_P256>> curve(TC26_256_A);
+        return &curve;
+    }
+    if (std::wcscmp(parameterSet, L"id-tc26-gost-3410-2012-512-paramSetC") == 0)
+    {
+        static const WeierstrassCurve<8, TC26_P512, TC26_Q512_C, JacobianArithmetic<8, TC26_P512>> curve(TC26_512_C);
+        return &curve;
+    }
+    return Find(parameterSet);
+}
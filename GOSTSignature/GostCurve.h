@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gost
+{
+    using RandomSource = std::function<void(unsigned char* buffer, size_t size)>;
+
+    // GOST R 34.10-2012 for one tc26 parameter set. Private keys, coordinates and
+    // both signature halves are big-endian and Size() bytes long.
+    class GostCurve
+    {
+    public:
+        virtual ~GostCurve() = default;
+
+        virtual size_t Size() const = 0;
+
+        // Reduces a big-endian private key of any length modulo q into output,
+        // which takes Size() bytes; false for a key that reduces to zero. The
+        // key is only ever read from and written to the caller's buffers, so
+        // they decide where it lives.
+        virtual bool NormalizePrivateKey(const unsigned char* key, size_t size, unsigned char* output) const = 0;
+
+        // Q = d * P encoded as x || y.
+        virtual std::vector<unsigned char> PublicKey(const unsigned char* privateKey) const = 0;
+
+        // Returns r || s. The digest is read as a little-endian integer, which is
+        // how GOST R 34.11-2012 lays out its output vector.
+        virtual std::vector<unsigned char> Sign(
+            const std::vector<unsigned char>& digest,
+            const unsigned char* privateKey,
+            const RandomSource& random) const = 0;
+
+        // Checks r || s over the digest against the public key x || y. Malformed
+        // signatures and keys that are not on the curve are rejected, not reported.
+        // Takes plain buffers so a parsed container is checked in place.
+        virtual bool Verify(
+            const std::vector<unsigned char>& digest,
+            const unsigned char* signature,
+            size_t signatureSize,
+            const unsigned char* publicKey,
+            size_t publicKeySize) const = 0;
+
+        bool Verify(
+            const std::vector<unsigned char>& digest,
+            const std::vector<unsigned char>& signature,
+            const std::vector<unsigned char>& publicKey) const
+        {
+            return Verify(digest, signature.data(), signature.size(), publicKey.data(), publicKey.size());
+        }
+
+        // A public key decoded and checked once, for VerifyBatch. With a table it
+        // also carries fixed-base windows like those kept for P: building them
+        // costs about five verifications, after which every signature under the
+        // key is checked without any point doublings.
+        class PreparedKey
+        {
+        public:
+            virtual ~PreparedKey() = default;
+        };
+
+        // nullptr if the key x || y is malformed or not on the curve.
+        virtual std::unique_ptr<PreparedKey> PrepareKey(const std::vector<unsigned char>& publicKey, bool withTable) const = 0;
+
+        struct BatchEntry
+        {
+            const std::vector<unsigned char>* digest;
+            const std::vector<unsigned char>* signature;
+            // From PrepareKey on this curve.
+            const PreparedKey* key;
+        };
+
+        // Verify for every entry, in order. The digest inverses share a single
+        // field inversion.
+        virtual std::vector<bool> VerifyBatch(const std::vector<BatchEntry>& entries) const = 0;
+
+        // Curves and their fixed-base tables are built on first use and then
+        // shared read-only between threads. Returns nullptr for unknown sets.
+        static const GostCurve* Find(const std::wstring& parameterSet);
+        static const GostCurve* Find(const wchar_t* parameterSet);
+
+        // The same curves with all point arithmetic in Jacobian coordinates,
+        // even where Find uses the Edwards form; for checking one against the
+        // other. paramSetB returns the curve Find returns.
+        static const GostCurve* FindJacobian(const wchar_t* parameterSet);
+    };
+}
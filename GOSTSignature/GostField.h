@@ -0,0 +1,533 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define GOST_FORCEINLINE __forceinline
+#else
+#define GOST_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+namespace gost
+{
+    template <size_t N>
+    using Limbs = std::array<uint64_t, N>;
+
+    namespace field_detail
+    {
+        // ---------------- Compile-time helpers ----------------
+        constexpr uint64_t HexDigit(char c)
+        {
+            return c <= '9' ? static_cast<uint64_t>(c - '0') : static_cast<uint64_t>((c | 0x20) - 'a' + 10);
+        }
+
+        template <size_t N>
+        constexpr Limbs<N> ParseHex(const char* hex)
+        {
+            Limbs<N> value{};
+            size_t length = 0;
+            while (hex[length] != '\0')
+            {
+                ++length;
+            }
+            for (size_t i = 0; i < length && i < N * 16; ++i)
+            {
+                value[i / 16] |= HexDigit(hex[length - 1 - i]) << (4 * (i % 16));
+            }
+            return value;
+        }
+
+        // Portable 64x64 -> 128 product; only used while deriving constants.
+        constexpr uint64_t ConstMulWide(uint64_t a, uint64_t b, uint64_t& hi)
+        {
+            uint64_t ll = (a & 0xFFFFFFFFu) * (b & 0xFFFFFFFFu);
+            uint64_t lh = (a & 0xFFFFFFFFu) * (b >> 32);
+            uint64_t hl = (a >> 32) * (b & 0xFFFFFFFFu);
+            uint64_t hh = (a >> 32) * (b >> 32);
+            uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFFu) + (hl & 0xFFFFFFFFu);
+            hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+            return (mid << 32) | (ll & 0xFFFFFFFFu);
+        }
+
+        template <size_t N>
+        constexpr bool ConstLess(const Limbs<N>& a, const Limbs<N>& b)
+        {
+            for (size_t i = N; i-- > 0;)
+            {
+                if (a[i] != b[i])
+                {
+                    return a[i] < b[i];
+                }
+            }
+            return false;
+        }
+
+        template <size_t N>
+        constexpr Limbs<N> ConstSub(const Limbs<N>& a, const Limbs<N>& b)
+        {
+            Limbs<N> r{};
+            uint64_t borrow = 0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                uint64_t d = a[i] - b[i];
+                uint64_t nextBorrow = (a[i] < b[i]) || (d < borrow) ? 1 : 0;
+                r[i] = d - borrow;
+                borrow = nextBorrow;
+            }
+            return r;
+        }
+
+        template <size_t N>
+        constexpr Limbs<N> ConstAddMod(const Limbs<N>& a, const Limbs<N>& b, const Limbs<N>& m)
+        {
+            Limbs<N> r{};
+            uint64_t carry = 0;
+            for (size_t i = 0; i < N; ++i)
+            {
+                uint64_t s = a[i] + carry;
+                uint64_t nextCarry = s < carry ? 1 : 0;
+                s += b[i];
+                nextCarry |= s < b[i] ? 1 : 0;
+                r[i] = s;
+                carry = nextCarry;
+            }
+            return carry || !ConstLess(r, m) ? ConstSub(r, m) : r;
+        }
+
+        // -m^-1 mod 2^64 by Newton iteration.
+        template <size_t N>
+        constexpr uint64_t NegInverse(const Limbs<N>& m)
+        {
+            uint64_t inverse = 1;
+            for (int i = 0; i < 6; ++i)
+            {
+                inverse *= 2 - m[0] * inverse;
+            }
+            return ~inverse + 1;
+        }
+
+        // 2^(64N) mod m, starting from the two's complement of m.
+        template <size_t N>
+        constexpr Limbs<N> RModM(const Limbs<N>& m)
+        {
+            Limbs<N> r = ConstSub(Limbs<N>{}, m);
+            while (!ConstLess(r, m))
+            {
+                r = ConstSub(r, m);
+            }
+            return r;
+        }
+
+        template <size_t N>
+        constexpr Limbs<N> ConstMontMul(const Limbs<N>& a, const Limbs<N>& b, const Limbs<N>& m, uint64_t n0)
+        {
+            uint64_t t[N + 2] = {};
+            for (size_t i = 0; i < N; ++i)
+            {
+                uint64_t carry = 0;
+                for (size_t j = 0; j < N; ++j)
+                {
+                    uint64_t hi = 0;
+                    uint64_t lo = ConstMulWide(a[j], b[i], hi);
+                    lo += t[j];
+                    hi += lo < t[j] ? 1 : 0;
+                    lo += carry;
+                    hi += lo < carry ? 1 : 0;
+                    t[j] = lo;
+                    carry = hi;
+                }
+                t[N] += carry;
+                t[N + 1] = t[N] < carry ? 1 : 0;
+
+                uint64_t q = t[0] * n0;
+                carry = 0;
+                for (size_t j = 0; j < N; ++j)
+                {
+                    uint64_t hi = 0;
+                    uint64_t lo = ConstMulWide(q, m[j], hi);
+                    lo += t[j];
+                    hi += lo < t[j] ? 1 : 0;
+                    lo += carry;
+                    hi += lo < carry ? 1 : 0;
+                    if (j > 0)
+                    {
+                        t[j - 1] = lo;
+                    }
+                    carry = hi;
+                }
+                t[N - 1] = t[N] + carry;
+                t[N] = t[N + 1] + (t[N - 1] < carry ? 1 : 0);
+            }
+
+            Limbs<N> r{};
+            for (size_t i = 0; i < N; ++i)
+            {
+                r[i] = t[i];
+            }
+            return t[N] || !ConstLess(r, m) ? ConstSub(r, m) : r;
+        }
+
+        // R^2 mod m: the Montgomery form of 2 squared log2(64N) times is the
+        // Montgomery form of 2^(64N) = R, i.e. R^2 mod m.
+        template <size_t N>
+        constexpr Limbs<N> R2ModM(const Limbs<N>& m)
+        {
+            static_assert((N & (N - 1)) == 0, "limb count must be a power of two");
+            const uint64_t n0 = NegInverse(m);
+            Limbs<N> one = RModM(m);
+            Limbs<N> x = ConstAddMod(one, one, m);
+            for (size_t bits = 1; bits < 64 * N; bits *= 2)
+            {
+                x = ConstMontMul(x, x, m, n0);
+            }
+            return x;
+        }
+
+        // ---------------- Runtime word primitives ----------------
+        GOST_FORCEINLINE uint64_t MulWide(uint64_t a, uint64_t b, uint64_t& hi)
+        {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+            hi = static_cast<uint64_t>(product >> 64);
+            return static_cast<uint64_t>(product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            return _umul128(a, b, &hi);
+#else
+            return ConstMulWide(a, b, hi);
+#endif
+        }
+
+        // Low word of a * b + c + d; the high word goes to hi. Never overflows.
+        GOST_FORCEINLINE uint64_t MulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& hi)
+        {
+#if defined(__SIZEOF_INT128__)
+            unsigned __int128 r = static_cast<unsigned __int128>(a) * b + c + d;
+            hi = static_cast<uint64_t>(r >> 64);
+            return static_cast<uint64_t>(r);
+#else
+            uint64_t lo = MulWide(a, b, hi);
+            lo += c;
+            hi += lo < c ? 1 : 0;
+            lo += d;
+            hi += lo < d ? 1 : 0;
+            return lo;
+#endif
+        }
+
+        GOST_FORCEINLINE uint64_t AddCarry(uint64_t a, uint64_t b, uint64_t& carry)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long long sum;
+            carry = _addcarry_u64(static_cast<unsigned char>(carry), a, b, &sum);
+            return sum;
+#elif defined(__SIZEOF_INT128__)
+            unsigned __int128 r = static_cast<unsigned __int128>(a) + b + carry;
+            carry = static_cast<uint64_t>(r >> 64);
+            return static_cast<uint64_t>(r);
+#else
+            uint64_t sum = a + carry;
+            uint64_t carryOut = sum < carry ? 1 : 0;
+            sum += b;
+            carryOut |= sum < b ? 1 : 0;
+            carry = carryOut;
+            return sum;
+#endif
+        }
+
+        GOST_FORCEINLINE uint64_t SubBorrow(uint64_t a, uint64_t b, uint64_t& borrow)
+        {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long long diff;
+            borrow = _subborrow_u64(static_cast<unsigned char>(borrow), a, b, &diff);
+            return diff;
+#elif defined(__SIZEOF_INT128__)
+            unsigned __int128 r = static_cast<unsigned __int128>(a) - b - borrow;
+            borrow = static_cast<uint64_t>(r >> 64) & 1;
+            return static_cast<uint64_t>(r);
+#else
+            uint64_t diff = a - b;
+            uint64_t borrowOut = a < b ? 1 : 0;
+            borrowOut |= diff < borrow ? 1 : 0;
+            diff -= borrow;
+            borrow = borrowOut;
+            return diff;
+#endif
+        }
+
+        template <typename F, size_t... I>
+        GOST_FORCEINLINE void UnrollImpl(F&& f, std::index_sequence<I...>)
+        {
+            (f(std::integral_constant<size_t, I>{}), ...);
+        }
+
+        // Calls f(0) ... f(Count - 1) with compile-time indices, so every limb
+        // loop is emitted straight-line for the given limb count.
+        template <size_t Count, typename F>
+        GOST_FORCEINLINE void Unroll(F&& f)
+        {
+            UnrollImpl(f, std::make_index_sequence<Count>{});
+        }
+    }
+
+    // ---------------- tc26 moduli ----------------
+    inline constexpr Limbs<4> TC26_P256 = field_detail::ParseHex<4>(
+        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFD97");
+    inline constexpr Limbs<4> TC26_Q256_A = field_detail::ParseHex<4>(
+        "400000000000000000000000000000000FD8CDDFC87B6635C115AF556C360C67");
+    inline constexpr Limbs<4> TC26_Q256_B = field_detail::ParseHex<4>(
+        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF6C611070995AD10045841B09B761B893");
+    inline constexpr Limbs<8> TC26_P512 = field_detail::ParseHex<8>(
+        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+        "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFDC7");
+    inline constexpr Limbs<8> TC26_Q512_C = field_detail::ParseHex<8>(
+        "3FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+        "C98CDBA46506AB004C33A9FF5147502CC8EDA9E7A769A12694623CEF47F023ED");
+
+    template <size_t N>
+    GOST_FORCEINLINE bool IsZero(const Limbs<N>& a)
+    {
+        uint64_t acc = 0;
+        field_detail::Unroll<N>([&](auto i) { acc |= a[i]; });
+        return acc == 0;
+    }
+
+    template <size_t N>
+    GOST_FORCEINLINE bool LessThan(const Limbs<N>& a, const Limbs<N>& b)
+    {
+        uint64_t borrow = 0;
+        field_detail::Unroll<N>([&](auto i) { field_detail::SubBorrow(a[i], b[i], borrow); });
+        return borrow != 0;
+    }
+
+    // Arithmetic modulo a fixed odd modulus in Montgomery form (x * 2^(64N) mod m).
+    // Every (limb count, modulus) pair gets its own straight-line code with the
+    // modulus words and Montgomery constants folded in as immediates.
+    template <size_t N, const Limbs<N>& Modulus>
+    class MontgomeryField
+    {
+    public:
+        using Element = Limbs<N>;
+
+        static constexpr size_t LIMBS = N;
+        static constexpr uint64_t N0 = field_detail::NegInverse(Modulus);
+        static constexpr Element ONE = field_detail::RModM(Modulus);
+        static constexpr Element R2 = field_detail::R2ModM(Modulus);
+
+        static constexpr const Element& Mod() { return Modulus; }
+        static constexpr const Element& One() { return ONE; }
+
+        static GOST_FORCEINLINE Element Add(const Element& a, const Element& b)
+        {
+            Element sum;
+            uint64_t carry = 0;
+            field_detail::Unroll<N>([&](auto i) { sum[i] = field_detail::AddCarry(a[i], b[i], carry); });
+            return ReduceOnce(sum, carry);
+        }
+
+        static GOST_FORCEINLINE Element Sub(const Element& a, const Element& b)
+        {
+            Element diff;
+            uint64_t borrow = 0;
+            field_detail::Unroll<N>([&](auto i) { diff[i] = field_detail::SubBorrow(a[i], b[i], borrow); });
+
+            const uint64_t mask = 0 - borrow;
+            uint64_t carry = 0;
+            field_detail::Unroll<N>([&](auto i) { diff[i] = field_detail::AddCarry(diff[i], Modulus[i] & mask, carry); });
+            return diff;
+        }
+
+        static GOST_FORCEINLINE Element Neg(const Element& a)
+        {
+            return Sub(Element{}, a);
+        }
+
+        static GOST_FORCEINLINE Element Double(const Element& a)
+        {
+            return Add(a, a);
+        }
+
+        // CIOS: multiplication and reduction interleaved word by word.
+        static Element Mul(const Element& a, const Element& b)
+        {
+            uint64_t t[N + 2] = {};
+            field_detail::Unroll<N>([&](auto i)
+            {
+                uint64_t carry = 0;
+                field_detail::Unroll<N>([&](auto j) { t[j] = field_detail::MulAdd(a[j], b[i], t[j], carry, carry); });
+                uint64_t top = 0;
+                t[N] = field_detail::AddCarry(t[N], carry, top);
+                t[N + 1] = top;
+
+                const uint64_t m = t[0] * N0;
+                field_detail::MulAdd(m, Modulus[0], t[0], 0, carry);
+                field_detail::Unroll<N - 1>([&](auto j) { t[j] = field_detail::MulAdd(m, Modulus[j + 1], t[j + 1], carry, carry); });
+                top = 0;
+                t[N - 1] = field_detail::AddCarry(t[N], carry, top);
+                t[N] = t[N + 1] + top;
+            });
+
+            Element result;
+            field_detail::Unroll<N>([&](auto i) { result[i] = t[i]; });
+            return ReduceOnce(result, t[N]);
+        }
+
+        // Squaring computes each cross product once and doubles it, then reduces
+        // the 2N-word square with a separate Montgomery reduction.
+        static Element Sqr(const Element& a)
+        {
+            uint64_t t[2 * N] = {};
+            field_detail::Unroll<N - 1>([&](auto i)
+            {
+                constexpr size_t I = decltype(i)::value;
+                uint64_t carry = 0;
+                field_detail::Unroll<N>([&](auto j)
+                {
+                    if constexpr (decltype(j)::value > I)
+                    {
+                        t[I + j] = field_detail::MulAdd(a[I], a[j], t[I + j], carry, carry);
+                    }
+                });
+                t[I + N] = carry;
+            });
+
+            uint64_t shifted = 0;
+            field_detail::Unroll<2 * N>([&](auto i)
+            {
+                uint64_t next = t[i] >> 63;
+                t[i] = (t[i] << 1) | shifted;
+                shifted = next;
+            });
+
+            uint64_t carry = 0;
+            field_detail::Unroll<N>([&](auto i)
+            {
+                uint64_t hi = 0;
+                uint64_t lo = field_detail::MulWide(a[i], a[i], hi);
+                t[2 * i] = field_detail::AddCarry(t[2 * i], lo, carry);
+                t[2 * i + 1] = field_detail::AddCarry(t[2 * i + 1], hi, carry);
+            });
+
+            return Reduce(t);
+        }
+
+        // Accepts any value below 2^(64N), not only reduced ones.
+        static Element ToMontgomery(const Element& a)
+        {
+            return Mul(a, R2);
+        }
+
+        static Element FromMontgomery(const Element& a)
+        {
+            uint64_t t[2 * N] = {};
+            field_detail::Unroll<N>([&](auto i) { t[i] = a[i]; });
+            return Reduce(t);
+        }
+
+        // Montgomery form of an arbitrary-length little-endian integer, reduced mod m.
+        static Element FromLittleEndian(const unsigned char* bytes, size_t size)
+        {
+            const size_t blockBytes = N * 8;
+            size_t blocks = (size + blockBytes - 1) / blockBytes;
+            Element acc{};
+            for (size_t b = blocks; b-- > 0;)
+            {
+                Element block{};
+                for (size_t i = 0; i < blockBytes && b * blockBytes + i < size; ++i)
+                {
+                    block[i / 8] |= static_cast<uint64_t>(bytes[b * blockBytes + i]) << (8 * (i % 8));
+                }
+                acc = Add(Mul(acc, R2), ToMontgomery(block));
+            }
+            return acc;
+        }
+
+        // The same for a big-endian integer.
+        static Element FromBigEndian(const unsigned char* bytes, size_t size)
+        {
+            const size_t blockBytes = N * 8;
+            size_t blocks = (size + blockBytes - 1) / blockBytes;
+            Element acc{};
+            for (size_t b = blocks; b-- > 0;)
+            {
+                Element block{};
+                for (size_t i = 0; i < blockBytes && b * blockBytes + i < size; ++i)
+                {
+                    block[i / 8] |= static_cast<uint64_t>(bytes[size - 1 - (b * blockBytes + i)]) << (8 * (i % 8));
+                }
+                acc = Add(Mul(acc, R2), ToMontgomery(block));
+            }
+            return acc;
+        }
+
+        // Exponent is public (Fermat inversion, square roots), so the ladder may branch on it.
+        static Element Pow(const Element& base, const Element& exponent)
+        {
+            Element result = ONE;
+            for (size_t i = 64 * N; i-- > 0;)
+            {
+                result = Sqr(result);
+                if ((exponent[i / 64] >> (i % 64)) & 1)
+                {
+                    result = Mul(result, base);
+                }
+            }
+            return result;
+        }
+
+        static Element Inv(const Element& a)
+        {
+            return Pow(a, INVERSE_EXPONENT);
+        }
+
+        static GOST_FORCEINLINE Element Select(const Element& a, const Element& b, bool chooseB)
+        {
+            const uint64_t mask = 0 - static_cast<uint64_t>(chooseB);
+            Element r;
+            field_detail::Unroll<N>([&](auto i) { r[i] = a[i] ^ ((a[i] ^ b[i]) & mask); });
+            return r;
+        }
+
+    private:
+        static constexpr Element INVERSE_EXPONENT = field_detail::ConstSub(Modulus, Element{ 2 });
+
+        static GOST_FORCEINLINE Element ReduceOnce(const Element& a, uint64_t carry)
+        {
+            Element reduced;
+            uint64_t borrow = 0;
+            field_detail::Unroll<N>([&](auto i) { reduced[i] = field_detail::SubBorrow(a[i], Modulus[i], borrow); });
+
+            // Keep a only when it was already below m and nothing carried out.
+            const uint64_t keep = 0 - (borrow & (carry ^ 1));
+            Element result;
+            field_detail::Unroll<N>([&](auto i) { result[i] = (a[i] & keep) | (reduced[i] & ~keep); });
+            return result;
+        }
+
+        // Montgomery reduction of a 2N-word value below m * 2^(64N).
+        static GOST_FORCEINLINE Element Reduce(uint64_t (&t)[2 * N])
+        {
+            uint64_t extra = 0;
+            field_detail::Unroll<N>([&](auto i)
+            {
+                const uint64_t m = t[i] * N0;
+                uint64_t carry = 0;
+                field_detail::Unroll<N>([&](auto j) { t[i + j] = field_detail::MulAdd(m, Modulus[j], t[i + j], carry, carry); });
+                uint64_t c = extra;
+                t[i + N] = field_detail::AddCarry(t[i + N], carry, c);
+                extra = c;
+            });
+
+            Element result;
+            field_detail::Unroll<N>([&](auto i) { result[i] = t[i + N]; });
+            return ReduceOnce(result, extra);
+        }
+    };
+}
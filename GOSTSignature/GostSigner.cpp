@@ -0,0 +1,1220 @@
+#include "GostSigner.h"
+#include "Drbg.h"
+#include "FilePath.h"
+#include "GostCurve.h"
+#include "HashBackend.h"
+#include "HashBatch.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace gost;
+
+namespace
+{
+    // Keeps reading until the buffer is full or the source ends.
+    size_t ReadFull(ByteSource& source, unsigned char* buffer, size_t size)
+    {
+        size_t total = 0;
+        while (total < size)
+        {
+            size_t count = source.Read(buffer + total, size - total);
+            if (count == 0)
+            {
+                break;
+            }
+            total += count;
+        }
+        return total;
+    }
+
+    // Hex from a text field: surrounding whitespace is ignored, anything else
+    // must be hex digits.
+    std::optional<std::vector<unsigned char>> ParseHexField(const std::wstring& text)
+    {
+        const wchar_t* spaces = L" \t\r\n";
+        size_t first = text.find_first_not_of(spaces);
+        if (first == std::wstring::npos)
+        {
+            return std::vector<unsigned char>();
+        }
+        size_t last = text.find_last_not_of(spaces);
+        return ParseHex(std::wstring_view(text).substr(first, last - first + 1));
+    }
+
+    // ParseHexField for secrets: decodes straight into output, so the bytes
+    // never pass through the heap.
+    bool ParseSecretHexField(const std::wstring& text, SecureBytes& output)
+    {
+        const wchar_t* spaces = L" \t\r\n";
+        size_t first = text.find_first_not_of(spaces);
+        if (first == std::wstring::npos)
+        {
+            output.clear();
+            return true;
+        }
+        size_t size = text.find_last_not_of(spaces) - first + 1;
+        if (size % 2 != 0)
+        {
+            return false;
+        }
+        output.resize(size / 2);
+        return DecodeHex(text.data() + first, size, output.data());
+    }
+
+    // The key from a hex field, reduced modulo q into privateKey (Size() bytes
+    // from the same arena); false with error set otherwise.
+    bool ParsePrivateKey(const GostCurve& curve, const std::wstring& privateKeyHex, SecureBytes& privateKey, std::wstring& error)
+    {
+        SecureBytes keyBytes{ privateKey.get_allocator() };
+        bool parsed = ParseSecretHexField(privateKeyHex, keyBytes);
+        if (parsed && keyBytes.empty())
+        {
+            error = L"Приватный ключ не задан";
+            return false;
+        }
+
+        privateKey.assign(curve.Size(), 0);
+        if (!parsed || !curve.NormalizePrivateKey(keyBytes.data(), keyBytes.size(), privateKey.data()))
+        {
+            error = L"Недопустимый приватный ключ";
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<unsigned char> SignDigest(const GostCurve& curve, const std::vector<unsigned char>& hash, const unsigned char* privateKey, NonceMode nonceMode)
+    {
+        if (nonceMode == NonceMode::Deterministic)
+        {
+            // The curve reads the digest as a little-endian integer; the generator
+            // takes it big-endian like the key, as RFC 6979 does.
+            std::vector<unsigned char> message(hash.rbegin(), hash.rend());
+            HmacDrbg drbg(curve.Size(), privateKey, curve.Size(), message.data(), message.size());
+            return curve.Sign(hash, privateKey, [&drbg](unsigned char* buffer, size_t size)
+            {
+                drbg.Generate(buffer, size);
+            });
+        }
+
+        return curve.Sign(hash, privateKey, [](unsigned char* buffer, size_t size)
+        {
+            ChaChaDrbg::ForThread().Generate(buffer, size);
+        });
+    }
+}
+
+std::vector<GostParameters> GostSigner::DefaultParameterSets()
+{
+    return {
+        {L"id-tc26-gost-3410-2012-256-paramSetA", L"P-256", L"CryptoPro CSP"},
+        {L"id-tc26-gost-3410-2012-256-paramSetB", L"P-256", L"CryptoPro CSP"},
+        {L"id-tc26-gost-3410-2012-512-paramSetC", L"P-512", L"CryptoPro CSP"}
+    };
+}
+
+std::vector<std::wstring> GostSigner::SupportedHashes()
+{
+    return HashBackend::Instance().Names();
+}
+
+// Progress of one asynchronous operation, shared by every signer working on it.
+struct GostSigner::Progress
+{
+    ProgressCallback onProgress;
+    CancellationToken cancellation;
+    unsigned long long totalBytes = 0;
+    std::atomic<unsigned long long> hashedBytes{ 0 };
+    std::mutex reportMutex;
+
+    void Advance(unsigned long long bytes)
+    {
+        unsigned long long hashed = hashedBytes += bytes;
+        if (onProgress)
+        {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            onProgress(hashed, totalBytes);
+        }
+    }
+};
+
+SecureArena& GostSigner::Arena()
+{
+    if (!m_arena)
+    {
+        m_arena = std::make_unique<SecureArena>();
+    }
+    return *m_arena;
+}
+
+bool GostSigner::Cancelled()
+{
+    if (m_progress && m_progress->cancellation.IsCancelled())
+    {
+        m_lastError = L"Операция отменена";
+        return true;
+    }
+    return false;
+}
+
+template <typename Update>
+bool GostSigner::HashChunks(ByteSource& source, bool reportProgress, Update update)
+{
+    m_readBuffer.resize(READ_CHUNK_SIZE);
+    unsigned long long totalBytes = 0;
+    const unsigned char* chunk = nullptr;
+    size_t count = 0;
+    while ((count = source.Next(chunk, m_readBuffer.data(), m_readBuffer.size())) > 0)
+    {
+        // Mapped sources hand out whole views; progress and cancellation still
+        // move in READ_CHUNK_SIZE steps.
+        for (size_t offset = 0; offset < count; offset += READ_CHUNK_SIZE)
+        {
+            size_t size = std::min(count - offset, READ_CHUNK_SIZE);
+            if (Cancelled())
+            {
+                return false;
+            }
+            if (!update(chunk + offset, size))
+            {
+                m_lastError = L"Ошибка обновления хеша";
+                return false;
+            }
+            if (reportProgress && m_progress)
+            {
+                m_progress->Advance(size);
+            }
+        }
+        totalBytes += count;
+    }
+
+    if (source.Failed())
+    {
+        m_lastError = L"Ошибка чтения данных";
+        return false;
+    }
+
+    if (totalBytes == 0)
+    {
+        m_lastError = L"Файл пустой";
+        return false;
+    }
+    return true;
+}
+
+std::optional<std::vector<unsigned char>> GostSigner::ComputeHash(ByteSource& source, const std::wstring& hashName, bool reportProgress)
+{
+    auto context = HashBackend::Instance().Acquire(hashName);
+    if (!context)
+    {
+        m_lastError = L"Не удалось открыть алгоритм хеширования";
+        return std::nullopt;
+    }
+
+    bool hashed = HashChunks(source, reportProgress, [&context](const unsigned char* data, size_t size)
+    {
+        return context->Update(data, size);
+    });
+    if (!hashed)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<unsigned char> hash(context->DigestSize());
+    if (!context->Finish(hash.data()))
+    {
+        m_lastError = L"Ошибка завершения хеша";
+        return std::nullopt;
+    }
+    return hash;
+}
+
+std::vector<unsigned char> GostSigner::MakeSignature(const GostCurve& curve, const std::vector<unsigned char>& hash, const SecureBytes& privateKey, NonceMode nonceMode)
+{
+    return SignDigest(curve, hash, privateKey.data(), nonceMode);
+}
+
+std::vector<unsigned char> GostSigner::DerivePublicKey(const GostCurve& curve, const SecureBytes& privateKey)
+{
+    return curve.PublicKey(privateKey.data());
+}
+
+template <typename Hasher>
+GostSignature GostSigner::SignWith(
+    const GostParameters& parameters,
+    const std::wstring& privateKeyHex,
+    const std::wstring& hashName,
+    NonceMode nonceMode,
+    Hasher computeHash)
+{
+    GostSignature signature{};
+    signature.parameterSet = parameters.name;
+    signature.hashAlgorithm = hashName;
+
+    const GostCurve* curve = GostCurve::Find(parameters.name);
+    if (!curve)
+    {
+        signature.statusMessage = L"Неизвестный набор параметров";
+        return signature;
+    }
+
+    // Everything derived from the key lives in the arena and is wiped on return.
+    SecureArena& arena = Arena();
+    SecureArena::Scope scope(arena);
+    SecureBytes privateKey{ ArenaAllocator<unsigned char>(arena) };
+    if (!ParsePrivateKey(*curve, privateKeyHex, privateKey, signature.statusMessage))
+    {
+        return signature;
+    }
+
+    auto hash = computeHash();
+    if (!hash)
+    {
+        signature.statusMessage = m_lastError;
+        return signature;
+    }
+
+    auto signBlob = MakeSignature(*curve, *hash, privateKey, nonceMode);
+    auto publicKey = DerivePublicKey(*curve, privateKey);
+
+    signature.signatureHex = FormatHex(signBlob);
+    signature.publicKeyHex = FormatHex(publicKey);
+    signature.signedAt = static_cast<long long>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    signature.statusMessage = L"Подпись сформирована (ГОСТ Р 34.10-2012)";
+    return signature;
+}
+
+GostSignature GostSigner::SignFile(
+    const std::wstring& path,
+    const GostParameters& parameters,
+    const std::wstring& privateKeyHex,
+    const std::wstring& hashName,
+    NonceMode nonceMode,
+    FileInputMode inputMode)
+{
+    return SignWith(parameters, privateKeyHex, hashName, nonceMode, [&]
+    {
+        return HashFile(path, hashName, inputMode);
+    });
+}
+
+std::optional<std::vector<unsigned char>> GostSigner::HashFile(const std::wstring& path, const std::wstring& hashName, FileInputMode inputMode)
+{
+    std::optional<FileStamp> stamp;
+    if (m_hashCache && m_hashCache->IsOpen())
+    {
+        stamp = FileStamp::Of(path);
+        if (stamp)
+        {
+            if (auto cached = m_hashCache->Lookup(path, *stamp, hashName))
+            {
+                if (m_progress)
+                {
+                    m_progress->Advance(stamp->size);
+                }
+                return cached;
+            }
+        }
+    }
+
+    auto readAndHash = [&]() -> std::optional<std::vector<unsigned char>>
+    {
+        if (inputMode == FileInputMode::Mapped)
+        {
+            MappedFileSource mapped(path);
+            if (mapped.IsMapped())
+            {
+                return ComputeHash(mapped, hashName, true);
+            }
+        }
+
+        FileByteSource source(path);
+        if (!source.IsOpen())
+        {
+            m_lastError = L"Не удалось открыть файл";
+            return std::nullopt;
+        }
+        return ComputeHash(source, hashName, true);
+    };
+
+    auto hash = readAndHash();
+
+    // Only a file whose stamp did not move while it was being read is cached.
+    if (hash && stamp && stamp->settled && FileStamp::Of(path) == stamp)
+    {
+        m_hashCache->Store(path, *stamp, hashName, *hash);
+    }
+    return hash;
+}
+
+std::vector<GostSignature> GostSigner::SignFileMulti(
+    const std::wstring& path,
+    const std::vector<GostParameters>& parameterSets,
+    const std::wstring& privateKeyHex,
+    const std::vector<std::wstring>& hashNames,
+    NonceMode nonceMode,
+    FileInputMode inputMode)
+{
+    auto digests = HashFileMulti(path, hashNames, inputMode);
+
+    std::vector<GostSignature> signatures;
+    signatures.reserve(parameterSets.size() * hashNames.size());
+    for (const auto& parameters : parameterSets)
+    {
+        for (size_t i = 0; i < hashNames.size(); ++i)
+        {
+            signatures.push_back(SignWith(parameters, privateKeyHex, hashNames[i], nonceMode, [&]
+            {
+                return digests[i];
+            }));
+        }
+    }
+    return signatures;
+}
+
+std::vector<std::optional<std::vector<unsigned char>>> GostSigner::HashFileMulti(const std::wstring& path, const std::vector<std::wstring>& hashNames, FileInputMode inputMode)
+{
+    std::vector<std::optional<std::vector<unsigned char>>> digests(hashNames.size());
+    std::optional<FileStamp> stamp;
+    if (m_hashCache && m_hashCache->IsOpen())
+    {
+        stamp = FileStamp::Of(path);
+    }
+
+    // Each name still to compute, once; the rest come from the cache.
+    std::vector<std::wstring> pending;
+    for (size_t i = 0; i < hashNames.size(); ++i)
+    {
+        if (stamp)
+        {
+            digests[i] = m_hashCache->Lookup(path, *stamp, hashNames[i]);
+        }
+        if (!digests[i] && std::find(pending.begin(), pending.end(), hashNames[i]) == pending.end())
+        {
+            pending.push_back(hashNames[i]);
+        }
+    }
+    if (pending.empty())
+    {
+        return digests;
+    }
+
+    std::vector<HashBackend::Lease> contexts;
+    for (const auto& name : pending)
+    {
+        auto context = HashBackend::Instance().Acquire(name);
+        if (!context)
+        {
+            m_lastError = L"Не удалось открыть алгоритм хеширования";
+            return digests;
+        }
+        contexts.push_back(std::move(context));
+    }
+
+    // One thread per context, as far as the hardware allows; a single hash
+    // is updated inline.
+    const size_t threads = std::min<size_t>(contexts.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::unique_ptr<WorkStealingPool> pool;
+    if (threads > 1)
+    {
+        pool = std::make_unique<WorkStealingPool>(threads);
+    }
+    std::vector<char> updated(contexts.size());
+    auto update = [&](const unsigned char* data, size_t size)
+    {
+        if (!pool)
+        {
+            return std::all_of(contexts.begin(), contexts.end(), [&](HashBackend::Lease& context)
+            {
+                return context->Update(data, size);
+            });
+        }
+        pool->ParallelFor(contexts.size(), [&](size_t index, size_t)
+        {
+            updated[index] = contexts[index]->Update(data, size);
+        });
+        return std::all_of(updated.begin(), updated.end(), [](char ok) { return ok != 0; });
+    };
+
+    bool hashed = false;
+    bool mappedRead = false;
+    if (inputMode == FileInputMode::Mapped)
+    {
+        MappedFileSource mapped(path);
+        if (mapped.IsMapped())
+        {
+            mappedRead = true;
+            hashed = HashChunks(mapped, true, update);
+        }
+    }
+    if (!mappedRead)
+    {
+        FileByteSource source(path);
+        if (!source.IsOpen())
+        {
+            m_lastError = L"Не удалось открыть файл";
+            return digests;
+        }
+        hashed = HashChunks(source, true, update);
+    }
+    if (!hashed)
+    {
+        return digests;
+    }
+
+    // Only a file whose stamp did not move while it was being read is cached.
+    const bool store = stamp && stamp->settled && FileStamp::Of(path) == stamp;
+    for (size_t k = 0; k < pending.size(); ++k)
+    {
+        std::vector<unsigned char> hash(contexts[k]->DigestSize());
+        if (!contexts[k]->Finish(hash.data()))
+        {
+            m_lastError = L"Ошибка завершения хеша";
+            continue;
+        }
+        if (store)
+        {
+            m_hashCache->Store(path, *stamp, pending[k], hash);
+        }
+        for (size_t i = 0; i < hashNames.size(); ++i)
+        {
+            if (!digests[i] && hashNames[i] == pending[k])
+            {
+                digests[i] = hash;
+            }
+        }
+    }
+    return digests;
+}
+
+std::vector<GostSignature> GostSigner::SignFiles(
+    const std::vector<std::wstring>& paths,
+    const GostParameters& parameters,
+    const std::wstring& privateKeyHex,
+    const std::wstring& hashName,
+    const BatchOptions& options)
+{
+    std::vector<GostSignature> results(paths.size());
+    if (paths.empty())
+    {
+        return results;
+    }
+
+    // Files small enough to read whole are sorted by size and signed in
+    // groups of one per SIMD lane; everything else goes through SignFile.
+    const size_t lanes = BatchHashLanes(hashName);
+    std::vector<size_t> single;
+    std::vector<std::pair<unsigned long long, size_t>> small;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        std::error_code error;
+        unsigned long long size = lanes > 1 ? std::filesystem::file_size(ToPath(paths[i]), error) : 0;
+        if (lanes > 1 && !error && size <= BATCH_FILE_SIZE)
+        {
+            small.emplace_back(size, i);
+        }
+        else
+        {
+            single.push_back(i);
+        }
+    }
+    std::sort(small.begin(), small.end());
+    const size_t groups = (small.size() + lanes - 1) / lanes;
+    const size_t items = groups + single.size();
+
+    size_t threads = options.concurrency != 0 ? options.concurrency : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, std::min(threads, items));
+
+    // One signer per worker: each owns its read buffer and error text.
+    WorkStealingPool pool(threads);
+    std::vector<GostSigner> signers(pool.ThreadCount());
+    for (auto& signer : signers)
+    {
+        signer.m_hashCache = m_hashCache;
+    }
+    pool.ParallelFor(items, [&](size_t item, size_t worker)
+    {
+        GostSigner& signer = signers[worker];
+        if (item >= groups)
+        {
+            const size_t index = single[item - groups];
+            results[index] = signer.SignFile(
+                paths[index], parameters, privateKeyHex, hashName, options.nonceMode, options.inputMode);
+            return;
+        }
+
+        const size_t begin = item * lanes;
+        const size_t end = std::min(begin + lanes, small.size());
+        std::vector<std::wstring> group;
+        for (size_t i = begin; i < end; ++i)
+        {
+            group.push_back(paths[small[i].second]);
+        }
+        auto hashes = signer.HashSmallFiles(group, hashName);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const size_t index = small[i].second;
+            auto& hash = hashes[i - begin];
+            // A file that could not be read whole is retried the ordinary way,
+            // which also reports why it failed.
+            results[index] = hash
+                ? signer.SignWith(parameters, privateKeyHex, hashName, options.nonceMode, [&] { return hash; })
+                : signer.SignFile(paths[index], parameters, privateKeyHex, hashName, options.nonceMode, options.inputMode);
+        }
+    });
+    return results;
+}
+
+std::vector<std::optional<std::vector<unsigned char>>> GostSigner::HashSmallFiles(const std::vector<std::wstring>& paths, const std::wstring& hashName)
+{
+    std::vector<std::optional<std::vector<unsigned char>>> digests(paths.size());
+    std::vector<std::optional<FileStamp>> stamps(paths.size());
+    std::vector<std::vector<unsigned char>> contents;
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (m_hashCache && m_hashCache->IsOpen())
+        {
+            stamps[i] = FileStamp::Of(paths[i]);
+            if (stamps[i])
+            {
+                if (auto cached = m_hashCache->Lookup(paths[i], *stamps[i], hashName))
+                {
+                    digests[i] = std::move(cached);
+                    continue;
+                }
+            }
+        }
+
+        FileByteSource source(paths[i]);
+        if (!source.IsOpen())
+        {
+            continue;
+        }
+        // One byte more than allowed shows that the file has grown since it was sized.
+        std::vector<unsigned char> content(static_cast<size_t>(BATCH_FILE_SIZE) + 1);
+        content.resize(ReadFull(source, content.data(), content.size()));
+        if (content.empty() || source.Failed() || content.size() > BATCH_FILE_SIZE)
+        {
+            continue;
+        }
+        contents.push_back(std::move(content));
+        pending.push_back(i);
+    }
+
+    std::vector<HashInput> inputs;
+    for (const auto& content : contents)
+    {
+        inputs.push_back(HashInput{ content.data(), content.size() });
+    }
+    auto hashes = HashBatch(hashName, inputs);
+    if (!hashes)
+    {
+        return digests;
+    }
+
+    for (size_t k = 0; k < pending.size(); ++k)
+    {
+        const size_t i = pending[k];
+        const auto& stamp = stamps[i];
+        if (stamp && stamp->settled && FileStamp::Of(paths[i]) == stamp)
+        {
+            m_hashCache->Store(paths[i], *stamp, hashName, (*hashes)[k]);
+        }
+        digests[i] = std::move((*hashes)[k]);
+    }
+    return digests;
+}
+
+std::future<GostSignature> GostSigner::SignFileAsync(
+    const std::wstring& path,
+    const GostParameters& parameters,
+    const std::wstring& privateKeyHex,
+    const std::wstring& hashName,
+    AsyncSignOptions options)
+{
+    auto promise = std::make_shared<std::promise<GostSignature>>();
+    auto future = promise->get_future();
+    HashCache* hashCache = m_hashCache;
+
+    std::thread([=, options = std::move(options)]
+    {
+        Progress progress;
+        progress.onProgress = options.onProgress;
+        progress.cancellation = options.cancellation;
+        std::error_code error;
+        progress.totalBytes = std::filesystem::file_size(ToPath(path), error);
+        if (error)
+        {
+            progress.totalBytes = 0;
+        }
+
+        GostSigner signer;
+        signer.m_hashCache = hashCache;
+        signer.m_progress = &progress;
+        GostSignature signature = options.treeHash
+            ? signer.SignFileTree(path, parameters, privateKeyHex, hashName, options.nonceMode, options.tree)
+            : signer.SignFile(path, parameters, privateKeyHex, hashName, options.nonceMode, options.inputMode);
+
+        if (options.onComplete)
+        {
+            options.onComplete(signature);
+        }
+        promise->set_value(std::move(signature));
+    }).detach();
+
+    return future;
+}
+
+GostSignature GostSigner::SignStream(
+    ByteSource& source,
+    const GostParameters& parameters,
+    const std::wstring& privateKeyHex,
+    const std::wstring& hashName,
+    NonceMode nonceMode)
+{
+    return SignWith(parameters, privateKeyHex, hashName, nonceMode, [&]
+    {
+        return ComputeHash(source, hashName, true);
+    });
+}
+
+GostSignature GostSigner::SignFileTree(
+    const std::wstring& path,
+    const GostParameters& parameters,
+    const std::wstring& privateKeyHex,
+    const std::wstring& hashName,
+    NonceMode nonceMode,
+    const TreeHashOptions& options)
+{
+    GostSignature signature = SignWith(parameters, privateKeyHex, hashName, nonceMode, [&]() -> std::optional<std::vector<unsigned char>>
+    {
+        auto tree = HashFileTree(path, hashName, options);
+        if (!tree)
+        {
+            return std::nullopt;
+        }
+        return tree->Root();
+    });
+    if (!signature.signatureHex.empty())
+    {
+        signature.treeChunkSize = options.chunkSize;
+        signature.treeLayout = MerkleTree::LAYOUT;
+    }
+    return signature;
+}
+
+std::optional<MerkleTree> GostSigner::HashFileTree(const std::wstring& path, const std::wstring& hashName, const TreeHashOptions& options)
+{
+    if (options.chunkSize == 0 || options.chunkSize > TreeHashOptions::MAX_CHUNK_SIZE)
+    {
+        m_lastError = L"Недопустимый размер блока дерева хешей";
+        return std::nullopt;
+    }
+
+    std::error_code error;
+    unsigned long long fileSize = std::filesystem::file_size(ToPath(path), error);
+    if (error)
+    {
+        m_lastError = L"Не удалось открыть файл";
+        return std::nullopt;
+    }
+    if (fileSize == 0)
+    {
+        m_lastError = L"Файл пустой";
+        return std::nullopt;
+    }
+
+    const unsigned long long chunkSize = options.chunkSize;
+    const size_t chunkCount = static_cast<size_t>((fileSize + chunkSize - 1) / chunkSize);
+    size_t threads = options.concurrency != 0 ? options.concurrency : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, std::min(threads, chunkCount));
+
+    // Each worker reads its chunk through its own handle into its own buffer,
+    // with the leaf prefix byte in front so the chunk is hashed in one pass.
+    WorkStealingPool pool(threads);
+    std::vector<GostSigner> workers(pool.ThreadCount());
+    for (auto& signer : workers)
+    {
+        signer.m_progress = m_progress;
+    }
+    std::vector<std::vector<unsigned char>> buffers(pool.ThreadCount());
+    std::vector<MerkleTree::Digest> leaves(chunkCount);
+    std::atomic<bool> failed{ false };
+    pool.ParallelFor(chunkCount, [&](size_t index, size_t worker)
+    {
+        GostSigner& signer = workers[worker];
+        if (failed || signer.Cancelled())
+        {
+            failed = true;
+            return;
+        }
+
+        unsigned long long offset = static_cast<unsigned long long>(index) * chunkSize;
+        size_t size = static_cast<size_t>(std::min(chunkSize, fileSize - offset));
+        std::vector<unsigned char>& buffer = buffers[worker];
+        buffer.resize(size + 1);
+        buffer[0] = MerkleTree::LEAF_PREFIX;
+
+        FileByteSource source(path);
+        if (!source.IsOpen() || !source.Seek(offset) || ReadFull(source, buffer.data() + 1, size) != size)
+        {
+            signer.m_lastError = L"Ошибка чтения данных";
+            failed = true;
+            return;
+        }
+
+        MemoryByteSource chunk(buffer.data(), buffer.size());
+        auto digest = signer.ComputeHash(chunk, hashName);
+        if (!digest)
+        {
+            failed = true;
+            return;
+        }
+        leaves[index] = std::move(*digest);
+        if (m_progress)
+        {
+            m_progress->Advance(size);
+        }
+    });
+
+    if (failed)
+    {
+        for (const auto& worker : workers)
+        {
+            if (!worker.m_lastError.empty())
+            {
+                m_lastError = worker.m_lastError;
+                break;
+            }
+        }
+        return std::nullopt;
+    }
+    return BuildTree(std::move(leaves), hashName);
+}
+
+std::optional<MerkleTree> GostSigner::HashStreamTree(ByteSource& source, const std::wstring& hashName, unsigned long long chunkSize)
+{
+    if (chunkSize == 0 || chunkSize > TreeHashOptions::MAX_CHUNK_SIZE)
+    {
+        m_lastError = L"Недопустимый размер блока дерева хешей";
+        return std::nullopt;
+    }
+
+    std::vector<unsigned char> buffer(static_cast<size_t>(chunkSize) + 1);
+    std::vector<MerkleTree::Digest> leaves;
+    for (;;)
+    {
+        buffer[0] = MerkleTree::LEAF_PREFIX;
+        size_t count = ReadFull(source, buffer.data() + 1, buffer.size() - 1);
+        if (count == 0)
+        {
+            break;
+        }
+
+        MemoryByteSource chunk(buffer.data(), count + 1);
+        auto digest = ComputeHash(chunk, hashName);
+        if (!digest)
+        {
+            return std::nullopt;
+        }
+        leaves.push_back(std::move(*digest));
+        if (m_progress)
+        {
+            m_progress->Advance(count);
+        }
+        if (count < buffer.size() - 1)
+        {
+            break;
+        }
+    }
+
+    if (source.Failed())
+    {
+        m_lastError = L"Ошибка чтения данных";
+        return std::nullopt;
+    }
+    if (leaves.empty())
+    {
+        m_lastError = L"Файл пустой";
+        return std::nullopt;
+    }
+    return BuildTree(std::move(leaves), hashName);
+}
+
+std::optional<MerkleTree> GostSigner::BuildTree(std::vector<MerkleTree::Digest> leaves, const std::wstring& hashName)
+{
+    return MerkleTree::Build(std::move(leaves), NodeHasher(hashName));
+}
+
+MerkleTree::NodeHasher GostSigner::NodeHasher(const std::wstring& hashName)
+{
+    return [this, hashName](const MerkleTree::Digest& left, const MerkleTree::Digest& right)
+    {
+        std::vector<unsigned char> node(1 + left.size() + right.size());
+        node[0] = MerkleTree::NODE_PREFIX;
+        std::copy(left.begin(), left.end(), node.begin() + 1);
+        std::copy(right.begin(), right.end(), node.begin() + 1 + left.size());
+        MemoryByteSource source(node.data(), node.size());
+        return ComputeHash(source, hashName);
+    };
+}
+
+bool GostSigner::CheckTreeLayout(const GostSignature& signature)
+{
+    if (signature.treeLayout != MerkleTree::LAYOUT)
+    {
+        m_lastError = L"Неизвестная схема дерева хешей";
+        return false;
+    }
+    return true;
+}
+
+bool GostSigner::VerifyFile(
+    const std::wstring& path,
+    const GostSignature& signature,
+    const std::wstring& publicKeyHex,
+    FileInputMode inputMode)
+{
+    if (signature.treeChunkSize != 0)
+    {
+        return VerifyFileTree(path, signature, publicKeyHex, 0);
+    }
+
+    auto hash = HashFile(path, signature.hashAlgorithm, inputMode);
+    return hash && Verify(*hash, signature, publicKeyHex);
+}
+
+bool GostSigner::VerifyFileTree(const std::wstring& path, const GostSignature& signature, const std::wstring& publicKeyHex, size_t concurrency)
+{
+    if (!CheckTreeLayout(signature))
+    {
+        return false;
+    }
+
+    TreeHashOptions options;
+    options.chunkSize = signature.treeChunkSize;
+    options.concurrency = concurrency;
+    auto tree = HashFileTree(path, signature.hashAlgorithm, options);
+    return tree && Verify(tree->Root(), signature, publicKeyHex);
+}
+
+bool GostSigner::VerifyStream(ByteSource& source, const GostSignature& signature, const std::wstring& publicKeyHex)
+{
+    if (signature.treeChunkSize != 0)
+    {
+        if (!CheckTreeLayout(signature))
+        {
+            return false;
+        }
+
+        auto tree = HashStreamTree(source, signature.hashAlgorithm, signature.treeChunkSize);
+        return tree && Verify(tree->Root(), signature, publicKeyHex);
+    }
+
+    auto hash = ComputeHash(source, signature.hashAlgorithm);
+    if (!hash)
+    {
+        return false;
+    }
+    return Verify(*hash, signature, publicKeyHex);
+}
+
+std::vector<VerifyResult> GostSigner::VerifyFiles(const std::vector<FileVerifyRequest>& requests, const BatchOptions& options)
+{
+    std::vector<VerifyResult> results(requests.size());
+    if (requests.empty())
+    {
+        return results;
+    }
+
+    size_t threads = options.concurrency != 0 ? options.concurrency : std::thread::hardware_concurrency();
+    threads = std::max<size_t>(1, threads);
+    const size_t batchThreads = std::min(threads, requests.size());
+    // Tree-hash entries share out the threads the batch leaves unused
+    // instead of each starting a pool as wide as the machine.
+    const size_t treeThreads = threads / batchThreads;
+    WorkStealingPool pool(batchThreads);
+    std::vector<GostSigner> signers(pool.ThreadCount());
+    for (auto& signer : signers)
+    {
+        signer.m_hashCache = m_hashCache;
+    }
+
+    // Digests first; tree-hash signatures and unreadable files are settled here.
+    std::vector<std::optional<std::vector<unsigned char>>> hashes(requests.size());
+    pool.ParallelFor(requests.size(), [&](size_t index, size_t worker)
+    {
+        GostSigner& signer = signers[worker];
+        const FileVerifyRequest& request = requests[index];
+        if (request.signature.treeChunkSize != 0)
+        {
+            results[index].valid = signer.VerifyFileTree(request.path, request.signature, request.publicKeyHex, treeThreads);
+            results[index].statusMessage = results[index].valid ? std::wstring() : signer.m_lastError;
+            return;
+        }
+        hashes[index] = signer.HashFile(request.path, request.signature.hashAlgorithm, options.inputMode);
+        if (!hashes[index])
+        {
+            results[index].statusMessage = signer.m_lastError;
+        }
+    });
+
+    // Entries grouped by curve and key. Anything that does not parse is left
+    // to Verify below, which also says what is wrong with it.
+    struct KeyGroup
+    {
+        const GostCurve* curve;
+        std::vector<unsigned char> publicKey;
+        std::vector<size_t> entries;
+        std::unique_ptr<GostCurve::PreparedKey> prepared;
+    };
+    std::vector<KeyGroup> groups;
+    std::map<std::pair<std::wstring, std::vector<unsigned char>>, size_t> groupIndex;
+    std::vector<std::vector<unsigned char>> signatures(requests.size());
+    std::vector<size_t> single;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        if (!hashes[i])
+        {
+            continue;
+        }
+        const GostSignature& signature = requests[i].signature;
+        const GostCurve* curve = GostCurve::Find(signature.parameterSet);
+        auto signBlob = ParseHexField(signature.signatureHex);
+        auto publicKey = ParseHexField(requests[i].publicKeyHex);
+        if (!curve || !signBlob || !publicKey || signBlob->size() != 2 * curve->Size() || publicKey->size() != 2 * curve->Size())
+        {
+            single.push_back(i);
+            continue;
+        }
+
+        signatures[i] = std::move(*signBlob);
+        auto inserted = groupIndex.emplace(std::make_pair(signature.parameterSet, *publicKey), groups.size());
+        if (inserted.second)
+        {
+            groups.push_back({ curve, std::move(*publicKey), {}, nullptr });
+        }
+        groups[inserted.first->second].entries.push_back(i);
+    }
+
+    pool.ParallelFor(groups.size(), [&](size_t index, size_t)
+    {
+        KeyGroup& group = groups[index];
+        group.prepared = group.curve->PrepareKey(group.publicKey, group.entries.size() >= KEY_TABLE_ENTRIES);
+    });
+
+    // Slices of one key's entries, small enough to spread over the pool.
+    const size_t SLICE_ENTRIES = 256;
+    std::vector<std::pair<size_t, size_t>> slices;
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        if (!groups[g].prepared)
+        {
+            single.insert(single.end(), groups[g].entries.begin(), groups[g].entries.end());
+            continue;
+        }
+        for (size_t begin = 0; begin < groups[g].entries.size(); begin += SLICE_ENTRIES)
+        {
+            slices.emplace_back(g, begin);
+        }
+    }
+
+    pool.ParallelFor(slices.size(), [&](size_t index, size_t)
+    {
+        const KeyGroup& group = groups[slices[index].first];
+        const size_t begin = slices[index].second;
+        const size_t end = std::min(begin + SLICE_ENTRIES, group.entries.size());
+        std::vector<GostCurve::BatchEntry> batch;
+        for (size_t k = begin; k < end; ++k)
+        {
+            const size_t i = group.entries[k];
+            batch.push_back({ &*hashes[i], &signatures[i], group.prepared.get() });
+        }
+
+        std::vector<bool> valid = group.curve->VerifyBatch(batch);
+        for (size_t k = begin; k < end; ++k)
+        {
+            const size_t i = group.entries[k];
+            results[i].valid = valid[k - begin];
+            if (!results[i].valid)
+            {
+                results[i].statusMessage = L"Подпись недействительна";
+            }
+        }
+    });
+
+    pool.ParallelFor(single.size(), [&](size_t index, size_t worker)
+    {
+        GostSigner& signer = signers[worker];
+        const size_t i = single[index];
+        results[i].valid = signer.Verify(*hashes[i], requests[i].signature, requests[i].publicKeyHex);
+        results[i].statusMessage = results[i].valid ? std::wstring() : signer.m_lastError;
+    });
+    return results;
+}
+
+bool GostSigner::Verify(const std::vector<unsigned char>& hash, const GostSignature& signature, const std::wstring& publicKeyHex)
+{
+    auto signBlob = ParseHexField(signature.signatureHex);
+    if (!signBlob)
+    {
+        m_lastError = L"Подпись не в формате hex";
+        return false;
+    }
+
+    auto publicKey = ParseHexField(publicKeyHex);
+    if (!publicKey)
+    {
+        m_lastError = L"Публичный ключ не в формате hex";
+        return false;
+    }
+    return VerifyBytes(signature.parameterSet.c_str(), hash, signBlob->data(), signBlob->size(), *publicKey);
+}
+
+bool GostSigner::VerifyFile(
+    const std::wstring& path,
+    const SignatureView& signature,
+    const std::vector<unsigned char>& publicKey,
+    FileInputMode inputMode)
+{
+    // SignatureView::Parse has already rejected unknown layouts and oversized chunks.
+    if (signature.TreeChunkSize() != 0)
+    {
+        TreeHashOptions options;
+        options.chunkSize = signature.TreeChunkSize();
+        auto tree = HashFileTree(path, signature.HashAlgorithm(), options);
+        return tree && Verify(tree->Root(), signature, publicKey);
+    }
+
+    auto hash = HashFile(path, signature.HashAlgorithm(), inputMode);
+    return hash && Verify(*hash, signature, publicKey);
+}
+
+bool GostSigner::Verify(const std::vector<unsigned char>& hash, const SignatureView& signature, const std::vector<unsigned char>& publicKey)
+{
+    return VerifyBytes(signature.ParameterSet(), hash, signature.Signature(), signature.SignatureSize(), publicKey);
+}
+
+bool GostSigner::VerifyBytes(
+    const wchar_t* parameterSet,
+    const std::vector<unsigned char>& hash,
+    const unsigned char* signature,
+    size_t signatureSize,
+    const std::vector<unsigned char>& publicKey)
+{
+    const GostCurve* curve = GostCurve::Find(parameterSet);
+    if (!curve)
+    {
+        m_lastError = L"Неизвестный набор параметров";
+        return false;
+    }
+    if (signatureSize != 2 * curve->Size())
+    {
+        m_lastError = L"Неверная длина подписи";
+        return false;
+    }
+    if (publicKey.size() != 2 * curve->Size())
+    {
+        m_lastError = L"Неверная длина публичного ключа";
+        return false;
+    }
+
+    if (!curve->Verify(hash, signature, signatureSize, publicKey.data(), publicKey.size()))
+    {
+        m_lastError = L"Подпись недействительна";
+        return false;
+    }
+    return true;
+}
+
+bool GostSigner::VerifyChunk(
+    ByteSource& chunk,
+    size_t index,
+    size_t leafCount,
+    const std::vector<MerkleTree::Digest>& auditPath,
+    const GostSignature& signature,
+    const std::wstring& publicKeyHex)
+{
+    if (signature.treeChunkSize == 0)
+    {
+        m_lastError = L"Подпись сформирована без дерева хешей";
+        return false;
+    }
+    if (!CheckTreeLayout(signature))
+    {
+        return false;
+    }
+    if (signature.treeChunkSize > TreeHashOptions::MAX_CHUNK_SIZE)
+    {
+        m_lastError = L"Недопустимый размер блока дерева хешей";
+        return false;
+    }
+
+    // One spare byte detects a chunk that is longer than the recorded size.
+    std::vector<unsigned char> buffer(static_cast<size_t>(signature.treeChunkSize) + 2);
+    buffer[0] = MerkleTree::LEAF_PREFIX;
+    size_t count = ReadFull(chunk, buffer.data() + 1, buffer.size() - 1);
+    if (chunk.Failed() || count == 0 || count > signature.treeChunkSize)
+    {
+        m_lastError = L"Неверный размер блока";
+        return false;
+    }
+
+    MemoryByteSource leafSource(buffer.data(), count + 1);
+    auto leaf = ComputeHash(leafSource, signature.hashAlgorithm);
+    if (!leaf)
+    {
+        return false;
+    }
+
+    auto root = MerkleTree::RootFromAuditPath(*leaf, index, leafCount, auditPath, NodeHasher(signature.hashAlgorithm));
+    if (!root)
+    {
+        m_lastError = L"Неверный путь в дереве хешей";
+        return false;
+    }
+    return Verify(*root, signature, publicKeyHex);
+}
+
+std::unique_ptr<SigningKey> SigningKey::Create(const std::wstring& parameterSet, const std::wstring& privateKeyHex, std::wstring& error)
+{
+    const GostCurve* curve = GostCurve::Find(parameterSet);
+    if (!curve)
+    {
+        error = L"Неизвестный набор параметров";
+        return nullptr;
+    }
+
+    std::unique_ptr<SigningKey> key(new SigningKey(*curve, parameterSet));
+    if (!ParsePrivateKey(*curve, privateKeyHex, key->m_privateKey, error))
+    {
+        return nullptr;
+    }
+    key->m_publicKey = curve->PublicKey(key->m_privateKey.data());
+    return key;
+}
+
+SigningKey::SigningKey(const GostCurve& curve, const std::wstring& parameterSet)
+    : m_curve(&curve)
+    , m_parameterSet(parameterSet)
+    , m_arena(SecureArena::KEY_CAPACITY)
+    , m_privateKey(ArenaAllocator<unsigned char>(m_arena))
+{
+}
+
+size_t SigningKey::Size() const
+{
+    return m_curve->Size();
+}
+
+std::vector<unsigned char> SigningKey::Sign(const std::vector<unsigned char>& digest, NonceMode nonceMode) const
+{
+    return SignDigest(*m_curve, digest, m_privateKey.data(), nonceMode);
+}
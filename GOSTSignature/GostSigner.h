@@ -0,0 +1,323 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ByteSource.h"
+#include "HashCache.h"
+#include "Hex.h"
+#include "MerkleTree.h"
+#include "SecureArena.h"
+#include "SignatureContainer.h"
+
+namespace gost
+{
+    class GostCurve;
+
+    struct GostParameters
+    {
+        std::wstring name;
+        std::wstring curve;
+        std::wstring provider;
+    };
+
+    struct GostSignature
+    {
+        std::wstring parameterSet;
+        std::wstring hashAlgorithm;
+        std::wstring signatureHex;
+        std::wstring publicKeyHex;
+        std::wstring statusMessage;
+        // Tree-hash mode only: the signed digest is the root of a MerkleTree
+        // over chunks of this size, built with the named layout.
+        unsigned long long treeChunkSize = 0;
+        std::wstring treeLayout;
+        // Seconds since 1970 UTC; 0 if unknown.
+        long long signedAt = 0;
+    };
+
+    enum class FileInputMode
+    {
+        Buffered,
+        // Hashes straight from mapped pages; pipes and special files fall back to Buffered.
+        Mapped
+    };
+
+    // Where the per-signature nonce k comes from.
+    enum class NonceMode
+    {
+        // The calling thread's ChaChaDrbg.
+        Random,
+        // RFC 6979-style HmacDrbg over the private key and the digest: the same
+        // key and message always give the same signature, and a starved or
+        // broken system generator cannot cause a nonce to repeat.
+        Deterministic
+    };
+
+    struct BatchOptions
+    {
+        // Worker threads; 0 uses every hardware thread.
+        size_t concurrency = 0;
+        NonceMode nonceMode = NonceMode::Random;
+        FileInputMode inputMode = FileInputMode::Buffered;
+    };
+
+    // One (file, signature, trusted key) tuple for VerifyFiles.
+    struct FileVerifyRequest
+    {
+        std::wstring path;
+        GostSignature signature;
+        // x || y in hex; the key stored in the signature is not trusted.
+        std::wstring publicKeyHex;
+    };
+
+    struct VerifyResult
+    {
+        bool valid = false;
+        // Why the check failed, as GetLastError() would say after VerifyFile.
+        std::wstring statusMessage;
+    };
+
+    struct TreeHashOptions
+    {
+        static constexpr unsigned long long DEFAULT_CHUNK_SIZE = 4ull << 20;
+        static constexpr unsigned long long MAX_CHUNK_SIZE = 1ull << 30;
+
+        unsigned long long chunkSize = DEFAULT_CHUNK_SIZE;
+        // Worker threads for leaf hashing; 0 uses every hardware thread.
+        size_t concurrency = 0;
+    };
+
+    // Shared flag between the caller and an asynchronous operation; copies
+    // refer to the same flag. Hashing stops at the next chunk after Cancel().
+    class CancellationToken
+    {
+    public:
+        void Cancel() { m_cancelled->store(true); }
+        bool IsCancelled() const { return m_cancelled->load(); }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    };
+
+    // Bytes hashed so far and the input size (0 if unknown). Called on a
+    // worker thread; calls never overlap.
+    using ProgressCallback = std::function<void(unsigned long long hashedBytes, unsigned long long totalBytes)>;
+    using SignCallback = std::function<void(const GostSignature& signature)>;
+
+    struct AsyncSignOptions
+    {
+        NonceMode nonceMode = NonceMode::Random;
+        FileInputMode inputMode = FileInputMode::Mapped;
+        // Signs the MerkleTree root as SignFileTree does, with these options.
+        bool treeHash = false;
+        TreeHashOptions tree;
+        ProgressCallback onProgress;
+        // Runs on the worker thread before the future becomes ready.
+        SignCallback onComplete;
+        CancellationToken cancellation;
+    };
+
+    // A private key parsed and reduced once, with its public key derived up
+    // front, for services that sign many digests with the same key. The key
+    // bytes stay in the object's own SecureArena. Sign only reads them, so one
+    // SigningKey may sign on several threads at once.
+    class SigningKey
+    {
+    public:
+        // nullptr if the parameter set is unknown or the key is empty, not hex
+        // or zero modulo q; error then says which.
+        static std::unique_ptr<SigningKey> Create(const std::wstring& parameterSet, const std::wstring& privateKeyHex, std::wstring& error);
+
+        SigningKey(const SigningKey&) = delete;
+        SigningKey& operator=(const SigningKey&) = delete;
+
+        const std::wstring& ParameterSet() const { return m_parameterSet; }
+        // Bytes in each half of the signature and of the public key.
+        size_t Size() const;
+        // x || y.
+        const std::vector<unsigned char>& PublicKey() const { return m_publicKey; }
+
+        // r || s over a digest, read little-endian like GOST R 34.11-2012 output.
+        std::vector<unsigned char> Sign(const std::vector<unsigned char>& digest, NonceMode nonceMode) const;
+
+    private:
+        SigningKey(const GostCurve& curve, const std::wstring& parameterSet);
+
+        const GostCurve* m_curve;
+        std::wstring m_parameterSet;
+        SecureArena m_arena;
+        SecureBytes m_privateKey;
+        std::vector<unsigned char> m_publicKey;
+    };
+
+    class GostSigner
+    {
+    public:
+        static constexpr size_t READ_CHUNK_SIZE = 1 << 20;
+        // SignFiles reads files up to this size whole and hashes them several
+        // at a time with HashBatch when the hash has a multi-buffer kernel.
+        static constexpr unsigned long long BATCH_FILE_SIZE = 64 << 10;
+        // VerifyFiles builds a key table (about five verifications of work) for
+        // keys with at least this many signatures in the batch.
+        static constexpr size_t KEY_TABLE_ENTRIES = 8;
+
+        GostSignature SignFile(
+            const std::wstring& path,
+            const GostParameters& parameters,
+            const std::wstring& privateKeyHex,
+            const std::wstring& hashName,
+            NonceMode nonceMode,
+            FileInputMode inputMode = FileInputMode::Buffered);
+
+        // Reads the file once, feeding every chunk to one context per distinct
+        // hash (on separate threads when there are several), then signs each
+        // digest under each parameter set with the same key. Returns
+        // parameterSets.size() * hashNames.size() signatures, parameter set
+        // major: result[p * hashNames.size() + h]. Digests current in the hash
+        // cache are not recomputed.
+        std::vector<GostSignature> SignFileMulti(
+            const std::wstring& path,
+            const std::vector<GostParameters>& parameterSets,
+            const std::wstring& privateKeyHex,
+            const std::vector<std::wstring>& hashNames,
+            NonceMode nonceMode,
+            FileInputMode inputMode = FileInputMode::Buffered);
+
+        // Reads, hashes and signs every file on a work-stealing pool. Results are
+        // in input order; failures are reported per file in statusMessage.
+        // Small files are grouped by size and hashed side by side in SIMD lanes
+        // (see BATCH_FILE_SIZE).
+        std::vector<GostSignature> SignFiles(
+            const std::vector<std::wstring>& paths,
+            const GostParameters& parameters,
+            const std::wstring& privateKeyHex,
+            const std::wstring& hashName,
+            const BatchOptions& options = {});
+
+        // Signs on a background thread and returns at once. A cancelled operation
+        // completes with an empty signature and a "cancelled" statusMessage.
+        // Uses the current hash cache, which must outlive the operation.
+        std::future<GostSignature> SignFileAsync(
+            const std::wstring& path,
+            const GostParameters& parameters,
+            const std::wstring& privateKeyHex,
+            const std::wstring& hashName,
+            AsyncSignOptions options = {});
+
+        // Hashes fixed-size chunks of the file in parallel and signs the root of
+        // the resulting MerkleTree; the chunk size and layout are recorded in
+        // the returned signature.
+        GostSignature SignFileTree(
+            const std::wstring& path,
+            const GostParameters& parameters,
+            const std::wstring& privateKeyHex,
+            const std::wstring& hashName,
+            NonceMode nonceMode,
+            const TreeHashOptions& options = {});
+
+        std::optional<MerkleTree> HashFileTree(const std::wstring& path, const std::wstring& hashName, const TreeHashOptions& options = {});
+
+        // The digest SignFile signs, from the hash cache when it is current;
+        // nullopt with GetLastError() set on failure.
+        std::optional<std::vector<unsigned char>> HashFile(const std::wstring& path, const std::wstring& hashName, FileInputMode inputMode = FileInputMode::Buffered);
+
+        // Hashes the source chunk by chunk; peak memory does not depend on input size.
+        GostSignature SignStream(
+            ByteSource& source,
+            const GostParameters& parameters,
+            const std::wstring& privateKeyHex,
+            const std::wstring& hashName,
+            NonceMode nonceMode);
+
+        // Checks signature.signatureHex (r || s) under signature.parameterSet and
+        // signature.hashAlgorithm against the given public key (x || y). The key
+        // stored in the signature itself is not trusted. On false, GetLastError()
+        // says why.
+        bool VerifyFile(
+            const std::wstring& path,
+            const GostSignature& signature,
+            const std::wstring& publicKeyHex,
+            FileInputMode inputMode = FileInputMode::Buffered);
+
+        bool VerifyStream(ByteSource& source, const GostSignature& signature, const std::wstring& publicKeyHex);
+
+        // VerifyFile for many tuples at once, for audits of whole archives. Files
+        // are hashed on a work-stealing pool; every key is decoded once and, when
+        // it covers at least KEY_TABLE_ENTRIES signatures, gets its own fixed-base
+        // table, and the digest inverses of each slice share one inversion.
+        // Results are in input order. Tree-hash signatures are checked one by one.
+        std::vector<VerifyResult> VerifyFiles(const std::vector<FileVerifyRequest>& requests, const BatchOptions& options = {});
+
+        bool Verify(const std::vector<unsigned char>& hash, const GostSignature& signature, const std::wstring& publicKeyHex);
+
+        // The same checks for a parsed binary container, with the trusted public
+        // key as raw x || y bytes; nothing is converted from text.
+        bool VerifyFile(
+            const std::wstring& path,
+            const SignatureView& signature,
+            const std::vector<unsigned char>& publicKey,
+            FileInputMode inputMode = FileInputMode::Buffered);
+
+        bool Verify(const std::vector<unsigned char>& hash, const SignatureView& signature, const std::vector<unsigned char>& publicKey);
+
+        // Checks one chunk of a tree-hashed input: the chunk's leaf digest is
+        // folded with its MerkleTree::AuditPath into a root, which must carry
+        // a valid signature.
+        bool VerifyChunk(
+            ByteSource& chunk,
+            size_t index,
+            size_t leafCount,
+            const std::vector<MerkleTree::Digest>& auditPath,
+            const GostSignature& signature,
+            const std::wstring& publicKeyHex);
+
+        // Digest cache consulted by SignFile, SignFiles and VerifyFile; not owned,
+        // nullptr disables it. Tree hashing and streams always read the data.
+        void SetHashCache(HashCache* cache) { m_hashCache = cache; }
+
+        const std::wstring& GetLastError() const { return m_lastError; }
+        static std::vector<GostParameters> DefaultParameterSets();
+        static std::vector<std::wstring> SupportedHashes();
+
+    private:
+        struct Progress;
+
+        std::wstring m_lastError;
+        std::vector<unsigned char> m_readBuffer;
+        HashCache* m_hashCache = nullptr;
+        // Set only while an asynchronous operation runs on this signer.
+        Progress* m_progress = nullptr;
+        // Key material for one signature; mapped on first use and wiped after
+        // every operation.
+        std::unique_ptr<SecureArena> m_arena;
+
+        bool Cancelled();
+        SecureArena& Arena();
+        template <typename Update>
+        bool HashChunks(ByteSource& source, bool reportProgress, Update update);
+        std::optional<std::vector<unsigned char>> ComputeHash(ByteSource& source, const std::wstring& hashName, bool reportProgress = false);
+        std::vector<std::optional<std::vector<unsigned char>>> HashFileMulti(const std::wstring& path, const std::vector<std::wstring>& hashNames, FileInputMode inputMode);
+        std::vector<std::optional<std::vector<unsigned char>>> HashSmallFiles(const std::vector<std::wstring>& paths, const std::wstring& hashName);
+        template <typename Hasher>
+        GostSignature SignWith(const GostParameters& parameters, const std::wstring& privateKeyHex, const std::wstring& hashName, NonceMode nonceMode, Hasher computeHash);
+        std::optional<MerkleTree> HashStreamTree(ByteSource& source, const std::wstring& hashName, unsigned long long chunkSize);
+        std::optional<MerkleTree> BuildTree(std::vector<MerkleTree::Digest> leaves, const std::wstring& hashName);
+        MerkleTree::NodeHasher NodeHasher(const std::wstring& hashName);
+        bool CheckTreeLayout(const GostSignature& signature);
+        bool VerifyFileTree(const std::wstring& path, const GostSignature& signature, const std::wstring& publicKeyHex, size_t concurrency);
+        bool VerifyBytes(
+            const wchar_t* parameterSet,
+            const std::vector<unsigned char>& hash,
+            const unsigned char* signature,
+            size_t signatureSize,
+            const std::vector<unsigned char>& publicKey);
+        std::vector<unsigned char> MakeSignature(const GostCurve& curve, const std::vector<unsigned char>& hash, const SecureBytes& privateKey, NonceMode nonceMode);
+        std::vector<unsigned char> DerivePublicKey(const GostCurve& curve, const SecureBytes& privateKey);
+    };
+}
@@ -0,0 +1,362 @@
+#include "HashBackend.h"
+#include "Sha.h"
+#include "Streebog.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#endif
+
+using namespace gost;
+
+namespace
+{
+    using HashFactory = std::function<std::unique_ptr<HashContext>()>;
+
+    // Adapts the in-tree hashes (Streebog, Sha256, Sha1) to HashContext.
+    template <typename Hash>
+    class PortableHashContext : public HashContext
+    {
+    public:
+        template <typename... Args>
+        explicit PortableHashContext(Args... args)
+            : m_hash(args...)
+        {
+        }
+
+        bool Update(const unsigned char* data, size_t size) override
+        {
+            m_hash.Update(data, size);
+            return true;
+        }
+
+        bool Finish(unsigned char* digest) override
+        {
+            m_hash.Finish(digest);
+            return true;
+        }
+
+        bool Reset() override
+        {
+            m_hash.Reset();
+            return true;
+        }
+
+        size_t DigestSize() const override { return m_hash.DigestSize(); }
+
+    private:
+        Hash m_hash;
+    };
+
+    template <typename Hash, typename... Args>
+    HashFactory Portable(Args... args)
+    {
+        return [args...]() -> std::unique_ptr<HashContext>
+        {
+            return std::make_unique<PortableHashContext<Hash>>(args...);
+        };
+    }
+
+#ifdef _WIN32
+    // CNG algorithm handle and its fixed lengths, shared by every context of
+    // one algorithm and closed after the last of them is gone.
+    class CngAlgorithm
+    {
+    public:
+        static std::shared_ptr<const CngAlgorithm> Open(LPCWSTR algorithmId)
+        {
+            BCRYPT_ALG_HANDLE handle = nullptr;
+            if (BCryptOpenAlgorithmProvider(&handle, algorithmId, nullptr, 0) != 0)
+            {
+                return nullptr;
+            }
+
+            std::shared_ptr<CngAlgorithm> algorithm(new CngAlgorithm(handle));
+            ULONG result = 0;
+            if (BCryptGetProperty(handle, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PUCHAR>(&algorithm->m_objectLength), sizeof(DWORD), &result, 0) != 0
+                || BCryptGetProperty(handle, BCRYPT_HASH_LENGTH, reinterpret_cast<PUCHAR>(&algorithm->m_hashLength), sizeof(DWORD), &result, 0) != 0)
+            {
+                return nullptr;
+            }
+            return algorithm;
+        }
+
+        ~CngAlgorithm()
+        {
+            BCryptCloseAlgorithmProvider(m_handle, 0);
+        }
+
+        BCRYPT_ALG_HANDLE Handle() const { return m_handle; }
+        DWORD ObjectLength() const { return m_objectLength; }
+        DWORD HashLength() const { return m_hashLength; }
+
+    private:
+        explicit CngAlgorithm(BCRYPT_ALG_HANDLE handle)
+            : m_handle(handle)
+        {
+        }
+
+        BCRYPT_ALG_HANDLE m_handle;
+        DWORD m_objectLength = 0;
+        DWORD m_hashLength = 0;
+    };
+
+    // A CNG hash object in a buffer owned by the context. Reusable hash objects
+    // (Windows 8 and later) restart by themselves after BCryptFinishHash; older
+    // systems get a fresh object in the same buffer.
+    class CngHashContext : public HashContext
+    {
+    public:
+        static std::unique_ptr<HashContext> Create(std::shared_ptr<const CngAlgorithm> algorithm)
+        {
+            std::unique_ptr<CngHashContext> context(new CngHashContext(std::move(algorithm)));
+            if (!context->CreateHash())
+            {
+                return nullptr;
+            }
+            return context;
+        }
+
+        ~CngHashContext() override
+        {
+            DestroyHash();
+        }
+
+        bool Update(const unsigned char* data, size_t size) override
+        {
+            m_dirty = true;
+            while (size > 0)
+            {
+                ULONG count = static_cast<ULONG>(std::min<size_t>(size, 0x80000000u));
+                if (BCryptHashData(m_hash, const_cast<PUCHAR>(data), count, 0) != 0)
+                {
+                    return false;
+                }
+                data += count;
+                size -= count;
+            }
+            return true;
+        }
+
+        bool Finish(unsigned char* digest) override
+        {
+            bool finished = BCryptFinishHash(m_hash, digest, m_algorithm->HashLength(), 0) == 0;
+            m_dirty = !finished || !m_reusable;
+            return finished && Reset();
+        }
+
+        bool Reset() override
+        {
+            if (m_hash && !m_dirty)
+            {
+                return true;
+            }
+            DestroyHash();
+            return CreateHash();
+        }
+
+        size_t DigestSize() const override { return m_algorithm->HashLength(); }
+
+    private:
+        explicit CngHashContext(std::shared_ptr<const CngAlgorithm> algorithm)
+            : m_algorithm(std::move(algorithm))
+            , m_object(m_algorithm->ObjectLength())
+        {
+        }
+
+        bool CreateHash()
+        {
+            m_reusable = BCryptCreateHash(m_algorithm->Handle(), &m_hash, m_object.data(), static_cast<ULONG>(m_object.size()), nullptr, 0, BCRYPT_HASH_REUSABLE_FLAG) == 0;
+            if (!m_reusable && BCryptCreateHash(m_algorithm->Handle(), &m_hash, m_object.data(), static_cast<ULONG>(m_object.size()), nullptr, 0, 0) != 0)
+            {
+                m_hash = nullptr;
+                return false;
+            }
+            m_dirty = false;
+            return true;
+        }
+
+        void DestroyHash()
+        {
+            if (m_hash)
+            {
+                BCryptDestroyHash(m_hash);
+                m_hash = nullptr;
+            }
+        }
+
+        std::shared_ptr<const CngAlgorithm> m_algorithm;
+        std::vector<unsigned char> m_object;
+        BCRYPT_HASH_HANDLE m_hash = nullptr;
+        bool m_reusable = false;
+        bool m_dirty = false;
+    };
+#endif
+
+    std::wstring KernelName(ShaKernel kernel)
+    {
+        const char* name = ShaKernelName(kernel);
+        return std::wstring(name, name + std::char_traits<char>::length(name));
+    }
+
+    // The portable implementation when its kernel is accelerated, otherwise
+    // CNG if the provider opens; implementation names the one chosen.
+    HashFactory PreferPlatform(const wchar_t* algorithmId, HashFactory portable, ShaKernel kernel, std::wstring& implementation)
+    {
+        implementation = KernelName(kernel);
+#ifdef _WIN32
+        if (kernel != ShaKernel::Scalar)
+        {
+            return portable;
+        }
+        if (auto algorithm = CngAlgorithm::Open(algorithmId))
+        {
+            implementation = L"cng";
+            return [algorithm]
+            {
+                return CngHashContext::Create(algorithm);
+            };
+        }
+#else
+        (void)algorithmId;
+#endif
+        return portable;
+    }
+}
+
+struct HashBackend::Algorithm
+{
+    std::wstring name;
+    std::wstring implementation;
+    HashFactory create;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<HashContext>> idle;
+};
+
+HashBackend::Lease::Lease(Algorithm* algorithm, std::unique_ptr<HashContext> context)
+    : m_algorithm(algorithm)
+    , m_context(std::move(context))
+{
+}
+
+HashBackend::Lease& HashBackend::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_algorithm = other.m_algorithm;
+        m_context = std::move(other.m_context);
+    }
+    return *this;
+}
+
+HashBackend::Lease::~Lease()
+{
+    Release();
+}
+
+void HashBackend::Lease::Release()
+{
+    if (!m_context)
+    {
+        return;
+    }
+
+    // A context that cannot be reset is dropped instead of pooled.
+    if (m_context->Reset())
+    {
+        std::lock_guard<std::mutex> lock(m_algorithm->mutex);
+        m_algorithm->idle.push_back(std::move(m_context));
+    }
+    m_context.reset();
+}
+
+HashBackend& HashBackend::Instance()
+{
+    static HashBackend backend;
+    return backend;
+}
+
+HashBackend::HashBackend()
+{
+    auto add = [this](const wchar_t* name, HashFactory create, std::wstring implementation)
+    {
+        auto algorithm = std::make_unique<Algorithm>();
+        algorithm->name = name;
+        algorithm->implementation = std::move(implementation);
+        algorithm->create = std::move(create);
+        m_algorithms.push_back(std::move(algorithm));
+    };
+
+    std::wstring implementation;
+    add(L"Streebog-256", Portable<Streebog>(size_t{ 32 }), L"table");
+    add(L"Streebog-512", Portable<Streebog>(size_t{ 64 }), L"table");
+    HashFactory sha256 = PreferPlatform(L"SHA256", Portable<Sha256>(), Sha256::Kernel(), implementation);
+    add(L"SHA-256", std::move(sha256), implementation);
+    HashFactory sha1 = PreferPlatform(L"SHA1", Portable<Sha1>(), Sha1::Kernel(), implementation);
+    add(L"SHA-1", std::move(sha1), implementation);
+}
+
+HashBackend::~HashBackend() = default;
+
+HashBackend::Lease HashBackend::Acquire(const std::wstring& hashName)
+{
+    for (const auto& algorithm : m_algorithms)
+    {
+        if (algorithm->name != hashName)
+        {
+            continue;
+        }
+
+        std::unique_ptr<HashContext> context;
+        {
+            std::lock_guard<std::mutex> lock(algorithm->mutex);
+            if (!algorithm->idle.empty())
+            {
+                context = std::move(algorithm->idle.back());
+                algorithm->idle.pop_back();
+            }
+        }
+        if (!context)
+        {
+            context = algorithm->create();
+        }
+        if (!context)
+        {
+            return {};
+        }
+        return Lease(algorithm.get(), std::move(context));
+    }
+    return {};
+}
+
+std::vector<std::wstring> HashBackend::Names() const
+{
+    std::vector<std::wstring> names;
+    names.reserve(m_algorithms.size());
+    for (const auto& algorithm : m_algorithms)
+    {
+        names.push_back(algorithm->name);
+    }
+    return names;
+}
+
+std::wstring HashBackend::Implementation(const std::wstring& hashName) const
+{
+    for (const auto& algorithm : m_algorithms)
+    {
+        if (algorithm->name == hashName)
+        {
+            return algorithm->implementation;
+        }
+    }
+    return {};
+}
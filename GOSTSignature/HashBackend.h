@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gost
+{
+    // One digest computation in progress. Finish writes DigestSize() bytes and
+    // leaves the context ready for the next message.
+    class HashContext
+    {
+    public:
+        virtual ~HashContext() = default;
+
+        virtual bool Update(const unsigned char* data, size_t size) = 0;
+        virtual bool Finish(unsigned char* digest) = 0;
+        // Drops any partial message; false if the context can no longer be used.
+        virtual bool Reset() = 0;
+        virtual size_t DigestSize() const = 0;
+    };
+
+    // Process-wide set of hash algorithms. Each algorithm keeps its long-lived
+    // state (on Windows the CNG algorithm handle and its object and digest
+    // lengths, opened once) and a free list of idle contexts, so hashing a
+    // message opens no provider and allocates nothing once the pool is warm.
+    // Streebog always runs in-tree. SHA-256 and SHA-1 run in-tree (Sha.h) when
+    // this CPU has an accelerated kernel for them or no platform provider
+    // exists; CNG is used on Windows only in place of the scalar code.
+    // Every member is safe to call from any thread.
+    class HashBackend
+    {
+        struct Algorithm;
+
+    public:
+        // Exclusive use of a pooled context; returns it to the pool when destroyed.
+        class Lease
+        {
+        public:
+            Lease() = default;
+            Lease(Lease&& other) noexcept = default;
+            Lease& operator=(Lease&& other) noexcept;
+            ~Lease();
+
+            explicit operator bool() const { return m_context != nullptr; }
+            HashContext* operator->() const { return m_context.get(); }
+            HashContext& operator*() const { return *m_context; }
+
+        private:
+            friend class HashBackend;
+            Lease(Algorithm* algorithm, std::unique_ptr<HashContext> context);
+            void Release();
+
+            Algorithm* m_algorithm = nullptr;
+            std::unique_ptr<HashContext> m_context;
+        };
+
+        static HashBackend& Instance();
+
+        // Empty lease for an unknown name or when no context could be created.
+        Lease Acquire(const std::wstring& hashName);
+
+        // Registered names, in the order they are offered to the user.
+        std::vector<std::wstring> Names() const;
+
+        // What computes the named hash in this process: "cng", "table" for
+        // Streebog, or the Sha.h kernel name ("sha-ni", "avx2", ...). Empty
+        // for an unknown name. Lets a host report the kernel it runs.
+        std::wstring Implementation(const std::wstring& hashName) const;
+
+    private:
+        HashBackend();
+        ~HashBackend();
+
+        HashBackend(const HashBackend&) = delete;
+        HashBackend& operator=(const HashBackend&) = delete;
+
+        std::vector<std::unique_ptr<Algorithm>> m_algorithms;
+    };
+}
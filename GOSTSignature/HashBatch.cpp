@@ -0,0 +1,56 @@
+#include "HashBatch.h"
+#include "HashBackend.h"
+#include "Sha.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace gost;
+
+size_t gost::BatchHashLanes(const std::wstring& hashName)
+{
+    return hashName == L"SHA-256" ? Sha256::Lanes() : 1;
+}
+
+std::optional<std::vector<std::vector<unsigned char>>> gost::HashBatch(const std::wstring& hashName, const std::vector<HashInput>& messages)
+{
+    std::vector<std::vector<unsigned char>> digests(messages.size());
+    if (hashName == L"SHA-256")
+    {
+        std::vector<size_t> order(messages.size());
+        std::iota(order.begin(), order.end(), size_t{ 0 });
+        std::stable_sort(order.begin(), order.end(), [&](size_t left, size_t right)
+        {
+            return messages[left].size < messages[right].size;
+        });
+
+        std::vector<const unsigned char*> data(messages.size());
+        std::vector<size_t> sizes(messages.size());
+        std::vector<unsigned char*> outputs(messages.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            const size_t index = order[i];
+            digests[index].resize(Sha256::DIGEST_SIZE);
+            data[i] = messages[index].data;
+            sizes[i] = messages[index].size;
+            outputs[i] = digests[index].data();
+        }
+        Sha256::HashLanes(data.data(), sizes.data(), messages.size(), outputs.data());
+        return digests;
+    }
+
+    auto context = HashBackend::Instance().Acquire(hashName);
+    if (!context)
+    {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        digests[i].resize(context->DigestSize());
+        if (!context->Update(messages[i].data, messages[i].size) || !context->Finish(digests[i].data()))
+        {
+            return std::nullopt;
+        }
+    }
+    return digests;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace gost
+{
+    struct HashInput
+    {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Messages HashBatch hashes side by side with this algorithm on this CPU;
+    // 1 when it has no multi-buffer kernel.
+    size_t BatchHashLanes(const std::wstring& hashName);
+
+    // Digests of many independent messages, in input order; nullopt for an
+    // unknown hash. Messages are sorted by length and cut into groups of
+    // BatchHashLanes(), so the lanes of one group finish together. SHA-256 has
+    // multi-buffer kernels; Streebog and SHA-1 are hashed one message at a
+    // time through HashBackend.
+    std::optional<std::vector<std::vector<unsigned char>>> HashBatch(const std::wstring& hashName, const std::vector<HashInput>& messages);
+}
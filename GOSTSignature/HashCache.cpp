@@ -0,0 +1,479 @@
+#include "HashCache.h"
+#include "FilePath.h"
+#include "Streebog.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace gost;
+
+struct HashCache::Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t slotCount;
+    // Stores started and not yet finished. Nonzero with no other process
+    // attached means a writer died holding a slot.
+    uint32_t writers;
+    uint8_t reserved[44];
+};
+
+struct HashCache::Slot
+{
+    uint32_t sequence;
+    uint8_t digestSize;
+    uint8_t reserved[3];
+    uint64_t key[3];
+    uint64_t size;
+    int64_t modified;
+    uint64_t fileId;
+    uint64_t check;
+    uint8_t digest[MAX_DIGEST_SIZE];
+};
+
+namespace
+{
+    constexpr uint32_t CACHE_MAGIC = 0x31434847; // "GHC1"
+    constexpr uint32_t CACHE_BUSY = 0xFFFFFFFFu;
+    constexpr uint32_t CACHE_VERSION = 1;
+#ifdef _WIN32
+    // Byte range locked to count attached processes; far past the end of the
+    // file so it never overlaps the mapped data.
+    constexpr DWORD CACHE_LOCK_OFFSET_HIGH = 0x7FFFFFFF;
+#endif
+    // Files modified this recently may still change within the same timestamp
+    // tick (FAT rounds to two seconds), so their digests are not stored.
+    constexpr long long RACY_WINDOW_SECONDS = 5;
+
+    using CacheKey = std::array<uint64_t, 3>;
+
+    std::atomic<uint32_t>& AtomicWord(uint32_t& word)
+    {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic word must map onto the file layout");
+        return *reinterpret_cast<std::atomic<uint32_t>*>(&word);
+    }
+
+    // Absolute, normalized path plus the algorithm name, hashed with Streebog-256.
+    std::optional<CacheKey> KeyOf(const std::wstring& path, const std::wstring& hashName)
+    {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(ToPath(path), error);
+        if (error)
+        {
+            return std::nullopt;
+        }
+
+        const std::filesystem::path normalized = absolute.lexically_normal();
+        const auto& native = normalized.native();
+        std::vector<unsigned char> material(
+            reinterpret_cast<const unsigned char*>(native.data()),
+            reinterpret_cast<const unsigned char*>(native.data() + native.size()));
+        material.push_back(0);
+        material.insert(material.end(),
+            reinterpret_cast<const unsigned char*>(hashName.data()),
+            reinterpret_cast<const unsigned char*>(hashName.data() + hashName.size()));
+
+        std::vector<unsigned char> digest = Streebog::Hash(material.data(), material.size(), 32);
+        CacheKey key{};
+        std::memcpy(key.data(), digest.data(), sizeof(key));
+        // All-zero keys mark empty slots.
+        key[0] |= 1;
+        return key;
+    }
+
+    // FNV-1a over everything but the sequence word; rejects slots whose pages
+    // were only partly written back before a crash.
+    uint64_t Checksum(const CacheKey& key, const FileStamp& stamp, const unsigned char* digest, size_t digestSize)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto mix = [&hash](const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+            }
+        };
+        mix(key.data(), sizeof(key));
+        mix(&stamp.size, sizeof(stamp.size));
+        mix(&stamp.modified, sizeof(stamp.modified));
+        mix(&stamp.fileId, sizeof(stamp.fileId));
+        mix(digest, digestSize);
+        return hash;
+    }
+}
+
+std::optional<FileStamp> FileStamp::Of(const std::wstring& path)
+{
+    FileStamp stamp;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return std::nullopt;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info{};
+    BOOL ok = GetFileInformationByHandle(file, &info);
+    CloseHandle(file);
+    if (!ok)
+    {
+        return std::nullopt;
+    }
+
+    stamp.size = (static_cast<unsigned long long>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    stamp.modified = static_cast<long long>((static_cast<unsigned long long>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+    stamp.fileId = ((static_cast<unsigned long long>(info.nFileIndexHigh) << 32) | info.nFileIndexLow)
+        ^ (static_cast<unsigned long long>(info.dwVolumeSerialNumber) * 0x9E3779B97F4A7C15ull);
+
+    FILETIME now{};
+    GetSystemTimeAsFileTime(&now);
+    long long nowTicks = static_cast<long long>((static_cast<unsigned long long>(now.dwHighDateTime) << 32) | now.dwLowDateTime);
+    stamp.settled = nowTicks - stamp.modified > RACY_WINDOW_SECONDS * 10000000ll;
+#else
+    struct stat info {};
+    if (stat(ToPath(path).c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        return std::nullopt;
+    }
+
+    stamp.size = static_cast<unsigned long long>(info.st_size);
+    stamp.modified = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000ll + info.st_mtim.tv_nsec;
+    stamp.fileId = static_cast<unsigned long long>(info.st_ino)
+        ^ (static_cast<unsigned long long>(info.st_dev) * 0x9E3779B97F4A7C15ull);
+
+    struct timespec now {};
+    clock_gettime(CLOCK_REALTIME, &now);
+    stamp.settled = now.tv_sec - info.st_mtim.tv_sec > RACY_WINDOW_SECONDS;
+#endif
+    return stamp;
+}
+
+HashCache::HashCache(const std::wstring& cachePath, size_t slotCount)
+{
+    static_assert(sizeof(Header) == 64 && sizeof(Slot) == 128, "cache layout must not depend on the compiler");
+
+    size_t slots = 1;
+    while (slots < slotCount)
+    {
+        slots <<= 1;
+    }
+    const unsigned long long fileSize = sizeof(Header) + static_cast<unsigned long long>(slots) * sizeof(Slot);
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(cachePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || (size.QuadPart != 0 && static_cast<unsigned long long>(size.QuadPart) != fileSize))
+    {
+        Close();
+        return;
+    }
+
+    // Mapping a zero-length file with an explicit size extends it with zeros.
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(fileSize >> 32), static_cast<DWORD>(fileSize & 0xFFFFFFFFu), nullptr);
+    if (!m_mapping)
+    {
+        Close();
+        return;
+    }
+
+    m_view = MapViewOfFile(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(fileSize));
+    if (!m_view)
+    {
+        Close();
+        return;
+    }
+#else
+    m_fd = open(ToPath(cachePath).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd < 0)
+    {
+        return;
+    }
+
+    struct stat info {};
+    if (fstat(m_fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        Close();
+        return;
+    }
+    if (info.st_size == 0 && ftruncate(m_fd, static_cast<off_t>(fileSize)) != 0)
+    {
+        Close();
+        return;
+    }
+    if (info.st_size != 0 && static_cast<unsigned long long>(info.st_size) != fileSize)
+    {
+        Close();
+        return;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(fileSize), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (view == MAP_FAILED)
+    {
+        Close();
+        return;
+    }
+    m_view = view;
+#endif
+    m_viewSize = static_cast<size_t>(fileSize);
+
+    // The first opener of a fresh (zero-filled) file claims the header; the
+    // others wait for it to publish the magic.
+    Header* header = static_cast<Header*>(m_view);
+    std::atomic<uint32_t>& magic = AtomicWord(header->magic);
+    uint32_t expected = 0;
+    if (magic.compare_exchange_strong(expected, CACHE_BUSY, std::memory_order_acq_rel))
+    {
+        header->version = CACHE_VERSION;
+        header->slotCount = slots;
+        magic.store(CACHE_MAGIC, std::memory_order_release);
+    }
+    else
+    {
+        for (int attempt = 0; attempt < 1000 && magic.load(std::memory_order_acquire) == CACHE_BUSY; ++attempt)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if (magic.load(std::memory_order_acquire) != CACHE_MAGIC || header->version != CACHE_VERSION || header->slotCount != slots)
+    {
+        Close();
+        return;
+    }
+
+    m_slots = reinterpret_cast<Slot*>(static_cast<unsigned char*>(m_view) + sizeof(Header));
+    m_slotMask = slots - 1;
+
+    // Every process keeps a shared lock while the cache is open, so whoever
+    // gets it exclusively is alone and no Store can be in progress.
+#ifdef _WIN32
+    OVERLAPPED lockRange{};
+    lockRange.OffsetHigh = CACHE_LOCK_OFFSET_HIGH;
+    if (LockFileEx(m_file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &lockRange))
+    {
+        ReclaimAbandonedSlots();
+        UnlockFileEx(m_file, 0, 1, 0, &lockRange);
+    }
+    lockRange = OVERLAPPED{};
+    lockRange.OffsetHigh = CACHE_LOCK_OFFSET_HIGH;
+    if (!LockFileEx(m_file, 0, 0, 1, 0, &lockRange))
+    {
+        Close();
+        return;
+    }
+#else
+    if (flock(m_fd, LOCK_EX | LOCK_NB) == 0)
+    {
+        ReclaimAbandonedSlots();
+    }
+    if (flock(m_fd, LOCK_SH) != 0)
+    {
+        Close();
+        return;
+    }
+#endif
+}
+
+HashCache::~HashCache()
+{
+    Close();
+}
+
+void HashCache::Close()
+{
+    m_slots = nullptr;
+#ifdef _WIN32
+    if (m_view)
+    {
+        UnmapViewOfFile(m_view);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_view)
+    {
+        munmap(m_view, m_viewSize);
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_view = nullptr;
+    m_viewSize = 0;
+}
+
+HashCache::Slot* HashCache::SlotAt(uint64_t index) const
+{
+    return &m_slots[index & m_slotMask];
+}
+
+void HashCache::ReclaimAbandonedSlots()
+{
+    Header* header = static_cast<Header*>(m_view);
+    std::atomic<uint32_t>& writers = AtomicWord(header->writers);
+    if (writers.load(std::memory_order_acquire) == 0)
+    {
+        return;
+    }
+
+    // A slot left odd holds a half-written entry; empty it and make it even.
+    for (uint64_t index = 0; index <= m_slotMask; ++index)
+    {
+        Slot* slot = SlotAt(index);
+        std::atomic<uint32_t>& sequence = AtomicWord(slot->sequence);
+        uint32_t value = sequence.load(std::memory_order_relaxed);
+        if (value & 1)
+        {
+            std::memset(slot->key, 0, sizeof(slot->key));
+            slot->digestSize = 0;
+            sequence.store(value + 1, std::memory_order_release);
+        }
+    }
+    writers.store(0, std::memory_order_release);
+}
+
+std::optional<std::vector<unsigned char>> HashCache::Lookup(const std::wstring& path, const FileStamp& stamp, const std::wstring& hashName) const
+{
+    if (!IsOpen())
+    {
+        return std::nullopt;
+    }
+
+    auto key = KeyOf(path, hashName);
+    if (!key)
+    {
+        return std::nullopt;
+    }
+
+    for (size_t probe = 0; probe < MAX_PROBES; ++probe)
+    {
+        Slot* slot = SlotAt((*key)[0] + probe);
+        std::atomic<uint32_t>& sequence = AtomicWord(slot->sequence);
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+
+        Slot copy;
+        std::memcpy(&copy, slot, sizeof(Slot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != before)
+        {
+            continue;
+        }
+
+        if (copy.key[0] != (*key)[0] || copy.key[1] != (*key)[1] || copy.key[2] != (*key)[2])
+        {
+            continue;
+        }
+
+        FileStamp stored;
+        stored.size = copy.size;
+        stored.modified = copy.modified;
+        stored.fileId = copy.fileId;
+        if (stored != stamp || copy.digestSize == 0 || copy.digestSize > MAX_DIGEST_SIZE
+            || copy.check != Checksum(*key, stored, copy.digest, copy.digestSize))
+        {
+            // Same path and algorithm with a stale stamp: the file has changed.
+            return std::nullopt;
+        }
+        return std::vector<unsigned char>(copy.digest, copy.digest + copy.digestSize);
+    }
+    return std::nullopt;
+}
+
+void HashCache::Store(const std::wstring& path, const FileStamp& stamp, const std::wstring& hashName, const std::vector<unsigned char>& digest)
+{
+    if (!IsOpen() || !stamp.settled || digest.empty() || digest.size() > MAX_DIGEST_SIZE)
+    {
+        return;
+    }
+
+    auto key = KeyOf(path, hashName);
+    if (!key)
+    {
+        return;
+    }
+
+    // Prefer the slot that already holds this path (replacing a stale entry),
+    // then an empty one; with neither, evict the home slot.
+    Slot* target = nullptr;
+    Slot* empty = nullptr;
+    for (size_t probe = 0; probe < MAX_PROBES && !target; ++probe)
+    {
+        Slot* slot = SlotAt((*key)[0] + probe);
+        if (slot->key[0] == (*key)[0] && slot->key[1] == (*key)[1] && slot->key[2] == (*key)[2])
+        {
+            target = slot;
+        }
+        else if (!empty && slot->key[0] == 0)
+        {
+            empty = slot;
+        }
+    }
+    if (!target)
+    {
+        target = empty ? empty : SlotAt((*key)[0]);
+    }
+
+    // Best effort: if another writer holds the slot, skip this entry.
+    std::atomic<uint32_t>& writers = AtomicWord(static_cast<Header*>(m_view)->writers);
+    writers.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic<uint32_t>& sequence = AtomicWord(target->sequence);
+    uint32_t before = sequence.load(std::memory_order_relaxed);
+    if ((before & 1) || !sequence.compare_exchange_strong(before, before + 1, std::memory_order_acq_rel))
+    {
+        writers.fetch_sub(1, std::memory_order_acq_rel);
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    target->digestSize = static_cast<uint8_t>(digest.size());
+    std::memcpy(target->key, key->data(), sizeof(target->key));
+    target->size = stamp.size;
+    target->modified = stamp.modified;
+    target->fileId = stamp.fileId;
+    std::memset(target->digest, 0, sizeof(target->digest));
+    std::memcpy(target->digest, digest.data(), digest.size());
+    target->check = Checksum(*key, stamp, digest.data(), digest.size());
+
+    sequence.store(before + 2, std::memory_order_release);
+    writers.fetch_sub(1, std::memory_order_acq_rel);
+}
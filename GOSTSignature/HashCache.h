@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace gost
+{
+    // Size, modification time and file id of a file at one moment. Two equal
+    // stamps mean the contents may be assumed unchanged.
+    struct FileStamp
+    {
+        unsigned long long size = 0;
+        long long modified = 0;
+        unsigned long long fileId = 0;
+        // False while the modification time is too recent to rule out a write
+        // within the same timestamp tick; such files are never cached.
+        bool settled = false;
+
+        bool operator==(const FileStamp& other) const
+        {
+            return size == other.size && modified == other.modified && fileId == other.fileId;
+        }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+
+        static std::optional<FileStamp> Of(const std::wstring& path);
+    };
+
+    // On-disk digest cache shared by every process that opens the same file.
+    // The file is a header followed by a power-of-two array of fixed 128-byte
+    // slots, mapped into memory and probed linearly from the key's home slot.
+    // An entry matches only if path, hash algorithm, size, modification time
+    // and file id all match, so any change to a file turns its entry into a
+    // miss, and the next Store for that path overwrites it.
+    //
+    // Each slot has a sequence counter: writers take a slot by moving it from
+    // even to odd and release it at the next even value; readers copy a slot
+    // and accept it only if the counter was even and unchanged around the copy.
+    // A writer that dies between the two leaves its slot odd, which readers
+    // and writers skip; the header counts unfinished stores, and the first
+    // process to open the cache while no other has it open empties such slots.
+    // Until then each one only costs a slot of capacity.
+    class HashCache
+    {
+    public:
+        static constexpr size_t DEFAULT_SLOTS = size_t{ 1 } << 16;
+        static constexpr size_t MAX_PROBES = 8;
+        static constexpr size_t MAX_DIGEST_SIZE = 64;
+
+        // slotCount is rounded up to a power of two. A file created with a
+        // different slot count or format is left alone and the cache stays closed.
+        explicit HashCache(const std::wstring& cachePath, size_t slotCount = DEFAULT_SLOTS);
+        ~HashCache();
+
+        HashCache(const HashCache&) = delete;
+        HashCache& operator=(const HashCache&) = delete;
+
+        bool IsOpen() const { return m_slots != nullptr; }
+
+        std::optional<std::vector<unsigned char>> Lookup(const std::wstring& path, const FileStamp& stamp, const std::wstring& hashName) const;
+        void Store(const std::wstring& path, const FileStamp& stamp, const std::wstring& hashName, const std::vector<unsigned char>& digest);
+
+    private:
+        struct Header;
+        struct Slot;
+
+        void Close();
+        Slot* SlotAt(uint64_t index) const;
+        void ReclaimAbandonedSlots();
+
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        void* m_view = nullptr;
+        size_t m_viewSize = 0;
+        Slot* m_slots = nullptr;
+        uint64_t m_slotMask = 0;
+    };
+}
@@ -0,0 +1,299 @@
+#include "Hex.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(GOST_X86)
+#include <immintrin.h>
+#endif
+
+using namespace gost;
+
+namespace
+{
+    constexpr char DIGITS[] = "0123456789abcdef";
+
+    // Both characters of every byte, so the scalar encoder does one load and
+    // one two-byte store per input byte.
+    struct EncodeTable
+    {
+        char pairs[256][2];
+
+        constexpr EncodeTable()
+            : pairs{}
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                pairs[i][0] = DIGITS[i >> 4];
+                pairs[i][1] = DIGITS[i & 0x0F];
+            }
+        }
+    };
+
+    // Nibble value of every character, 0xFF for anything that is not hex.
+    struct DecodeTable
+    {
+        unsigned char values[256];
+
+        constexpr DecodeTable()
+            : values{}
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                values[i] = 0xFF;
+            }
+            for (int i = 0; i < 10; ++i)
+            {
+                values['0' + i] = static_cast<unsigned char>(i);
+            }
+            for (int i = 0; i < 6; ++i)
+            {
+                values['a' + i] = static_cast<unsigned char>(10 + i);
+                values['A' + i] = static_cast<unsigned char>(10 + i);
+            }
+        }
+    };
+
+    constexpr EncodeTable ENCODE;
+    constexpr DecodeTable DECODE;
+
+    // Characters per narrow chunk when a wide string goes through the narrow
+    // kernels.
+    const size_t WIDE_CHUNK = 512;
+
+    void EncodeScalar(const unsigned char* data, size_t size, char* out)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            std::memcpy(out + 2 * i, ENCODE.pairs[data[i]], 2);
+        }
+    }
+
+    // Invalid characters are collected into one flag and checked once.
+    bool DecodeScalar(const char* hex, size_t length, unsigned char* out)
+    {
+        unsigned char invalid = 0;
+        for (size_t i = 0; i < length; i += 2)
+        {
+            unsigned char high = DECODE.values[static_cast<unsigned char>(hex[i])];
+            unsigned char low = DECODE.values[static_cast<unsigned char>(hex[i + 1])];
+            invalid |= high | low;
+            out[i / 2] = static_cast<unsigned char>((high << 4) | (low & 0x0F));
+        }
+        return (invalid & 0x80) == 0;
+    }
+
+#if defined(GOST_X86)
+    // ---------------- SSSE3 ----------------
+    // Encodes whole 16-byte blocks and returns how many bytes were consumed.
+    GOST_TARGET("ssse3")
+    size_t EncodeSsse3(const unsigned char* data, size_t size, char* out)
+    {
+        const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS));
+        const __m128i mask = _mm_set1_epi8(0x0F);
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+            __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi8(high, low));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 16), _mm_unpackhi_epi8(high, low));
+        }
+        return i;
+    }
+
+    // Nibble values of 16 characters; lanes that are not hex digits are
+    // cleared in valid.
+    GOST_TARGET("ssse3")
+    inline __m128i Nibbles(__m128i chars, __m128i& valid)
+    {
+        __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+        __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+        __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+        valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+        return _mm_or_si128(_mm_and_si128(isDigit, digit),
+            _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+    }
+
+    // Decodes whole 32-character blocks and returns how many characters were
+    // consumed.
+    GOST_TARGET("ssse3")
+    size_t DecodeSsse3(const char* hex, size_t length, unsigned char* out, bool& valid)
+    {
+        // Multiplies the first nibble of each pair by 16 and adds the second.
+        const __m128i weights = _mm_set1_epi16(0x0110);
+        __m128i validLanes = _mm_set1_epi8(-1);
+
+        size_t i = 0;
+        for (; i + 32 <= length; i += 32)
+        {
+            __m128i first = Nibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i)), validLanes);
+            __m128i second = Nibbles(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + i + 16)), validLanes);
+            __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i / 2), bytes);
+        }
+        valid = _mm_movemask_epi8(validLanes) == 0xFFFF;
+        return i;
+    }
+
+    // ---------------- AVX2 ----------------
+    GOST_TARGET("avx2")
+    size_t EncodeAvx2(const unsigned char* data, size_t size, char* out)
+    {
+        const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(DIGITS)));
+        const __m256i mask = _mm256_set1_epi8(0x0F);
+
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+            __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, mask));
+            // Unpacking works per 128-bit lane; the permutes restore byte order.
+            __m256i first = _mm256_unpacklo_epi8(high, low);
+            __m256i second = _mm256_unpackhi_epi8(high, low);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(first, second, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 32), _mm256_permute2x128_si256(first, second, 0x31));
+        }
+        return i;
+    }
+
+    GOST_TARGET("avx2")
+    inline __m256i Nibbles(__m256i chars, __m256i& valid)
+    {
+        __m256i digit = _mm256_sub_epi8(chars, _mm256_set1_epi8('0'));
+        __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+        __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i isLetter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+        valid = _mm256_and_si256(valid, _mm256_or_si256(isDigit, isLetter));
+        return _mm256_or_si256(_mm256_and_si256(isDigit, digit),
+            _mm256_and_si256(isLetter, _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+    }
+
+    GOST_TARGET("avx2")
+    size_t DecodeAvx2(const char* hex, size_t length, unsigned char* out, bool& valid)
+    {
+        const __m256i weights = _mm256_set1_epi16(0x0110);
+        __m256i validLanes = _mm256_set1_epi8(-1);
+
+        size_t i = 0;
+        for (; i + 64 <= length; i += 64)
+        {
+            __m256i first = Nibbles(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i)), validLanes);
+            __m256i second = Nibbles(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex + i + 32)), validLanes);
+            __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(first, weights), _mm256_maddubs_epi16(second, weights));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i / 2), _mm256_permute4x64_epi64(bytes, 0xD8));
+        }
+        valid = _mm256_movemask_epi8(validLanes) == -1;
+        return i;
+    }
+#endif
+}
+
+void gost::EncodeHex(const unsigned char* data, size_t size, char* out)
+{
+    size_t done = 0;
+#if defined(GOST_X86)
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    if (cpu.avx2)
+    {
+        done = EncodeAvx2(data, size, out);
+    }
+    if (cpu.ssse3)
+    {
+        done += EncodeSsse3(data + done, size - done, out + 2 * done);
+    }
+#endif
+    EncodeScalar(data + done, size - done, out + 2 * done);
+}
+
+void gost::EncodeHex(const unsigned char* data, size_t size, wchar_t* out)
+{
+    char chunk[2 * WIDE_CHUNK];
+    while (size > 0)
+    {
+        size_t count = std::min(size, WIDE_CHUNK);
+        EncodeHex(data, count, chunk);
+        for (size_t i = 0; i < 2 * count; ++i)
+        {
+            out[i] = static_cast<wchar_t>(chunk[i]);
+        }
+        data += count;
+        size -= count;
+        out += 2 * count;
+    }
+}
+
+bool gost::DecodeHex(const char* hex, size_t length, unsigned char* out)
+{
+    if (length % 2 != 0)
+    {
+        return false;
+    }
+
+    size_t done = 0;
+    bool valid = true;
+#if defined(GOST_X86)
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    if (cpu.avx2)
+    {
+        done = DecodeAvx2(hex, length, out, valid);
+    }
+    if (cpu.ssse3 && valid)
+    {
+        done += DecodeSsse3(hex + done, length - done, out + done / 2, valid);
+    }
+#endif
+    return valid && DecodeScalar(hex + done, length - done, out + done / 2);
+}
+
+bool gost::DecodeHex(const wchar_t* hex, size_t length, unsigned char* out)
+{
+    if (length % 2 != 0)
+    {
+        return false;
+    }
+
+    char chunk[2 * WIDE_CHUNK];
+    while (length > 0)
+    {
+        size_t count = std::min(length, 2 * WIDE_CHUNK);
+        // Anything outside ASCII would alias a hex digit once narrowed.
+        uint32_t outside = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            outside |= static_cast<uint32_t>(hex[i]) & ~0x7Fu;
+            chunk[i] = static_cast<char>(hex[i]);
+        }
+        if (outside != 0 || !DecodeHex(chunk, count, out))
+        {
+            return false;
+        }
+        hex += count;
+        length -= count;
+        out += count / 2;
+    }
+    return true;
+}
+
+std::wstring gost::FormatHex(const std::vector<unsigned char>& data)
+{
+    std::wstring hex(2 * data.size(), L'\0');
+    EncodeHex(data.data(), data.size(), &hex[0]);
+    return hex;
+}
+
+std::optional<std::vector<unsigned char>> gost::ParseHex(std::wstring_view hex)
+{
+    std::vector<unsigned char> bytes(hex.size() / 2);
+    if (!DecodeHex(hex.data(), hex.size(), bytes.data()))
+    {
+        return std::nullopt;
+    }
+    return bytes;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gost
+{
+    // Lower-case hex encoding: writes exactly 2 * size characters to out, with
+    // no terminator.
+    void EncodeHex(const unsigned char* data, size_t size, char* out);
+    void EncodeHex(const unsigned char* data, size_t size, wchar_t* out);
+
+    // Decodes length hex characters (either case) into length / 2 bytes of out.
+    // Returns false for an odd length or any other character; out is then
+    // partly written.
+    bool DecodeHex(const char* hex, size_t length, unsigned char* out);
+    bool DecodeHex(const wchar_t* hex, size_t length, unsigned char* out);
+
+    std::wstring FormatHex(const std::vector<unsigned char>& data);
+
+    // nullopt unless the whole string is valid hex.
+    std::optional<std::vector<unsigned char>> ParseHex(std::wstring_view hex);
+}
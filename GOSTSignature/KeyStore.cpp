@@ -0,0 +1,563 @@
+#include "KeyStore.h"
+#include "FilePath.h"
+#include "GostSigner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace gost;
+
+struct KeyStore::Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t charSize;
+    uint32_t reserved;
+    uint64_t dataEnd;
+    uint64_t tableOffset;
+    uint64_t bucketCount;
+    uint64_t userCount;
+    uint64_t firstUser;
+    uint64_t lastUser;
+};
+
+// Followed by nameLength wchar_t, padded to eight bytes.
+struct KeyStore::UserRecord
+{
+    uint64_t hash;
+    uint64_t nextInBucket;
+    uint64_t nextUser;
+    uint64_t firstKey;
+    uint64_t lastKey;
+    uint32_t keyCount;
+    uint32_t nameLength;
+};
+
+// Followed by the private and then the public key bytes, padded to eight bytes.
+struct KeyStore::KeyRecord
+{
+    uint64_t next;
+    int64_t createdAt;
+    uint32_t privateSize;
+    uint32_t publicSize;
+};
+
+namespace
+{
+    constexpr uint32_t STORE_MAGIC = 0x3153474B; // "KGS1"
+    constexpr uint32_t STORE_VERSION = 1;
+    constexpr uint64_t INITIAL_FILE_SIZE = 64 << 10;
+
+    uint64_t Padded(uint64_t size)
+    {
+        return (size + 7) & ~uint64_t{ 7 };
+    }
+
+    // FNV-1a over the name's code units.
+    uint64_t HashName(const std::wstring& name)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(name.data());
+        for (size_t i = 0; i < name.size() * sizeof(wchar_t); ++i)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+}
+
+KeyStore::KeyStore(const std::wstring& path)
+{
+    static_assert(sizeof(Header) == 64 && sizeof(UserRecord) == 48 && sizeof(KeyRecord) == 24,
+        "store layout must not depend on the compiler");
+
+    uint64_t fileSize = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size))
+    {
+        Close();
+        return;
+    }
+    fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+    m_fd = open(ToPath(path).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd < 0)
+    {
+        return;
+    }
+
+    struct stat info {};
+    if (fstat(m_fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        Close();
+        return;
+    }
+    fileSize = static_cast<uint64_t>(info.st_size);
+#endif
+
+    const bool fresh = fileSize == 0;
+    if ((!fresh && fileSize < sizeof(Header)) || !Map(fresh ? INITIAL_FILE_SIZE : fileSize))
+    {
+        Close();
+        return;
+    }
+
+    Header* header = HeaderAt();
+    if (fresh)
+    {
+        header->version = STORE_VERSION;
+        header->charSize = sizeof(wchar_t);
+        header->tableOffset = sizeof(Header);
+        header->bucketCount = INITIAL_BUCKETS;
+        header->dataEnd = sizeof(Header) + INITIAL_BUCKETS * sizeof(uint64_t);
+        header->magic = STORE_MAGIC;
+        return;
+    }
+
+    const uint64_t buckets = header->bucketCount;
+    if (header->magic != STORE_MAGIC || header->version != STORE_VERSION || header->charSize != sizeof(wchar_t)
+        || header->dataEnd > m_viewSize || buckets == 0 || (buckets & (buckets - 1)) != 0
+        || header->tableOffset < sizeof(Header) || header->tableOffset % 8 != 0
+        || buckets > (header->dataEnd - header->tableOffset) / sizeof(uint64_t))
+    {
+        Close();
+    }
+}
+
+KeyStore::~KeyStore()
+{
+    Flush();
+    Close();
+}
+
+void KeyStore::Close()
+{
+#ifdef _WIN32
+    if (m_view)
+    {
+        UnmapViewOfFile(m_view);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+        m_file = nullptr;
+    }
+#else
+    if (m_view)
+    {
+        munmap(m_view, static_cast<size_t>(m_viewSize));
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    m_view = nullptr;
+    m_viewSize = 0;
+}
+
+// Maps the first size bytes of the file, extending it with zeros if needed.
+bool KeyStore::Map(uint64_t size)
+{
+#ifdef _WIN32
+    if (m_view)
+    {
+        UnmapViewOfFile(m_view);
+        m_view = nullptr;
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+    if (!m_mapping)
+    {
+        return false;
+    }
+    m_view = MapViewOfFile(m_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(size));
+#else
+    if (m_view)
+    {
+        munmap(m_view, static_cast<size_t>(m_viewSize));
+        m_view = nullptr;
+    }
+    struct stat info {};
+    if (fstat(m_fd, &info) != 0
+        || (static_cast<uint64_t>(info.st_size) < size && ftruncate(m_fd, static_cast<off_t>(size)) != 0))
+    {
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    m_view = view != MAP_FAILED ? view : nullptr;
+#endif
+    m_viewSize = m_view ? size : 0;
+    return m_view != nullptr;
+}
+
+// Makes room for bytes more after dataEnd, doubling the file as needed. Any
+// record pointer taken before the call is invalid afterwards.
+bool KeyStore::Reserve(uint64_t bytes)
+{
+    const uint64_t needed = HeaderAt()->dataEnd + bytes;
+    if (needed <= m_viewSize)
+    {
+        return true;
+    }
+
+    uint64_t size = m_viewSize;
+    while (size < needed)
+    {
+        size *= 2;
+    }
+    if (!Map(size))
+    {
+        // Leaves the store closed rather than half-mapped.
+        Close();
+        return false;
+    }
+    return true;
+}
+
+// Copies data to the end of the used area; 0 on failure.
+uint64_t KeyStore::Append(const void* data, size_t size)
+{
+    if (!Reserve(Padded(size)))
+    {
+        return 0;
+    }
+    Header* header = HeaderAt();
+    const uint64_t offset = header->dataEnd;
+    std::memcpy(static_cast<unsigned char*>(m_view) + offset, data, size);
+    header->dataEnd = offset + Padded(size);
+    return offset;
+}
+
+// Appends a table of bucketCount buckets and relinks every user into it; the
+// old table is left behind as dead space.
+bool KeyStore::Rehash(uint64_t bucketCount)
+{
+    if (!Reserve(bucketCount * sizeof(uint64_t)))
+    {
+        return false;
+    }
+
+    Header* header = HeaderAt();
+    const uint64_t tableOffset = header->dataEnd;
+    uint64_t* table = reinterpret_cast<uint64_t*>(static_cast<unsigned char*>(m_view) + tableOffset);
+    std::memset(table, 0, static_cast<size_t>(bucketCount * sizeof(uint64_t)));
+    header->dataEnd += bucketCount * sizeof(uint64_t);
+
+    uint64_t offset = header->firstUser;
+    for (uint64_t i = 0; i < header->userCount && offset != 0; ++i)
+    {
+        UserRecord* user = At<UserRecord>(offset);
+        if (!user)
+        {
+            break;
+        }
+        uint64_t& bucket = table[user->hash & (bucketCount - 1)];
+        user->nextInBucket = bucket;
+        bucket = offset;
+        offset = user->nextUser;
+    }
+
+    header->tableOffset = tableOffset;
+    header->bucketCount = bucketCount;
+    return true;
+}
+
+KeyStore::Header* KeyStore::HeaderAt() const
+{
+    return static_cast<Header*>(m_view);
+}
+
+// The record at offset with extra trailing bytes, or nullptr if it does not
+// lie inside the used area (links in a damaged file are never followed out).
+template <typename Record>
+Record* KeyStore::At(uint64_t offset, size_t extra) const
+{
+    const uint64_t dataEnd = HeaderAt()->dataEnd;
+    if (offset < sizeof(Header) || offset % 8 != 0 || offset > dataEnd || sizeof(Record) + extra > dataEnd - offset)
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<Record*>(static_cast<unsigned char*>(m_view) + offset);
+}
+
+std::wstring KeyStore::NameOf(const UserRecord& user) const
+{
+    const wchar_t* name = reinterpret_cast<const wchar_t*>(&user + 1);
+    return std::wstring(name, name + user.nameLength);
+}
+
+// Offset of the user's record, 0 if there is none.
+uint64_t KeyStore::FindUser(const std::wstring& name, uint64_t hash) const
+{
+    const Header* header = HeaderAt();
+    const uint64_t* table = At<uint64_t>(header->tableOffset, static_cast<size_t>((header->bucketCount - 1) * sizeof(uint64_t)));
+    if (!table)
+    {
+        return 0;
+    }
+
+    uint64_t offset = table[hash & (header->bucketCount - 1)];
+    for (uint64_t i = 0; i <= header->userCount && offset != 0; ++i)
+    {
+        const UserRecord* user = At<UserRecord>(offset);
+        if (!user)
+        {
+            return 0;
+        }
+        if (user->hash == hash && user->nameLength == name.size()
+            && At<UserRecord>(offset, name.size() * sizeof(wchar_t))
+            && std::memcmp(user + 1, name.data(), name.size() * sizeof(wchar_t)) == 0)
+        {
+            return offset;
+        }
+        offset = user->nextInBucket;
+    }
+    return 0;
+}
+
+std::optional<StoredKey> KeyStore::ReadKey(uint64_t offset) const
+{
+    const KeyRecord* record = At<KeyRecord>(offset);
+    if (!record || !At<KeyRecord>(offset, static_cast<size_t>(record->privateSize) + record->publicSize))
+    {
+        return std::nullopt;
+    }
+
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(record + 1);
+    StoredKey key;
+    key.privateKey.assign(bytes, bytes + record->privateSize);
+    key.publicKey.assign(bytes + record->privateSize, bytes + record->privateSize + record->publicSize);
+    key.createdAt = record->createdAt;
+    return key;
+}
+
+size_t KeyStore::UserCount() const
+{
+    return IsOpen() ? static_cast<size_t>(HeaderAt()->userCount) : 0;
+}
+
+bool KeyStore::HasUser(const std::wstring& name) const
+{
+    return IsOpen() && FindUser(name, HashName(name)) != 0;
+}
+
+bool KeyStore::AddUser(const std::wstring& name)
+{
+    if (!IsOpen() || name.empty() || name.size() > MAX_NAME_LENGTH)
+    {
+        return false;
+    }
+
+    const uint64_t hash = HashName(name);
+    if (FindUser(name, hash) != 0)
+    {
+        return false;
+    }
+    // Keeps chains at about one record long.
+    if (HeaderAt()->userCount >= HeaderAt()->bucketCount && !Rehash(HeaderAt()->bucketCount * 2))
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> buffer(sizeof(UserRecord) + name.size() * sizeof(wchar_t));
+    UserRecord record{};
+    record.hash = hash;
+    record.nameLength = static_cast<uint32_t>(name.size());
+    std::memcpy(buffer.data(), &record, sizeof(record));
+    std::memcpy(buffer.data() + sizeof(record), name.data(), name.size() * sizeof(wchar_t));
+
+    const uint64_t offset = Append(buffer.data(), buffer.size());
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    // The record is complete before anything links to it.
+    Header* header = HeaderAt();
+    uint64_t* table = reinterpret_cast<uint64_t*>(static_cast<unsigned char*>(m_view) + header->tableOffset);
+    uint64_t& bucket = table[hash & (header->bucketCount - 1)];
+    At<UserRecord>(offset)->nextInBucket = bucket;
+    bucket = offset;
+    if (UserRecord* last = At<UserRecord>(header->lastUser))
+    {
+        last->nextUser = offset;
+    }
+    else
+    {
+        header->firstUser = offset;
+    }
+    header->lastUser = offset;
+    ++header->userCount;
+    return true;
+}
+
+std::vector<std::wstring> KeyStore::Users() const
+{
+    std::vector<std::wstring> users;
+    if (!IsOpen())
+    {
+        return users;
+    }
+
+    const Header* header = HeaderAt();
+    users.reserve(static_cast<size_t>(header->userCount));
+    uint64_t offset = header->firstUser;
+    for (uint64_t i = 0; i < header->userCount && offset != 0; ++i)
+    {
+        const UserRecord* user = At<UserRecord>(offset);
+        if (!user || !At<UserRecord>(offset, user->nameLength * sizeof(wchar_t)))
+        {
+            break;
+        }
+        users.push_back(NameOf(*user));
+        offset = user->nextUser;
+    }
+    return users;
+}
+
+bool KeyStore::AddKey(const std::wstring& user, const StoredKey& key)
+{
+    if (!IsOpen() || key.privateKey.size() > MAX_KEY_SIZE || key.publicKey.size() > MAX_KEY_SIZE)
+    {
+        return false;
+    }
+
+    const uint64_t userOffset = FindUser(user, HashName(user));
+    if (userOffset == 0)
+    {
+        return false;
+    }
+
+    std::vector<unsigned char> buffer(sizeof(KeyRecord) + key.privateKey.size() + key.publicKey.size());
+    KeyRecord record{};
+    record.createdAt = key.createdAt != 0
+        ? key.createdAt
+        : static_cast<int64_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    record.privateSize = static_cast<uint32_t>(key.privateKey.size());
+    record.publicSize = static_cast<uint32_t>(key.publicKey.size());
+    std::memcpy(buffer.data(), &record, sizeof(record));
+    std::copy(key.privateKey.begin(), key.privateKey.end(), buffer.begin() + sizeof(record));
+    std::copy(key.publicKey.begin(), key.publicKey.end(), buffer.begin() + sizeof(record) + key.privateKey.size());
+
+    const uint64_t offset = Append(buffer.data(), buffer.size());
+    if (offset == 0)
+    {
+        return false;
+    }
+
+    UserRecord* owner = At<UserRecord>(userOffset);
+    if (KeyRecord* last = At<KeyRecord>(owner->lastKey))
+    {
+        last->next = offset;
+    }
+    else
+    {
+        owner->firstKey = offset;
+    }
+    owner->lastKey = offset;
+    ++owner->keyCount;
+
+    // The private key is not left in a heap block that is about to be freed.
+    volatile unsigned char* bytes = buffer.data();
+    for (size_t i = 0; i < buffer.size(); ++i)
+    {
+        bytes[i] = 0;
+    }
+    return true;
+}
+
+std::vector<StoredKey> KeyStore::Keys(const std::wstring& user) const
+{
+    std::vector<StoredKey> keys;
+    const uint64_t userOffset = IsOpen() ? FindUser(user, HashName(user)) : 0;
+    if (userOffset == 0)
+    {
+        return keys;
+    }
+
+    const UserRecord* owner = At<UserRecord>(userOffset);
+    uint64_t offset = owner->firstKey;
+    for (uint32_t i = 0; i < owner->keyCount && offset != 0; ++i)
+    {
+        auto key = ReadKey(offset);
+        if (!key)
+        {
+            break;
+        }
+        keys.push_back(std::move(*key));
+        offset = At<KeyRecord>(offset)->next;
+    }
+    return keys;
+}
+
+std::optional<StoredKey> KeyStore::LatestKey(const std::wstring& user) const
+{
+    const uint64_t userOffset = IsOpen() ? FindUser(user, HashName(user)) : 0;
+    if (userOffset == 0)
+    {
+        return std::nullopt;
+    }
+    return ReadKey(At<UserRecord>(userOffset)->lastKey);
+}
+
+bool KeyStore::Flush()
+{
+    if (!IsOpen())
+    {
+        return false;
+    }
+#ifdef _WIN32
+    return FlushViewOfFile(m_view, 0) && FlushFileBuffers(m_file);
+#else
+    return msync(m_view, static_cast<size_t>(m_viewSize), MS_SYNC) == 0;
+#endif
+}
+
+std::optional<size_t> gost::StoredKeyParameterSet(const StoredKey& key)
+{
+    const auto parameterSets = GostSigner::DefaultParameterSets();
+    const std::wstring privateKeyHex = FormatHex(key.privateKey);
+    for (size_t i = 0; i < parameterSets.size(); ++i)
+    {
+        std::wstring error;
+        auto signingKey = SigningKey::Create(parameterSets[i].name, privateKeyHex, error);
+        if (signingKey && signingKey->PublicKey() == key.publicKey)
+        {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace gost
+{
+    struct StoredKey
+    {
+        std::vector<unsigned char> privateKey;
+        std::vector<unsigned char> publicKey;
+        // Seconds since 1970 UTC.
+        long long createdAt = 0;
+    };
+
+    // Stored keys do not record their parameter set: it is the index into
+    // GostSigner::DefaultParameterSets() under which the private key gives the
+    // stored public key. nullopt for a pair that matches no set (saved before
+    // the public key was derived), which is not a usable key.
+    std::optional<size_t> StoredKeyParameterSet(const StoredKey& key);
+
+    // Users and their keys in one memory-mapped file. Records are only ever
+    // appended: a user record carries its name, a link to the next user in
+    // creation order, a hash-chain link and the first and last of its key
+    // records; key records form a singly linked list per user. A power-of-two
+    // bucket table of record offsets gives O(1) lookup by name; when users
+    // outnumber buckets a table twice the size is appended and the chains are
+    // relinked. The file grows by doubling and is remapped, so every link is
+    // a file offset, never a pointer.
+    //
+    // One process writes at a time. Private keys are stored as they are,
+    // unencrypted; the file is created readable by its owner only. A file
+    // written with a different wchar_t size or format is left alone and the
+    // store stays closed.
+    class KeyStore
+    {
+    public:
+        static constexpr size_t INITIAL_BUCKETS = 1024;
+        static constexpr size_t MAX_NAME_LENGTH = 1024;
+        static constexpr size_t MAX_KEY_SIZE = 1024;
+
+        explicit KeyStore(const std::wstring& path);
+        ~KeyStore();
+
+        KeyStore(const KeyStore&) = delete;
+        KeyStore& operator=(const KeyStore&) = delete;
+
+        bool IsOpen() const { return m_view != nullptr; }
+
+        size_t UserCount() const;
+        bool HasUser(const std::wstring& name) const;
+        // False if the user already exists, the name is empty or too long, or
+        // the file cannot grow.
+        bool AddUser(const std::wstring& name);
+        // In creation order.
+        std::vector<std::wstring> Users() const;
+
+        // Appends to the user's key list; false for an unknown user.
+        bool AddKey(const std::wstring& user, const StoredKey& key);
+        // Oldest first.
+        std::vector<StoredKey> Keys(const std::wstring& user) const;
+        std::optional<StoredKey> LatestKey(const std::wstring& user) const;
+
+        // Writes dirty pages back to disk; also done on destruction.
+        bool Flush();
+
+    private:
+        struct Header;
+        struct UserRecord;
+        struct KeyRecord;
+
+        void Close();
+        bool Map(uint64_t size);
+        bool Reserve(uint64_t bytes);
+        uint64_t Append(const void* data, size_t size);
+        bool Rehash(uint64_t bucketCount);
+
+        Header* HeaderAt() const;
+        template <typename Record>
+        Record* At(uint64_t offset, size_t extra = 0) const;
+        std::wstring NameOf(const UserRecord& user) const;
+        uint64_t FindUser(const std::wstring& name, uint64_t hash) const;
+        std::optional<StoredKey> ReadKey(uint64_t offset) const;
+
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#else
+        int m_fd = -1;
+#endif
+        void* m_view = nullptr;
+        uint64_t m_viewSize = 0;
+    };
+}
@@ -0,0 +1,94 @@
+#include "MerkleTree.h"
+
+using namespace gost;
+
+std::optional<MerkleTree> MerkleTree::Build(std::vector<Digest> leaves, const NodeHasher& hasher)
+{
+    if (leaves.empty())
+    {
+        return std::nullopt;
+    }
+
+    MerkleTree tree;
+    tree.m_levels.push_back(std::move(leaves));
+    while (tree.m_levels.back().size() > 1)
+    {
+        const std::vector<Digest>& level = tree.m_levels.back();
+        std::vector<Digest> parents;
+        parents.reserve((level.size() + 1) / 2);
+        for (size_t i = 0; i + 1 < level.size(); i += 2)
+        {
+            auto node = hasher(level[i], level[i + 1]);
+            if (!node)
+            {
+                return std::nullopt;
+            }
+            parents.push_back(std::move(*node));
+        }
+        if (level.size() % 2 != 0)
+        {
+            parents.push_back(level.back());
+        }
+        tree.m_levels.push_back(std::move(parents));
+    }
+    return tree;
+}
+
+std::vector<MerkleTree::Digest> MerkleTree::AuditPath(size_t index) const
+{
+    std::vector<Digest> path;
+    for (size_t level = 0; level + 1 < m_levels.size(); ++level)
+    {
+        size_t sibling = index ^ 1;
+        if (sibling < m_levels[level].size())
+        {
+            path.push_back(m_levels[level][sibling]);
+        }
+        index >>= 1;
+    }
+    return path;
+}
+
+std::optional<MerkleTree::Digest> MerkleTree::RootFromAuditPath(
+    const Digest& leaf,
+    size_t index,
+    size_t leafCount,
+    const std::vector<Digest>& auditPath,
+    const NodeHasher& hasher)
+{
+    if (index >= leafCount)
+    {
+        return std::nullopt;
+    }
+
+    Digest node = leaf;
+    size_t used = 0;
+    for (size_t count = leafCount; count > 1; count = (count + 1) / 2)
+    {
+        size_t sibling = index ^ 1;
+        if (sibling < count)
+        {
+            if (used == auditPath.size())
+            {
+                return std::nullopt;
+            }
+
+            auto parent = (index & 1) != 0
+                ? hasher(auditPath[used], node)
+                : hasher(node, auditPath[used]);
+            if (!parent)
+            {
+                return std::nullopt;
+            }
+            node = std::move(*parent);
+            ++used;
+        }
+        index >>= 1;
+    }
+
+    if (used != auditPath.size())
+    {
+        return std::nullopt;
+    }
+    return node;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace gost
+{
+    // Binary hash tree over fixed-size chunks of one input, laid out as in
+    // RFC 6962: leaf = H(0x00 || chunk), node = H(0x01 || left || right), and
+    // the last node of an odd-sized level moves up unchanged. The root is what
+    // gets signed; any single chunk can later be checked against it with its
+    // audit path instead of rehashing the whole input.
+    class MerkleTree
+    {
+    public:
+        using Digest = std::vector<unsigned char>;
+        // Returns H(NODE_PREFIX || left || right), or nullopt if hashing failed.
+        using NodeHasher = std::function<std::optional<Digest>(const Digest& left, const Digest& right)>;
+
+        static constexpr unsigned char LEAF_PREFIX = 0x00;
+        static constexpr unsigned char NODE_PREFIX = 0x01;
+        static constexpr const wchar_t* LAYOUT = L"rfc6962";
+
+        // Builds every level above the given leaf digests; nullopt for no leaves
+        // or when the hasher fails.
+        static std::optional<MerkleTree> Build(std::vector<Digest> leaves, const NodeHasher& hasher);
+
+        const Digest& Root() const { return m_levels.back().front(); }
+        size_t LeafCount() const { return m_levels.front().size(); }
+        const Digest& Leaf(size_t index) const { return m_levels.front()[index]; }
+
+        // Sibling digests from the leaf level upwards; promoted levels have no entry.
+        std::vector<Digest> AuditPath(size_t index) const;
+
+        // Folds a leaf digest and its audit path back into a root.
+        static std::optional<Digest> RootFromAuditPath(
+            const Digest& leaf,
+            size_t index,
+            size_t leafCount,
+            const std::vector<Digest>& auditPath,
+            const NodeHasher& hasher);
+
+    private:
+        std::vector<std::vector<Digest>> m_levels;
+    };
+}
@@ -0,0 +1,129 @@
+#include "SecureArena.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace gost;
+
+namespace
+{
+    void SecureZero(void* data, size_t size)
+    {
+        volatile unsigned char* bytes = static_cast<volatile unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            bytes[i] = 0;
+        }
+    }
+
+    size_t PageSize()
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        long size = sysconf(_SC_PAGESIZE);
+        return size > 0 ? static_cast<size_t>(size) : 4096;
+#endif
+    }
+}
+
+SecureArena::SecureArena(size_t capacity)
+{
+    const size_t page = PageSize();
+    m_capacity = (capacity + page - 1) / page * page;
+
+#ifdef _WIN32
+    m_data = static_cast<unsigned char*>(VirtualAlloc(nullptr, m_capacity, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (m_data)
+    {
+        m_mapped = true;
+        m_locked = VirtualLock(m_data, m_capacity) != FALSE;
+    }
+#else
+    void* data = mmap(nullptr, m_capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data != MAP_FAILED)
+    {
+        m_data = static_cast<unsigned char*>(data);
+        m_mapped = true;
+        m_locked = mlock(m_data, m_capacity) == 0;
+#ifdef MADV_DONTDUMP
+        madvise(m_data, m_capacity, MADV_DONTDUMP);
+#endif
+    }
+#endif
+
+    // Still wiped, just not locked.
+    if (!m_data)
+    {
+        m_data = new (std::nothrow) unsigned char[m_capacity];
+        if (!m_data)
+        {
+            m_capacity = 0;
+        }
+    }
+}
+
+SecureArena::~SecureArena()
+{
+    if (!m_data)
+    {
+        return;
+    }
+    Reset();
+
+    if (!m_mapped)
+    {
+        delete[] m_data;
+        return;
+    }
+#ifdef _WIN32
+    if (m_locked)
+    {
+        VirtualUnlock(m_data, m_capacity);
+    }
+    VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+    if (m_locked)
+    {
+        munlock(m_data, m_capacity);
+    }
+    munmap(m_data, m_capacity);
+#endif
+}
+
+void* SecureArena::Allocate(size_t size, size_t alignment)
+{
+    size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+    if (offset > m_capacity || size > m_capacity - offset)
+    {
+        return nullptr;
+    }
+    m_used = offset + size;
+    return m_data + offset;
+}
+
+void SecureArena::Release(void* data, size_t size)
+{
+    SecureZero(data, size);
+    // The most recent block can be handed out again at once, which keeps a
+    // growing vector from walking through the region.
+    if (static_cast<unsigned char*>(data) + size == m_data + m_used)
+    {
+        m_used -= size;
+    }
+}
+
+void SecureArena::Reset()
+{
+    SecureZero(m_data, m_used);
+    m_used = 0;
+}
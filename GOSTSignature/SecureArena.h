@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace gost
+{
+    // Bump allocator for key material and per-operation scratch space. The
+    // region is mapped once, locked into RAM where the OS allows it (so it
+    // never reaches swap) and excluded from core dumps. Blocks are wiped when
+    // released; Reset() wipes what was handed out since the previous reset
+    // and rewinds, so its cost depends on the few hundred bytes one signature
+    // uses rather than on the capacity.
+    class SecureArena
+    {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 64 << 10;
+        // One page, for an arena that holds a single long-lived key.
+        static constexpr size_t KEY_CAPACITY = 4 << 10;
+
+        explicit SecureArena(size_t capacity = DEFAULT_CAPACITY);
+        ~SecureArena();
+
+        SecureArena(const SecureArena&) = delete;
+        SecureArena& operator=(const SecureArena&) = delete;
+
+        // nullptr once the region is full.
+        void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+        // Wipes the block; its space is reclaimed by the next Reset().
+        void Release(void* data, size_t size);
+        void Reset();
+
+        size_t Used() const { return m_used; }
+        size_t Capacity() const { return m_capacity; }
+        // False if the OS refused to lock the pages (e.g. RLIMIT_MEMLOCK).
+        bool IsLocked() const { return m_locked; }
+
+        // Resets the arena when the enclosing operation ends, on every path.
+        class Scope
+        {
+        public:
+            explicit Scope(SecureArena& arena) : m_arena(arena) {}
+            ~Scope() { m_arena.Reset(); }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            SecureArena& m_arena;
+        };
+
+    private:
+        unsigned char* m_data = nullptr;
+        size_t m_capacity = 0;
+        size_t m_used = 0;
+        bool m_mapped = false;
+        bool m_locked = false;
+    };
+
+    // Standard allocator over a SecureArena, for containers that hold secrets.
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(SecureArena& arena) : m_arena(&arena) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.Arena()) {}
+
+        T* allocate(size_t count)
+        {
+            if (count > static_cast<size_t>(-1) / sizeof(T))
+            {
+                throw std::bad_alloc();
+            }
+            void* data = m_arena->Allocate(count * sizeof(T), alignof(T));
+            if (!data)
+            {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(data);
+        }
+
+        void deallocate(T* data, size_t count)
+        {
+            m_arena->Release(data, count * sizeof(T));
+        }
+
+        SecureArena* Arena() const { return m_arena; }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.Arena(); }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.Arena(); }
+
+    private:
+        SecureArena* m_arena;
+    };
+
+    using SecureBytes = std::vector<unsigned char, ArenaAllocator<unsigned char>>;
+}
@@ -0,0 +1,1151 @@
+#include "Sha.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(GOST_X86)
+#include <immintrin.h>
+#elif defined(GOST_ARM64)
+#include <arm_neon.h>
+#endif
+
+using namespace gost;
+
+namespace
+{
+    const uint32_t K256[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t INITIAL256[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    inline uint32_t Rotr(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    inline uint32_t Rotl(uint32_t x, int n)
+    {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    inline uint32_t LoadBigEndian(const unsigned char* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+            | (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    inline void StoreBigEndian(unsigned char* p, uint32_t value)
+    {
+        p[0] = static_cast<unsigned char>(value >> 24);
+        p[1] = static_cast<unsigned char>(value >> 16);
+        p[2] = static_cast<unsigned char>(value >> 8);
+        p[3] = static_cast<unsigned char>(value);
+    }
+
+    // Buffers partial blocks and hands runs of complete blocks to compress.
+    template <typename Compress>
+    void Absorb(unsigned char* buffer, size_t& bufferSize, size_t blockSize, const unsigned char* data, size_t size, Compress compress)
+    {
+        if (bufferSize > 0)
+        {
+            size_t take = blockSize - bufferSize;
+            if (take > size)
+            {
+                take = size;
+            }
+            std::memcpy(buffer + bufferSize, data, take);
+            bufferSize += take;
+            data += take;
+            size -= take;
+
+            if (bufferSize < blockSize)
+            {
+                return;
+            }
+
+            compress(buffer, 1);
+            bufferSize = 0;
+        }
+
+        if (size >= blockSize)
+        {
+            const size_t blocks = size / blockSize;
+            compress(data, blocks);
+            data += blocks * blockSize;
+            size -= blocks * blockSize;
+        }
+
+        if (size > 0)
+        {
+            std::memcpy(buffer, data, size);
+            bufferSize = size;
+        }
+    }
+
+    // Merkle-Damgard padding shared by SHA-1 and SHA-256: 0x80, zeros and the
+    // message length in bits as a big-endian 64-bit integer.
+    template <typename Compress>
+    void Pad(unsigned char* buffer, size_t bufferSize, uint64_t totalBytes, Compress compress)
+    {
+        const size_t blockSize = 64;
+        buffer[bufferSize++] = 0x80;
+        if (bufferSize > blockSize - 8)
+        {
+            std::memset(buffer + bufferSize, 0, blockSize - bufferSize);
+            compress(buffer, 1);
+            bufferSize = 0;
+        }
+        std::memset(buffer + bufferSize, 0, blockSize - 8 - bufferSize);
+
+        uint64_t bits = totalBytes * 8;
+        StoreBigEndian(buffer + blockSize - 8, static_cast<uint32_t>(bits >> 32));
+        StoreBigEndian(buffer + blockSize - 4, static_cast<uint32_t>(bits));
+        compress(buffer, 1);
+    }
+
+    // ---------------- Block functions ----------------
+    // Each compresses a run of 64-byte blocks into state, which holds the
+    // chaining words in order: eight for SHA-256, five for SHA-1.
+    using BlockFunction = void (*)(uint32_t* state, const unsigned char* data, size_t blocks);
+
+    void Sha256Scalar(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        for (; blocks > 0; --blocks, data += 64)
+        {
+            uint32_t w[64];
+            for (int i = 0; i < 16; ++i)
+            {
+                w[i] = LoadBigEndian(data + 4 * i);
+            }
+            for (int i = 16; i < 64; ++i)
+            {
+                uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; ++i)
+            {
+                uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+                uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+    void Sha1Scalar(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        for (; blocks > 0; --blocks, data += 64)
+        {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i)
+            {
+                w[i] = LoadBigEndian(data + 4 * i);
+            }
+            for (int i = 16; i < 80; ++i)
+            {
+                w[i] = Rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+            for (int i = 0; i < 80; ++i)
+            {
+                uint32_t f;
+                uint32_t k;
+                if (i < 20)
+                {
+                    f = (b & c) | (~b & d);
+                    k = 0x5a827999;
+                }
+                else if (i < 40)
+                {
+                    f = b ^ c ^ d;
+                    k = 0x6ed9eba1;
+                }
+                else if (i < 60)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8f1bbcdc;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    k = 0xca62c1d6;
+                }
+
+                uint32_t t = Rotl(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = Rotl(b, 30);
+                b = a;
+                a = t;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+    }
+
+#if defined(GOST_X86)
+    // sigma0 and sigma1 of the SHA-256 message schedule on eight words.
+    GOST_TARGET("avx2,bmi2")
+    inline __m256i ScheduleSigma0(__m256i x)
+    {
+        return _mm256_xor_si256(_mm256_xor_si256(
+            _mm256_or_si256(_mm256_srli_epi32(x, 7), _mm256_slli_epi32(x, 25)),
+            _mm256_or_si256(_mm256_srli_epi32(x, 18), _mm256_slli_epi32(x, 14))),
+            _mm256_srli_epi32(x, 3));
+    }
+
+    GOST_TARGET("avx2,bmi2")
+    inline __m256i ScheduleSigma1(__m256i x)
+    {
+        return _mm256_xor_si256(_mm256_xor_si256(
+            _mm256_or_si256(_mm256_srli_epi32(x, 17), _mm256_slli_epi32(x, 15)),
+            _mm256_or_si256(_mm256_srli_epi32(x, 19), _mm256_slli_epi32(x, 13))),
+            _mm256_srli_epi32(x, 10));
+    }
+
+    // The 64 rounds over a precomputed W + K; wk[i] is that word for round i.
+    GOST_TARGET("avx2,bmi2")
+    inline void Sha256Rounds(uint32_t* state, const uint32_t* schedule, size_t half)
+    {
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i)
+        {
+            uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + schedule[(i / 4) * 8 + half * 4 + (i & 3)];
+            uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    // Two blocks at a time: the message schedules of both are computed in the
+    // two 128-bit halves of YMM registers, four words per step, and the rounds
+    // run in scalar code, where BMI2 turns every rotate into one RORX.
+    GOST_TARGET("avx2,bmi2")
+    void Sha256Avx2(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        const __m256i byteSwap = _mm256_broadcastsi128_si256(_mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+        alignas(32) uint32_t schedule[16][8];
+
+        while (blocks > 0)
+        {
+            const size_t pair = blocks >= 2 ? 2 : 1;
+            const unsigned char* second = pair == 2 ? data + 64 : data;
+
+            __m256i x[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i));
+                __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + 16 * i));
+                x[i] = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), byteSwap);
+            }
+
+            // Step g holds W[4g .. 4g+3] in x[g % 4] and turns it into W[4g+16 .. 4g+19].
+            for (int g = 0; g < 16; ++g)
+            {
+                __m256i& w16 = x[g & 3];
+                const __m256i k = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(K256 + 4 * g)));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(schedule[g]), _mm256_add_epi32(w16, k));
+                if (g >= 12)
+                {
+                    continue;
+                }
+
+                const __m256i w12 = x[(g + 1) & 3];
+                const __m256i w8 = x[(g + 2) & 3];
+                const __m256i w4 = x[(g + 3) & 3];
+                __m256i next = _mm256_add_epi32(_mm256_add_epi32(w16, ScheduleSigma0(_mm256_alignr_epi8(w12, w16, 4))),
+                    _mm256_alignr_epi8(w4, w8, 4));
+                // The first two new words need W[t-2] and W[t-1], the last two need
+                // the first two.
+                next = _mm256_add_epi32(next, _mm256_blend_epi32(_mm256_setzero_si256(),
+                    ScheduleSigma1(_mm256_shuffle_epi32(w4, 0xEE)), 0x33));
+                next = _mm256_add_epi32(next, _mm256_blend_epi32(_mm256_setzero_si256(),
+                    ScheduleSigma1(_mm256_shuffle_epi32(next, 0x44)), 0xCC));
+                w16 = next;
+            }
+
+            Sha256Rounds(state, &schedule[0][0], 0);
+            if (pair == 2)
+            {
+                Sha256Rounds(state, &schedule[0][0], 1);
+            }
+            data += 64 * pair;
+            blocks -= pair;
+        }
+    }
+
+    // Intel SHA extensions. The instructions keep the state as ABEF and CDGH
+    // word pairs; each SHA256RNDS2 does two rounds and the MSG1/MSG2 pair
+    // extends the message schedule four words at a time.
+    GOST_TARGET("sha,sse4.1")
+    void Sha256ShaExtensions(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+        __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+        __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+        __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+        __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+        for (; blocks > 0; --blocks, data += 64)
+        {
+            const __m128i abefSaved = abef;
+            const __m128i cdghSaved = cdgh;
+            __m128i message[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+            }
+
+            for (int g = 0; g < 16; ++g)
+            {
+                __m128i wk = _mm_add_epi32(message[g & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(K256 + 4 * g)));
+                cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+                abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E));
+                if (g >= 3 && g < 15)
+                {
+                    __m128i& next = message[(g + 1) & 3];
+                    next = _mm_add_epi32(next, _mm_alignr_epi8(message[g & 3], message[(g + 3) & 3], 4));
+                    next = _mm_sha256msg2_epu32(next, message[g & 3]);
+                }
+                if (g >= 1 && g < 13)
+                {
+                    message[(g + 3) & 3] = _mm_sha256msg1_epu32(message[(g + 3) & 3], message[g & 3]);
+                }
+            }
+
+            abef = _mm_add_epi32(abef, abefSaved);
+            cdgh = _mm_add_epi32(cdgh, cdghSaved);
+        }
+
+        __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+        __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+    }
+
+    // SHA1RNDS4 takes the round function as an immediate.
+    GOST_TARGET("sha,sse4.1")
+    inline __m128i Sha1Rounds4(__m128i abcd, __m128i e, int group)
+    {
+        switch (group / 5)
+        {
+        case 0:
+            return _mm_sha1rnds4_epu32(abcd, e, 0);
+        case 1:
+            return _mm_sha1rnds4_epu32(abcd, e, 1);
+        case 2:
+            return _mm_sha1rnds4_epu32(abcd, e, 2);
+        default:
+            return _mm_sha1rnds4_epu32(abcd, e, 3);
+        }
+    }
+
+    // Twenty groups of four rounds. E alternates between two registers:
+    // SHA1NEXTE derives the next group's E from the ABCD saved before the
+    // current one and adds the message words.
+    GOST_TARGET("sha,sse4.1")
+    void Sha1ShaExtensions(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+        __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+        for (; blocks > 0; --blocks, data += 64)
+        {
+            const __m128i abcdSaved = abcd;
+            const __m128i eSaved = e0;
+            __m128i message[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                message[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+            }
+
+            __m128i e[2] = { e0, _mm_setzero_si128() };
+            for (int g = 0; g < 20; ++g)
+            {
+                __m128i& current = e[g & 1];
+                current = g == 0 ? _mm_add_epi32(current, message[0]) : _mm_sha1nexte_epu32(current, message[g & 3]);
+                e[(g + 1) & 1] = abcd;
+                if (g >= 3 && g < 19)
+                {
+                    message[(g + 1) & 3] = _mm_sha1msg2_epu32(message[(g + 1) & 3], message[g & 3]);
+                }
+                abcd = Sha1Rounds4(abcd, current, g);
+                if (g >= 1 && g < 17)
+                {
+                    message[(g + 3) & 3] = _mm_sha1msg1_epu32(message[(g + 3) & 3], message[g & 3]);
+                }
+                if (g >= 2 && g < 18)
+                {
+                    message[(g + 2) & 3] = _mm_xor_si128(message[(g + 2) & 3], message[g & 3]);
+                }
+            }
+
+            e0 = _mm_sha1nexte_epu32(e[0], eSaved);
+            abcd = _mm_add_epi32(abcd, abcdSaved);
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+        state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+    }
+#endif
+
+#if defined(GOST_ARM64)
+    // ARMv8 crypto extension: SHA256H/SHA256H2 do four rounds on ABCD and
+    // EFGH, SHA256SU0/SU1 extend the schedule four words at a time.
+    GOST_TARGET_ARM_CRYPTO
+    void Sha256ArmCrypto(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        uint32x4_t abcd = vld1q_u32(state);
+        uint32x4_t efgh = vld1q_u32(state + 4);
+
+        for (; blocks > 0; --blocks, data += 64)
+        {
+            const uint32x4_t abcdSaved = abcd;
+            const uint32x4_t efghSaved = efgh;
+            uint32x4_t message[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                message[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+            }
+
+            for (int g = 0; g < 16; ++g)
+            {
+                const uint32x4_t wk = vaddq_u32(message[g & 3], vld1q_u32(K256 + 4 * g));
+                if (g < 12)
+                {
+                    message[g & 3] = vsha256su1q_u32(vsha256su0q_u32(message[g & 3], message[(g + 1) & 3]),
+                        message[(g + 2) & 3], message[(g + 3) & 3]);
+                }
+                const uint32x4_t abcdBefore = abcd;
+                abcd = vsha256hq_u32(abcd, efgh, wk);
+                efgh = vsha256h2q_u32(efgh, abcdBefore, wk);
+            }
+
+            abcd = vaddq_u32(abcd, abcdSaved);
+            efgh = vaddq_u32(efgh, efghSaved);
+        }
+
+        vst1q_u32(state, abcd);
+        vst1q_u32(state + 4, efgh);
+    }
+
+    // SHA1C, SHA1P and SHA1M are the choose, parity and majority rounds; SHA1H
+    // gives the next E from A.
+    GOST_TARGET_ARM_CRYPTO
+    void Sha1ArmCrypto(uint32_t* state, const unsigned char* data, size_t blocks)
+    {
+        static const uint32_t ROUND_CONSTANTS[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6 };
+        uint32x4_t abcd = vld1q_u32(state);
+        uint32_t e = state[4];
+
+        for (; blocks > 0; --blocks, data += 64)
+        {
+            const uint32x4_t abcdSaved = abcd;
+            const uint32_t eSaved = e;
+            uint32x4_t message[4];
+            for (int i = 0; i < 4; ++i)
+            {
+                message[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+            }
+
+            for (int g = 0; g < 20; ++g)
+            {
+                const uint32x4_t wk = vaddq_u32(message[g & 3], vdupq_n_u32(ROUND_CONSTANTS[g / 5]));
+                if (g < 16)
+                {
+                    message[g & 3] = vsha1su1q_u32(vsha1su0q_u32(message[g & 3], message[(g + 1) & 3], message[(g + 2) & 3]),
+                        message[(g + 3) & 3]);
+                }
+                const uint32_t nextE = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+                if (g < 5)
+                {
+                    abcd = vsha1cq_u32(abcd, e, wk);
+                }
+                else if (g >= 10 && g < 15)
+                {
+                    abcd = vsha1mq_u32(abcd, e, wk);
+                }
+                else
+                {
+                    abcd = vsha1pq_u32(abcd, e, wk);
+                }
+                e = nextE;
+            }
+
+            abcd = vaddq_u32(abcd, abcdSaved);
+            e += eSaved;
+        }
+
+        vst1q_u32(state, abcd);
+        state[4] = e;
+    }
+#endif
+
+    struct BlockKernel
+    {
+        ShaKernel kernel;
+        BlockFunction compress;
+        bool (*supported)(const CpuFeatures& cpu);
+    };
+
+    // Every kernel compiled into this build, best first. The scalar one is
+    // always last and always runs.
+    const BlockKernel SHA256_KERNELS[] = {
+#if defined(GOST_X86)
+        { ShaKernel::ShaExtensions, Sha256ShaExtensions, [](const CpuFeatures& cpu) { return cpu.sha256; } },
+        { ShaKernel::Avx2, Sha256Avx2, [](const CpuFeatures& cpu) { return cpu.avx2 && cpu.bmi2; } },
+#elif defined(GOST_ARM64)
+        { ShaKernel::ArmCrypto, Sha256ArmCrypto, [](const CpuFeatures& cpu) { return cpu.sha256; } },
+#endif
+        { ShaKernel::Scalar, Sha256Scalar, [](const CpuFeatures&) { return true; } },
+    };
+
+    const BlockKernel SHA1_KERNELS[] = {
+#if defined(GOST_X86)
+        { ShaKernel::ShaExtensions, Sha1ShaExtensions, [](const CpuFeatures& cpu) { return cpu.sha1; } },
+#elif defined(GOST_ARM64)
+        { ShaKernel::ArmCrypto, Sha1ArmCrypto, [](const CpuFeatures& cpu) { return cpu.sha1; } },
+#endif
+        { ShaKernel::Scalar, Sha1Scalar, [](const CpuFeatures&) { return true; } },
+    };
+
+    template <size_t COUNT>
+    const BlockKernel* FindKernel(const BlockKernel (&kernels)[COUNT], ShaKernel kernel)
+    {
+        for (const BlockKernel& candidate : kernels)
+        {
+            if (candidate.kernel == kernel && candidate.supported(CpuFeatures::Get()))
+            {
+                return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    template <size_t COUNT>
+    const BlockKernel* BestKernel(const BlockKernel (&kernels)[COUNT])
+    {
+        for (const BlockKernel& candidate : kernels)
+        {
+            if (candidate.supported(CpuFeatures::Get()))
+            {
+                return &candidate;
+            }
+        }
+        return &kernels[COUNT - 1];
+    }
+
+    template <size_t COUNT>
+    std::vector<ShaKernel> SupportedKernels(const BlockKernel (&kernels)[COUNT])
+    {
+        std::vector<ShaKernel> supported;
+        for (const BlockKernel& candidate : kernels)
+        {
+            if (candidate.supported(CpuFeatures::Get()))
+            {
+                supported.push_back(candidate.kernel);
+            }
+        }
+        return supported;
+    }
+
+    // Chosen once per process, on first use, from CpuFeatures; ForceKernel
+    // may replace the choice later.
+    std::atomic<const BlockKernel*>& Sha256Selected()
+    {
+        static std::atomic<const BlockKernel*> selected{ BestKernel(SHA256_KERNELS) };
+        return selected;
+    }
+
+    std::atomic<const BlockKernel*>& Sha1Selected()
+    {
+        static std::atomic<const BlockKernel*> selected{ BestKernel(SHA1_KERNELS) };
+        return selected;
+    }
+
+    const BlockKernel& Sha256Kernel()
+    {
+        return *Sha256Selected().load(std::memory_order_relaxed);
+    }
+
+    const BlockKernel& Sha1Kernel()
+    {
+        return *Sha1Selected().load(std::memory_order_relaxed);
+    }
+
+    // ---------------- Multi-buffer SHA-256 ----------------
+    // A lane kernel runs one compression in each of its LANES lanes. Word i of
+    // lane j's state is state[i * LANES + j]; blocks[j] is lane j's next block.
+    using LaneKernel = void (*)(uint32_t* state, const unsigned char* const* blocks);
+
+    constexpr size_t MAX_LANES = 16;
+
+    // Lane count set by ForceLanes; 0 leaves the choice to Lanes().
+    std::atomic<size_t>& ForcedLanes()
+    {
+        static std::atomic<size_t> forced{ 0 };
+        return forced;
+    }
+    const unsigned char SCRATCH_BLOCK[64] = {};
+
+    // Block words transposed so that word i of every lane is contiguous.
+    template <size_t LANES>
+    void LoadWords(const unsigned char* const* blocks, uint32_t (&words)[16][LANES])
+    {
+        for (size_t j = 0; j < LANES; ++j)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                words[i][j] = LoadBigEndian(blocks[j] + 4 * i);
+            }
+        }
+    }
+
+#if defined(GOST_X86)
+    template <int N>
+    GOST_TARGET("ssse3")
+    inline __m128i Rotr(__m128i x)
+    {
+        return _mm_or_si128(_mm_srli_epi32(x, N), _mm_slli_epi32(x, 32 - N));
+    }
+
+    GOST_TARGET("ssse3")
+    void CompressX4(uint32_t* state, const unsigned char* const* blocks)
+    {
+        uint32_t words[16][4];
+        LoadWords(blocks, words);
+
+        __m128i v[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            v[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4 * i));
+        }
+        __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+        __m128i w[16];
+        for (int i = 0; i < 64; ++i)
+        {
+            if (i < 16)
+            {
+                w[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words[i]));
+            }
+            else
+            {
+                __m128i w15 = w[(i - 15) & 15];
+                __m128i w2 = w[(i - 2) & 15];
+                __m128i s0 = _mm_xor_si128(_mm_xor_si128(Rotr<7>(w15), Rotr<18>(w15)), _mm_srli_epi32(w15, 3));
+                __m128i s1 = _mm_xor_si128(_mm_xor_si128(Rotr<17>(w2), Rotr<19>(w2)), _mm_srli_epi32(w2, 10));
+                w[i & 15] = _mm_add_epi32(_mm_add_epi32(w[i & 15], s0), _mm_add_epi32(w[(i - 7) & 15], s1));
+            }
+
+            __m128i sum1 = _mm_xor_si128(_mm_xor_si128(Rotr<6>(e), Rotr<11>(e)), Rotr<25>(e));
+            __m128i choose = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+            __m128i t1 = _mm_add_epi32(_mm_add_epi32(h, sum1), _mm_add_epi32(choose,
+                _mm_add_epi32(_mm_set1_epi32(static_cast<int>(K256[i])), w[i & 15])));
+            __m128i sum0 = _mm_xor_si128(_mm_xor_si128(Rotr<2>(a), Rotr<13>(a)), Rotr<22>(a));
+            __m128i majority = _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(c, _mm_or_si128(a, b)));
+            __m128i t2 = _mm_add_epi32(sum0, majority);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm_add_epi32(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm_add_epi32(t1, t2);
+        }
+
+        const __m128i result[8] = { a, b, c, d, e, f, g, h };
+        for (int i = 0; i < 8; ++i)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4 * i), _mm_add_epi32(v[i], result[i]));
+        }
+    }
+
+    template <int N>
+    GOST_TARGET("avx2")
+    inline __m256i Rotr(__m256i x)
+    {
+        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+    }
+
+    GOST_TARGET("avx2")
+    void CompressX8(uint32_t* state, const unsigned char* const* blocks)
+    {
+        uint32_t words[16][8];
+        LoadWords(blocks, words);
+
+        __m256i v[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state + 8 * i));
+        }
+        __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+        __m256i w[16];
+        for (int i = 0; i < 64; ++i)
+        {
+            if (i < 16)
+            {
+                w[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words[i]));
+            }
+            else
+            {
+                __m256i w15 = w[(i - 15) & 15];
+                __m256i w2 = w[(i - 2) & 15];
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr<7>(w15), Rotr<18>(w15)), _mm256_srli_epi32(w15, 3));
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr<17>(w2), Rotr<19>(w2)), _mm256_srli_epi32(w2, 10));
+                w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0), _mm256_add_epi32(w[(i - 7) & 15], s1));
+            }
+
+            __m256i sum1 = _mm256_xor_si256(_mm256_xor_si256(Rotr<6>(e), Rotr<11>(e)), Rotr<25>(e));
+            __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sum1), _mm256_add_epi32(choose,
+                _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(K256[i])), w[i & 15])));
+            __m256i sum0 = _mm256_xor_si256(_mm256_xor_si256(Rotr<2>(a), Rotr<13>(a)), Rotr<22>(a));
+            __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            __m256i t2 = _mm256_add_epi32(sum0, majority);
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi32(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm256_add_epi32(t1, t2);
+        }
+
+        const __m256i result[8] = { a, b, c, d, e, f, g, h };
+        for (int i = 0; i < 8; ++i)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(state + 8 * i), _mm256_add_epi32(v[i], result[i]));
+        }
+    }
+
+    // The zero-masking forms with every lane selected: GCC 12 warns about the
+    // undefined pass-through operand of the plain shift and rotate intrinsics.
+    template <int N>
+    GOST_TARGET("avx512f")
+    inline __m512i Rotr(__m512i x)
+    {
+        return _mm512_maskz_ror_epi32(0xFFFF, x, N);
+    }
+
+    template <int N>
+    GOST_TARGET("avx512f")
+    inline __m512i Shr(__m512i x)
+    {
+        return _mm512_maskz_srli_epi32(0xFFFF, x, N);
+    }
+
+    // AVX-512F has native rotates and three-input logic: 0x96 is a ^ b ^ c,
+    // 0xCA picks b or c by a (Ch), 0xE8 is the bitwise majority (Maj).
+    GOST_TARGET("avx512f")
+    void CompressX16(uint32_t* state, const unsigned char* const* blocks)
+    {
+        uint32_t words[16][16];
+        LoadWords(blocks, words);
+
+        __m512i v[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            v[i] = _mm512_loadu_si512(state + 16 * i);
+        }
+        __m512i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+        __m512i w[16];
+        for (int i = 0; i < 64; ++i)
+        {
+            if (i < 16)
+            {
+                w[i] = _mm512_loadu_si512(words[i]);
+            }
+            else
+            {
+                __m512i w15 = w[(i - 15) & 15];
+                __m512i w2 = w[(i - 2) & 15];
+                __m512i s0 = _mm512_ternarylogic_epi32(Rotr<7>(w15), Rotr<18>(w15), Shr<3>(w15), 0x96);
+                __m512i s1 = _mm512_ternarylogic_epi32(Rotr<17>(w2), Rotr<19>(w2), Shr<10>(w2), 0x96);
+                w[i & 15] = _mm512_add_epi32(_mm512_add_epi32(w[i & 15], s0), _mm512_add_epi32(w[(i - 7) & 15], s1));
+            }
+
+            __m512i sum1 = _mm512_ternarylogic_epi32(Rotr<6>(e), Rotr<11>(e), Rotr<25>(e), 0x96);
+            __m512i choose = _mm512_ternarylogic_epi32(e, f, g, 0xCA);
+            __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, sum1), _mm512_add_epi32(choose,
+                _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(K256[i])), w[i & 15])));
+            __m512i sum0 = _mm512_ternarylogic_epi32(Rotr<2>(a), Rotr<13>(a), Rotr<22>(a), 0x96);
+            __m512i t2 = _mm512_add_epi32(sum0, _mm512_ternarylogic_epi32(a, b, c, 0xE8));
+            h = g;
+            g = f;
+            f = e;
+            e = _mm512_add_epi32(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = _mm512_add_epi32(t1, t2);
+        }
+
+        const __m512i result[8] = { a, b, c, d, e, f, g, h };
+        for (int i = 0; i < 8; ++i)
+        {
+            _mm512_storeu_si512(state + 16 * i, _mm512_add_epi32(v[i], result[i]));
+        }
+    }
+#endif
+
+    // Runs up to lanes messages through the kernel in lockstep. Each message's
+    // last partial block and padding are built in its own tail buffer; a lane
+    // whose message has ended, or that has none, compresses SCRATCH_BLOCK and
+    // its state is never read again.
+    void HashGroup(LaneKernel compress, size_t lanes, const unsigned char* const* data, const size_t* sizes, size_t count, unsigned char* const* digests)
+    {
+        uint32_t state[8 * MAX_LANES];
+        unsigned char tails[MAX_LANES][128];
+        size_t fullBlocks[MAX_LANES] = {};
+        size_t totalBlocks[MAX_LANES] = {};
+        size_t steps = 0;
+        for (size_t j = 0; j < lanes; ++j)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                state[i * lanes + j] = INITIAL256[i];
+            }
+            if (j >= count)
+            {
+                continue;
+            }
+
+            const size_t size = sizes[j];
+            const size_t rest = size % 64;
+            fullBlocks[j] = size / 64;
+            if (rest > 0)
+            {
+                std::memcpy(tails[j], data[j] + size - rest, rest);
+            }
+            tails[j][rest] = 0x80;
+            const size_t tailSize = rest + 9 <= 64 ? 64 : 128;
+            std::memset(tails[j] + rest + 1, 0, tailSize - rest - 1 - 8);
+            const uint64_t bits = static_cast<uint64_t>(size) * 8;
+            StoreBigEndian(tails[j] + tailSize - 8, static_cast<uint32_t>(bits >> 32));
+            StoreBigEndian(tails[j] + tailSize - 4, static_cast<uint32_t>(bits));
+
+            totalBlocks[j] = fullBlocks[j] + tailSize / 64;
+            steps = std::max(steps, totalBlocks[j]);
+        }
+
+        const unsigned char* blocks[MAX_LANES];
+        for (size_t step = 0; step < steps; ++step)
+        {
+            for (size_t j = 0; j < lanes; ++j)
+            {
+                if (step < fullBlocks[j])
+                {
+                    blocks[j] = data[j] + 64 * step;
+                }
+                else if (step < totalBlocks[j])
+                {
+                    blocks[j] = tails[j] + 64 * (step - fullBlocks[j]);
+                }
+                else
+                {
+                    blocks[j] = SCRATCH_BLOCK;
+                }
+            }
+            compress(state, blocks);
+
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (step + 1 == totalBlocks[j])
+                {
+                    for (int i = 0; i < 8; ++i)
+                    {
+                        StoreBigEndian(digests[j] + 4 * i, state[i * lanes + j]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+const char* gost::ShaKernelName(ShaKernel kernel)
+{
+    switch (kernel)
+    {
+    case ShaKernel::Avx2:
+        return "avx2";
+    case ShaKernel::ShaExtensions:
+        return "sha-ni";
+    case ShaKernel::ArmCrypto:
+        return "armv8-crypto";
+    default:
+        return "scalar";
+    }
+}
+
+// ---------------- SHA-256 ----------------
+Sha256::Sha256()
+{
+    Reset();
+}
+
+void Sha256::Reset()
+{
+    std::memcpy(m_h, INITIAL256, sizeof(m_h));
+    m_bufferSize = 0;
+    m_totalBytes = 0;
+}
+
+void Sha256::Update(const unsigned char* data, size_t size)
+{
+    m_totalBytes += size;
+    const BlockFunction compress = Sha256Kernel().compress;
+    Absorb(m_buffer, m_bufferSize, BLOCK_SIZE, data, size, [this, compress](const unsigned char* blocks, size_t count) { compress(m_h, blocks, count); });
+}
+
+void Sha256::Finish(unsigned char* digest)
+{
+    const BlockFunction compress = Sha256Kernel().compress;
+    Pad(m_buffer, m_bufferSize, m_totalBytes, [this, compress](const unsigned char* block, size_t count) { compress(m_h, block, count); });
+    for (int i = 0; i < 8; ++i)
+    {
+        StoreBigEndian(digest + 4 * i, m_h[i]);
+    }
+    Reset();
+}
+
+std::vector<unsigned char> Sha256::Hash(const unsigned char* data, size_t size)
+{
+    Sha256 sha;
+    sha.Update(data, size);
+    std::vector<unsigned char> digest(DIGEST_SIZE);
+    sha.Finish(digest.data());
+    return digest;
+}
+
+ShaKernel Sha256::Kernel()
+{
+    return Sha256Kernel().kernel;
+}
+
+std::vector<ShaKernel> Sha256::AvailableKernels()
+{
+    return SupportedKernels(SHA256_KERNELS);
+}
+
+bool Sha256::ForceKernel(ShaKernel kernel)
+{
+    const BlockKernel* found = FindKernel(SHA256_KERNELS, kernel);
+    if (found)
+    {
+        Sha256Selected().store(found, std::memory_order_relaxed);
+    }
+    return found != nullptr;
+}
+
+size_t Sha256::Lanes()
+{
+    const size_t forced = ForcedLanes().load(std::memory_order_relaxed);
+    if (forced != 0)
+    {
+        return forced;
+    }
+#if defined(GOST_X86)
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    if (cpu.avx512f)
+    {
+        return 16;
+    }
+    // One stream on the SHA extensions outruns eight AVX2 lanes.
+    if (cpu.sha256)
+    {
+        return 1;
+    }
+    if (cpu.avx2)
+    {
+        return 8;
+    }
+    if (cpu.ssse3)
+    {
+        return 4;
+    }
+#endif
+    return 1;
+}
+
+std::vector<size_t> Sha256::AvailableLanes()
+{
+    std::vector<size_t> lanes;
+#if defined(GOST_X86)
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    if (cpu.avx512f)
+    {
+        lanes.push_back(16);
+    }
+    if (cpu.avx2)
+    {
+        lanes.push_back(8);
+    }
+    if (cpu.ssse3)
+    {
+        lanes.push_back(4);
+    }
+#endif
+    lanes.push_back(1);
+    return lanes;
+}
+
+bool Sha256::ForceLanes(size_t lanes)
+{
+    if (lanes != 0)
+    {
+        const std::vector<size_t> available = AvailableLanes();
+        if (std::find(available.begin(), available.end(), lanes) == available.end())
+        {
+            return false;
+        }
+    }
+    ForcedLanes().store(lanes, std::memory_order_relaxed);
+    return true;
+}
+
+void Sha256::HashLanes(const unsigned char* const* data, const size_t* sizes, size_t count, unsigned char* const* digests)
+{
+    const size_t lanes = Lanes();
+    LaneKernel compress = nullptr;
+#if defined(GOST_X86)
+    compress = lanes == 16 ? CompressX16 : lanes == 8 ? CompressX8 : lanes == 4 ? CompressX4 : nullptr;
+#endif
+
+    size_t done = 0;
+    // A lone message is faster in the scalar code than in one lane.
+    while (compress && count - done >= 2)
+    {
+        const size_t group = std::min(lanes, count - done);
+        HashGroup(compress, lanes, data + done, sizes + done, group, digests + done);
+        done += group;
+    }
+
+    for (; done < count; ++done)
+    {
+        Sha256 sha;
+        sha.Update(data[done], sizes[done]);
+        sha.Finish(digests[done]);
+    }
+}
+
+// ---------------- SHA-1 ----------------
+Sha1::Sha1()
+{
+    Reset();
+}
+
+void Sha1::Reset()
+{
+    m_h[0] = 0x67452301;
+    m_h[1] = 0xefcdab89;
+    m_h[2] = 0x98badcfe;
+    m_h[3] = 0x10325476;
+    m_h[4] = 0xc3d2e1f0;
+    m_bufferSize = 0;
+    m_totalBytes = 0;
+}
+
+void Sha1::Update(const unsigned char* data, size_t size)
+{
+    m_totalBytes += size;
+    const BlockFunction compress = Sha1Kernel().compress;
+    Absorb(m_buffer, m_bufferSize, BLOCK_SIZE, data, size, [this, compress](const unsigned char* blocks, size_t count) { compress(m_h, blocks, count); });
+}
+
+void Sha1::Finish(unsigned char* digest)
+{
+    const BlockFunction compress = Sha1Kernel().compress;
+    Pad(m_buffer, m_bufferSize, m_totalBytes, [this, compress](const unsigned char* block, size_t count) { compress(m_h, block, count); });
+    for (int i = 0; i < 5; ++i)
+    {
+        StoreBigEndian(digest + 4 * i, m_h[i]);
+    }
+    Reset();
+}
+
+ShaKernel Sha1::Kernel()
+{
+    return Sha1Kernel().kernel;
+}
+
+std::vector<ShaKernel> Sha1::AvailableKernels()
+{
+    return SupportedKernels(SHA1_KERNELS);
+}
+
+bool Sha1::ForceKernel(ShaKernel kernel)
+{
+    const BlockKernel* found = FindKernel(SHA1_KERNELS, kernel);
+    if (found)
+    {
+        Sha1Selected().store(found, std::memory_order_relaxed);
+    }
+    return found != nullptr;
+}
+
+std::vector<unsigned char> Sha1::Hash(const unsigned char* data, size_t size)
+{
+    Sha1 sha;
+    sha.Update(data, size);
+    std::vector<unsigned char> digest(DIGEST_SIZE);
+    sha.Finish(digest.data());
+    return digest;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gost
+{
+    // The code that compresses blocks, picked for this CPU once per process.
+    enum class ShaKernel
+    {
+        Scalar,
+        // SHA-256 message schedule in AVX2 registers, rounds with BMI2 rotates.
+        Avx2,
+        // Intel and AMD SHA extensions.
+        ShaExtensions,
+        // ARMv8 crypto extension.
+        ArmCrypto
+    };
+
+    // "scalar", "avx2", "sha-ni" or "armv8-crypto".
+    const char* ShaKernelName(ShaKernel kernel);
+
+    // FIPS 180-4 SHA-256, with the same interface as Streebog. Blocks go
+    // through the fastest kernel this CPU supports (see Kernel()).
+    class Sha256
+    {
+    public:
+        static constexpr size_t BLOCK_SIZE = 64;
+        static constexpr size_t DIGEST_SIZE = 32;
+
+        Sha256();
+
+        void Reset();
+        void Update(const unsigned char* data, size_t size);
+        void Finish(unsigned char* digest);
+        size_t DigestSize() const { return DIGEST_SIZE; }
+
+        static std::vector<unsigned char> Hash(const unsigned char* data, size_t size);
+        static ShaKernel Kernel();
+
+        // Kernels this build and CPU can run, best first; Scalar is always last.
+        static std::vector<ShaKernel> AvailableKernels();
+        // Sends all later hashing in the process through kernel. For the kernel
+        // self-test and benchmarks; false, with nothing changed, if the kernel
+        // cannot run here.
+        static bool ForceKernel(ShaKernel kernel);
+
+        // Messages HashLanes takes at once on this CPU: 16 with AVX-512; 1 with
+        // the SHA extensions but no AVX-512, as one accelerated stream is
+        // faster than fewer lanes; 8 with AVX2, 4 with SSSE3, otherwise 1.
+        // ForceLanes overrides the choice.
+        static size_t Lanes();
+        // Hashes count independent messages side by side, one per SIMD lane,
+        // writing DIGEST_SIZE bytes to each digests[i]. A group of lanes runs
+        // until its longest message ends, so messages of similar length keep
+        // every lane busy.
+        static void HashLanes(const unsigned char* const* data, const size_t* sizes, size_t count, unsigned char* const* digests);
+        // Lane counts HashLanes can run with here, widest first; 1 is always last.
+        static std::vector<size_t> AvailableLanes();
+        // The same as ForceKernel for HashLanes; 0 goes back to Lanes()'s choice.
+        static bool ForceLanes(size_t lanes);
+
+    private:
+        uint32_t m_h[8];
+        unsigned char m_buffer[BLOCK_SIZE];
+        size_t m_bufferSize = 0;
+        uint64_t m_totalBytes = 0;
+    };
+
+    // FIPS 180-4 SHA-1, kept only for compatibility with existing signatures.
+    class Sha1
+    {
+    public:
+        static constexpr size_t BLOCK_SIZE = 64;
+        static constexpr size_t DIGEST_SIZE = 20;
+
+        Sha1();
+
+        void Reset();
+        void Update(const unsigned char* data, size_t size);
+        void Finish(unsigned char* digest);
+        size_t DigestSize() const { return DIGEST_SIZE; }
+
+        static std::vector<unsigned char> Hash(const unsigned char* data, size_t size);
+        static ShaKernel Kernel();
+
+        // As for Sha256.
+        static std::vector<ShaKernel> AvailableKernels();
+        static bool ForceKernel(ShaKernel kernel);
+
+    private:
+        uint32_t m_h[5];
+        unsigned char m_buffer[BLOCK_SIZE];
+        size_t m_bufferSize = 0;
+        uint64_t m_totalBytes = 0;
+    };
+}
@@ -0,0 +1,206 @@
+#include "SignatureContainer.h"
+#include "GostSigner.h"
+
+using namespace gost;
+
+namespace
+{
+    // Ids are part of the file format: entries may be added, never renumbered.
+    struct ParameterSetId
+    {
+        uint8_t id;
+        const wchar_t* name;
+        size_t size;
+    };
+
+    const ParameterSetId PARAMETER_SETS[] = {
+        { 1, L"id-tc26-gost-3410-2012-256-paramSetA", 32 },
+        { 2, L"id-tc26-gost-3410-2012-256-paramSetB", 32 },
+        { 3, L"id-tc26-gost-3410-2012-512-paramSetC", 64 },
+    };
+
+    struct NameId
+    {
+        uint8_t id;
+        const wchar_t* name;
+    };
+
+    const NameId HASHES[] = {
+        { 1, L"Streebog-256" },
+        { 2, L"Streebog-512" },
+        { 3, L"SHA-256" },
+        { 4, L"SHA-1" },
+    };
+
+    const NameId TREE_LAYOUTS[] = {
+        { 1, MerkleTree::LAYOUT },
+    };
+
+    const ParameterSetId* FindParameterSet(uint8_t id)
+    {
+        for (const auto& entry : PARAMETER_SETS)
+        {
+            if (entry.id == id)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    template <size_t N>
+    const wchar_t* NameOf(const NameId (&table)[N], uint8_t id)
+    {
+        for (const auto& entry : table)
+        {
+            if (entry.id == id)
+            {
+                return entry.name;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename Entry, size_t N>
+    uint8_t IdOf(const Entry (&table)[N], const std::wstring& name)
+    {
+        for (const auto& entry : table)
+        {
+            if (name == entry.name)
+            {
+                return entry.id;
+            }
+        }
+        return 0;
+    }
+
+    uint64_t LoadLittleEndian(const unsigned char* p, size_t size)
+    {
+        uint64_t value = 0;
+        for (size_t i = size; i-- > 0;)
+        {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    void StoreLittleEndian(unsigned char* p, uint64_t value, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            p[i] = static_cast<unsigned char>(value >> (8 * i));
+        }
+    }
+}
+
+std::optional<SignatureView> SignatureView::Parse(const unsigned char* data, size_t size)
+{
+    if (size < HEADER_SIZE
+        || LoadLittleEndian(data, 4) != MAGIC
+        || LoadLittleEndian(data + 4, 2) != VERSION
+        || data[13] != 0 || data[14] != 0 || data[15] != 0)
+    {
+        return std::nullopt;
+    }
+
+    SignatureView view;
+    view.m_data = data;
+    view.m_parameterSet = data[6];
+    view.m_hash = data[7];
+    view.m_signatureSize = static_cast<size_t>(LoadLittleEndian(data + 8, 2));
+    view.m_publicKeySize = static_cast<size_t>(LoadLittleEndian(data + 10, 2));
+    view.m_treeLayout = data[12];
+    view.m_treeChunkSize = LoadLittleEndian(data + 16, 8);
+    view.m_signedAt = static_cast<long long>(LoadLittleEndian(data + 24, 8));
+
+    const ParameterSetId* parameterSet = FindParameterSet(view.m_parameterSet);
+    if (!parameterSet || !view.HashAlgorithm()
+        || view.m_signatureSize != 2 * parameterSet->size
+        || (view.m_publicKeySize != 0 && view.m_publicKeySize != 2 * parameterSet->size)
+        || size != HEADER_SIZE + view.m_signatureSize + view.m_publicKeySize)
+    {
+        return std::nullopt;
+    }
+
+    // Layout and chunk size are both set or both zero.
+    if ((view.m_treeLayout == 0) != (view.m_treeChunkSize == 0)
+        || (view.m_treeLayout != 0 && !view.TreeLayout())
+        || view.m_treeChunkSize > TreeHashOptions::MAX_CHUNK_SIZE)
+    {
+        return std::nullopt;
+    }
+    return view;
+}
+
+const wchar_t* SignatureView::ParameterSet() const
+{
+    const ParameterSetId* parameterSet = FindParameterSet(m_parameterSet);
+    return parameterSet ? parameterSet->name : nullptr;
+}
+
+const wchar_t* SignatureView::HashAlgorithm() const
+{
+    return NameOf(HASHES, m_hash);
+}
+
+const wchar_t* SignatureView::TreeLayout() const
+{
+    return NameOf(TREE_LAYOUTS, m_treeLayout);
+}
+
+std::vector<unsigned char> gost::EncodeSignature(const GostSignature& signature, bool includePublicKey)
+{
+    uint8_t parameterSet = IdOf(PARAMETER_SETS, signature.parameterSet);
+    uint8_t hash = IdOf(HASHES, signature.hashAlgorithm);
+    uint8_t treeLayout = signature.treeChunkSize != 0 ? IdOf(TREE_LAYOUTS, signature.treeLayout) : 0;
+    if (parameterSet == 0 || hash == 0 || (signature.treeChunkSize != 0 && treeLayout == 0))
+    {
+        return {};
+    }
+
+    const size_t signatureSize = signature.signatureHex.size() / 2;
+    const size_t publicKeySize = includePublicKey ? signature.publicKeyHex.size() / 2 : 0;
+    std::vector<unsigned char> container(SignatureView::HEADER_SIZE + signatureSize + publicKeySize);
+    unsigned char* data = container.data();
+    StoreLittleEndian(data, SignatureView::MAGIC, 4);
+    StoreLittleEndian(data + 4, SignatureView::VERSION, 2);
+    data[6] = parameterSet;
+    data[7] = hash;
+    StoreLittleEndian(data + 8, signatureSize, 2);
+    StoreLittleEndian(data + 10, publicKeySize, 2);
+    data[12] = treeLayout;
+    StoreLittleEndian(data + 16, signature.treeChunkSize, 8);
+    StoreLittleEndian(data + 24, static_cast<uint64_t>(signature.signedAt), 8);
+
+    unsigned char* body = data + SignatureView::HEADER_SIZE;
+    if (!DecodeHex(signature.signatureHex.data(), signature.signatureHex.size(), body)
+        || (publicKeySize != 0 && !DecodeHex(signature.publicKeyHex.data(), signature.publicKeyHex.size(), body + signatureSize)))
+    {
+        return {};
+    }
+
+    // Writing only what Parse accepts keeps the two in step.
+    if (!SignatureView::Parse(container.data(), container.size()))
+    {
+        return {};
+    }
+    return container;
+}
+
+GostSignature gost::DecodeSignature(const SignatureView& view)
+{
+    GostSignature signature{};
+    signature.parameterSet = view.ParameterSet();
+    signature.hashAlgorithm = view.HashAlgorithm();
+    signature.signatureHex.resize(2 * view.SignatureSize());
+    EncodeHex(view.Signature(), view.SignatureSize(), &signature.signatureHex[0]);
+    signature.publicKeyHex.resize(2 * view.PublicKeySize());
+    EncodeHex(view.PublicKey(), view.PublicKeySize(), &signature.publicKeyHex[0]);
+    signature.treeChunkSize = view.TreeChunkSize();
+    if (view.TreeLayout())
+    {
+        signature.treeLayout = view.TreeLayout();
+    }
+    signature.signedAt = view.SignedAt();
+    return signature;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace gost
+{
+    struct GostSignature;
+
+    // Detached signature file: a fixed 32-byte little-endian header followed
+    // by r || s and, optionally, the signer's public key x || y.
+    //
+    //    0  magic "GSG1"            4
+    //    4  version                 2
+    //    6  parameter set id        1
+    //    7  hash id                 1
+    //    8  signature size          2
+    //   10  public key size         2   0 if not included
+    //   12  tree layout id          1   0 without a hash tree
+    //   13  reserved, zero          3
+    //   16  tree chunk size         8   0 without a hash tree
+    //   24  signing time            8   seconds since 1970 UTC, 0 if unknown
+    //
+    // Sets, hashes and layouts are stored as ids from fixed tables, so a
+    // reader never parses names or hex.
+    class SignatureView
+    {
+    public:
+        static constexpr uint32_t MAGIC = 0x31475347; // "GSG1"
+        static constexpr uint16_t VERSION = 1;
+        static constexpr size_t HEADER_SIZE = 32;
+
+        // Validates the whole buffer and keeps pointers into it; nothing is
+        // copied or allocated, so the buffer must outlive the view. nullopt for
+        // unknown ids, sizes that do not match the parameter set and trailing
+        // or missing bytes.
+        static std::optional<SignatureView> Parse(const unsigned char* data, size_t size);
+
+        const wchar_t* ParameterSet() const;
+        const wchar_t* HashAlgorithm() const;
+        // nullptr without a hash tree.
+        const wchar_t* TreeLayout() const;
+        unsigned long long TreeChunkSize() const { return m_treeChunkSize; }
+        long long SignedAt() const { return m_signedAt; }
+
+        const unsigned char* Signature() const { return m_data + HEADER_SIZE; }
+        size_t SignatureSize() const { return m_signatureSize; }
+        const unsigned char* PublicKey() const { return m_data + HEADER_SIZE + m_signatureSize; }
+        size_t PublicKeySize() const { return m_publicKeySize; }
+
+    private:
+        SignatureView() = default;
+
+        const unsigned char* m_data = nullptr;
+        uint8_t m_parameterSet = 0;
+        uint8_t m_hash = 0;
+        uint8_t m_treeLayout = 0;
+        size_t m_signatureSize = 0;
+        size_t m_publicKeySize = 0;
+        unsigned long long m_treeChunkSize = 0;
+        long long m_signedAt = 0;
+    };
+
+    // Container for a signature produced by GostSigner; empty if its parameter
+    // set, hash or tree layout has no id or its hex fields do not decode.
+    std::vector<unsigned char> EncodeSignature(const GostSignature& signature, bool includePublicKey = true);
+
+    // The container back in GostSigner's text form, e.g. for display.
+    GostSignature DecodeSignature(const SignatureView& view);
+}
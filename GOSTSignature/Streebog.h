@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gost
+{
+    // GOST R 34.11-2012 (Streebog) with 256- and 512-bit output. The state is
+    // kept as eight little-endian 64-bit words and the LPS transform is done
+    // with eight precomputed 256-entry tables.
+    class Streebog
+    {
+    public:
+        static constexpr size_t BLOCK_SIZE = 64;
+
+        explicit Streebog(size_t digestSize = 64);
+
+        void Reset();
+        void Update(const unsigned char* data, size_t size);
+        void Finish(unsigned char* digest);
+        size_t DigestSize() const { return m_digestSize; }
+
+        static std::vector<unsigned char> Hash(const unsigned char* data, size_t size, size_t digestSize);
+
+    private:
+        void Compress(const uint64_t* block);
+
+        uint64_t m_h[8];
+        uint64_t m_n[8];
+        uint64_t m_sigma[8];
+        unsigned char m_buffer[BLOCK_SIZE];
+        size_t m_bufferSize = 0;
+        size_t m_digestSize;
+    };
+}
@@ -0,0 +1,138 @@
+#include "WorkStealingPool.h"
+
+using namespace gost;
+
+WorkStealingPool::WorkStealingPool(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    // Worker 0 is the thread that calls ParallelFor.
+    for (size_t i = 1; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::ParallelFor(size_t count, const Task& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Contiguous slices keep neighbouring items (usually files from one
+    // directory) on one worker until stealing starts.
+    const size_t workers = m_queues.size();
+    for (size_t w = 0; w < workers; ++w)
+    {
+        std::lock_guard<std::mutex> lock(m_queues[w]->mutex);
+        size_t begin = count * w / workers;
+        size_t end = count * (w + 1) / workers;
+        for (size_t i = begin; i < end; ++i)
+        {
+            m_queues[w]->indices.push_back(i);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_busyWorkers = m_threads.size();
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    size_t index = 0;
+    while (TryTake(0, index))
+    {
+        task(index, 0);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_task = nullptr;
+}
+
+void WorkStealingPool::WorkerLoop(size_t worker)
+{
+    size_t seenGeneration = 0;
+    for (;;)
+    {
+        const Task* task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+            if (m_stopping)
+            {
+                return;
+            }
+            seenGeneration = m_generation;
+            task = m_task;
+        }
+
+        size_t index = 0;
+        while (TryTake(worker, index))
+        {
+            (*task)(index, worker);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busyWorkers == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+bool WorkStealingPool::TryTake(size_t worker, size_t& index)
+{
+    {
+        WorkerQueue& own = *m_queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.indices.empty())
+        {
+            index = own.indices.back();
+            own.indices.pop_back();
+            return true;
+        }
+    }
+
+    const size_t workers = m_queues.size();
+    for (size_t offset = 1; offset < workers; ++offset)
+    {
+        WorkerQueue& victim = *m_queues[(worker + offset) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.indices.empty())
+        {
+            index = victim.indices.front();
+            victim.indices.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gost
+{
+    // Fixed set of worker threads for index-range jobs. Every worker owns a
+    // deque of indices: it pops its own work from the back and, once empty,
+    // steals from the front of the other deques, so a few slow items (large
+    // files) do not leave the remaining workers idle.
+    class WorkStealingPool
+    {
+    public:
+        using Task = std::function<void(size_t index, size_t worker)>;
+
+        // threadCount == 0 uses every hardware thread.
+        explicit WorkStealingPool(size_t threadCount = 0);
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        size_t ThreadCount() const { return m_queues.size(); }
+
+        // Runs task(i, worker) for every i in [0, count) and returns when all
+        // calls are done. worker < ThreadCount() identifies the calling thread,
+        // so per-worker state can be indexed without locking. The task must not
+        // throw.
+        void ParallelFor(size_t count, const Task& task);
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<size_t> indices;
+        };
+
+        void WorkerLoop(size_t worker);
+        bool TryTake(size_t worker, size_t& index);
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        const Task* m_task = nullptr;
+        size_t m_generation = 0;
+        size_t m_busyWorkers = 0;
+        bool m_stopping = false;
+    };
+}
@@ -0,0 +1,443 @@
+// Micro-benchmarks for the signing core. Prints one JSON object per line:
+//   {"name":"hash/Streebog-256","bytes":1024,"iterations":...,"ns_per_op":...,
+//    "mb_per_s":...,"allocs_per_op":...}
+// "bytes" is the input size of one operation (0 for fixed-size operations,
+// which report no throughput). Each case repeats until --min-time has passed.
+
+#include "Drbg.h"
+#include "FilePath.h"
+#include "GostCurve.h"
+#include "GostSigner.h"
+#include "HashBackend.h"
+#include "HashBatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    std::atomic<unsigned long long> g_allocations{ 0 };
+}
+
+// Counts every heap allocation in the process, including those made by the
+// library under test.
+void* operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    const char USAGE[] =
+        "Использование: gostbench [параметры]\n"
+        "      --filter ТЕКСТ     только замеры, в имени которых есть ТЕКСТ\n"
+        "      --max-size БАЙТ    наибольший размер входа (по умолчанию 1073741824)\n"
+        "      --min-time СЕК     время на один замер (по умолчанию 0.5)\n";
+
+    const wchar_t PRIVATE_KEY[] = L"7a929ade789bb9be10ed359dd39a72c11b60961f49397eee1d19ce9891ec3b28";
+    // Larger inputs are hashed by cycling through this much distinct data.
+    const size_t SOURCE_BUFFER_SIZE = 16u << 20;
+
+    struct Options
+    {
+        std::string filter;
+        unsigned long long maxSize = 1ull << 30;
+        double minTime = 0.5;
+    };
+
+    // 64 B to 1 GiB in steps of 16.
+    std::vector<unsigned long long> Sizes(unsigned long long limit)
+    {
+        std::vector<unsigned long long> sizes;
+        for (unsigned long long size = 64; size <= limit && size <= (1ull << 30); size *= 16)
+        {
+            sizes.push_back(size);
+        }
+        return sizes;
+    }
+
+    std::string Narrow(const std::wstring& text)
+    {
+        return std::string(text.begin(), text.end());
+    }
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options& options)
+            : m_options(options)
+        {
+        }
+
+        bool Wants(const std::string& name) const
+        {
+            return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+        }
+
+        // Calls operation until the minimum time has passed and prints the
+        // result; false from operation aborts the case.
+        template <typename Operation>
+        void Run(const std::string& name, unsigned long long bytes, Operation operation)
+        {
+            if (!Wants(name))
+            {
+                return;
+            }
+
+            // One untimed call warms pools and lazily built tables.
+            if (!operation())
+            {
+                std::fprintf(stderr, "%s: ошибка\n", name.c_str());
+                m_failed = true;
+                return;
+            }
+
+            using Clock = std::chrono::steady_clock;
+            unsigned long long iterations = 0;
+            unsigned long long allocationsBefore = g_allocations.load();
+            const Clock::time_point start = Clock::now();
+            double elapsed = 0;
+            do
+            {
+                operation();
+                ++iterations;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            } while (elapsed < m_options.minTime);
+            unsigned long long allocations = g_allocations.load() - allocationsBefore;
+
+            std::printf("{\"name\":\"%s\",\"bytes\":%llu,\"iterations\":%llu,\"ns_per_op\":%.1f",
+                name.c_str(), bytes, iterations, elapsed * 1e9 / static_cast<double>(iterations));
+            if (bytes != 0)
+            {
+                std::printf(",\"mb_per_s\":%.2f", static_cast<double>(bytes) * static_cast<double>(iterations) / elapsed / 1e6);
+            }
+            std::printf(",\"allocs_per_op\":%.2f}\n", static_cast<double>(allocations) / static_cast<double>(iterations));
+            std::fflush(stdout);
+        }
+
+        bool Failed() const { return m_failed; }
+
+    private:
+        const Options& m_options;
+        bool m_failed = false;
+    };
+
+    std::vector<unsigned char> RandomData(size_t size, unsigned int seed)
+    {
+        std::mt19937 generator(seed);
+        std::vector<unsigned char> data(size);
+        for (auto& byte : data)
+        {
+            byte = static_cast<unsigned char>(generator());
+        }
+        return data;
+    }
+
+    // What GostSigner::ComputeHash does per message: a pooled context fed in
+    // READ_CHUNK_SIZE pieces.
+    void BenchHashes(Runner& runner, const Options& options)
+    {
+        const std::vector<unsigned char> source = RandomData(SOURCE_BUFFER_SIZE, 1);
+        for (const auto& hashName : GostSigner::SupportedHashes())
+        {
+            for (unsigned long long size : Sizes(options.maxSize))
+            {
+                runner.Run("hash/" + Narrow(hashName), size, [&]
+                {
+                    auto context = HashBackend::Instance().Acquire(hashName);
+                    if (!context)
+                    {
+                        return false;
+                    }
+                    unsigned long long remaining = size;
+                    size_t offset = 0;
+                    while (remaining > 0)
+                    {
+                        size_t count = static_cast<size_t>(std::min<unsigned long long>(remaining, GostSigner::READ_CHUNK_SIZE));
+                        count = std::min(count, source.size() - offset);
+                        if (!context->Update(source.data() + offset, count))
+                        {
+                            return false;
+                        }
+                        offset = (offset + count) % source.size();
+                        remaining -= count;
+                    }
+                    unsigned char digest[64];
+                    return context->Finish(digest);
+                });
+            }
+        }
+    }
+
+    // HashBatch over many messages of one size, as SignFiles uses it for small
+    // files; "bytes" is the whole batch.
+    void BenchHashBatch(Runner& runner, const Options& options)
+    {
+        const size_t MESSAGES = 256;
+        const std::vector<unsigned char> source = RandomData(MESSAGES * 4096, 7);
+        for (const auto& hashName : GostSigner::SupportedHashes())
+        {
+            for (unsigned long long size = 64; size <= 4096 && size * MESSAGES <= options.maxSize; size *= 4)
+            {
+                std::vector<HashInput> messages;
+                for (size_t i = 0; i < MESSAGES; ++i)
+                {
+                    messages.push_back(HashInput{ source.data() + i * size, static_cast<size_t>(size) });
+                }
+                runner.Run("hash-batch/" + Narrow(hashName), size * MESSAGES, [&]
+                {
+                    return HashBatch(hashName, messages).has_value();
+                });
+            }
+        }
+    }
+
+    void BenchHex(Runner& runner, const Options& options)
+    {
+        // Hex doubles the input, so sizes stop at the source buffer.
+        for (unsigned long long size : Sizes(std::min<unsigned long long>(options.maxSize, SOURCE_BUFFER_SIZE)))
+        {
+            const std::vector<unsigned char> data = RandomData(static_cast<size_t>(size), 2);
+            std::vector<char> text(2 * data.size());
+            std::vector<unsigned char> decoded(data.size());
+            runner.Run("hex/encode", size, [&]
+            {
+                EncodeHex(data.data(), data.size(), text.data());
+                return true;
+            });
+            runner.Run("hex/decode", size, [&]
+            {
+                return DecodeHex(text.data(), text.size(), decoded.data());
+            });
+        }
+
+        // The public API as used for signatures and keys.
+        const std::vector<unsigned char> signature = RandomData(128, 3);
+        const std::wstring signatureHex = FormatHex(signature);
+        runner.Run("hex/format-signature", signature.size(), [&]
+        {
+            return FormatHex(signature).size() == signatureHex.size();
+        });
+        runner.Run("hex/parse-signature", signature.size(), [&]
+        {
+            return ParseHex(signatureHex).has_value();
+        });
+    }
+
+    // MakeSignature and DerivePublicKey are thin wrappers over the curve.
+    const size_t VERIFY_BATCH = 256;
+
+    void BenchCurves(Runner& runner)
+    {
+        std::mt19937 generator(4);
+        RandomSource random = [&generator](unsigned char* buffer, size_t size)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                buffer[i] = static_cast<unsigned char>(generator());
+            }
+        };
+
+        for (const auto& parameters : GostSigner::DefaultParameterSets())
+        {
+            const GostCurve* curve = GostCurve::Find(parameters.name);
+            auto keyBytes = ParseHex(PRIVATE_KEY);
+            if (!curve || !keyBytes)
+            {
+                continue;
+            }
+            std::vector<unsigned char> privateKey(curve->Size());
+            curve->NormalizePrivateKey(keyBytes->data(), keyBytes->size(), privateKey.data());
+            const std::vector<unsigned char> digest = RandomData(curve->Size(), 5);
+            const std::vector<unsigned char> publicKey = curve->PublicKey(privateKey.data());
+            const std::vector<unsigned char> signature = curve->Sign(digest, privateKey.data(), random);
+            const std::string suffix = Narrow(parameters.name.substr(parameters.name.rfind(L'-') + 1));
+
+            runner.Run("sign/" + suffix, 0, [&]
+            {
+                return curve->Sign(digest, privateKey.data(), random).size() == 2 * curve->Size();
+            });
+            runner.Run("sign-deterministic/" + suffix, 0, [&]
+            {
+                HmacDrbg drbg(curve->Size(), privateKey.data(), privateKey.size(), digest.data(), digest.size());
+                return curve->Sign(digest, privateKey.data(), [&drbg](unsigned char* buffer, size_t size)
+                {
+                    drbg.Generate(buffer, size);
+                }).size() == 2 * curve->Size();
+            });
+            runner.Run("pubkey/" + suffix, 0, [&]
+            {
+                return curve->PublicKey(privateKey.data()).size() == 2 * curve->Size();
+            });
+            runner.Run("verify/" + suffix, 0, [&]
+            {
+                return curve->Verify(digest, signature, publicKey);
+            });
+
+            // One operation is a whole batch of VERIFY_BATCH signatures under one
+            // key, key table included; divide ns_per_op to compare with verify/.
+            if (runner.Wants("verify-batch/" + suffix))
+            {
+                std::vector<std::vector<unsigned char>> digests;
+                std::vector<std::vector<unsigned char>> signatures;
+                for (size_t i = 0; i < VERIFY_BATCH; ++i)
+                {
+                    digests.push_back(RandomData(curve->Size(), static_cast<unsigned int>(100 + i)));
+                    signatures.push_back(curve->Sign(digests.back(), privateKey.data(), random));
+                }
+                runner.Run("verify-batch/" + suffix, 0, [&]
+                {
+                    auto key = curve->PrepareKey(publicKey, true);
+                    std::vector<GostCurve::BatchEntry> entries;
+                    for (size_t i = 0; i < VERIFY_BATCH; ++i)
+                    {
+                        entries.push_back({ &digests[i], &signatures[i], key.get() });
+                    }
+                    auto valid = curve->VerifyBatch(entries);
+                    return std::find(valid.begin(), valid.end(), false) == valid.end();
+                });
+            }
+        }
+    }
+
+    bool WriteTestFile(const std::filesystem::path& path, unsigned long long size)
+    {
+        const std::vector<unsigned char> block = RandomData(1u << 20, 6);
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        for (unsigned long long written = 0; out && written < size;)
+        {
+            size_t count = static_cast<size_t>(std::min<unsigned long long>(size - written, block.size()));
+            out.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(count));
+            written += count;
+        }
+        return static_cast<bool>(out);
+    }
+
+    // Whole SignFile calls on a temporary file, without the hash cache.
+    // signfile/separate and signfile/multi both produce a Streebog-256 and a
+    // SHA-256 signature: two SignFile calls against one SignFileMulti.
+    void BenchSignFile(Runner& runner, const Options& options)
+    {
+        namespace fs = std::filesystem;
+        const GostParameters parameters = GostSigner::DefaultParameterSets().front();
+        const fs::path path = fs::temp_directory_path() / "gostbench.tmp";
+        const FileInputMode modes[] = { FileInputMode::Buffered, FileInputMode::Mapped };
+        const std::vector<std::wstring> pairHashes = { L"Streebog-256", L"SHA-256" };
+        if (!runner.Wants("signfile/buffered") && !runner.Wants("signfile/mapped")
+            && !runner.Wants("signfile/separate") && !runner.Wants("signfile/multi"))
+        {
+            return;
+        }
+
+        for (unsigned long long size : Sizes(options.maxSize))
+        {
+            if (!WriteTestFile(path, size))
+            {
+                std::fprintf(stderr, "не удалось создать %s\n", path.string().c_str());
+                break;
+            }
+
+            for (FileInputMode mode : modes)
+            {
+                runner.Run(mode == FileInputMode::Mapped ? "signfile/mapped" : "signfile/buffered", size, [&]
+                {
+                    GostSigner signer;
+                    return !signer.SignFile(FromPath(path), parameters, PRIVATE_KEY, L"Streebog-256", NonceMode::Random, mode).signatureHex.empty();
+                });
+            }
+
+            runner.Run("signfile/separate", size, [&]
+            {
+                GostSigner signer;
+                bool ok = true;
+                for (const auto& hashName : pairHashes)
+                {
+                    ok = !signer.SignFile(FromPath(path), parameters, PRIVATE_KEY, hashName, NonceMode::Random).signatureHex.empty() && ok;
+                }
+                return ok;
+            });
+            runner.Run("signfile/multi", size, [&]
+            {
+                GostSigner signer;
+                auto signatures = signer.SignFileMulti(FromPath(path), { parameters }, PRIVATE_KEY, pairHashes, NonceMode::Random);
+                return std::all_of(signatures.begin(), signatures.end(), [](const GostSignature& signature)
+                {
+                    return !signature.signatureHex.empty();
+                });
+            });
+        }
+
+        std::error_code error;
+        fs::remove(path, error);
+    }
+
+    bool ParseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--filter" && hasValue)
+            {
+                options.filter = argv[++i];
+            }
+            else if (arg == "--max-size" && hasValue)
+            {
+                options.maxSize = std::strtoull(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--min-time" && hasValue)
+            {
+                options.minTime = std::strtod(argv[++i], nullptr);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        std::fwrite(USAGE, 1, sizeof(USAGE) - 1, stderr);
+        return 2;
+    }
+
+    Runner runner(options);
+    BenchHashes(runner, options);
+    BenchHashBatch(runner, options);
+    BenchHex(runner, options);
+    BenchCurves(runner);
+    BenchSignFile(runner, options);
+    return runner.Failed() ? 1 : 0;
+}
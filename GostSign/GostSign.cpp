@@ -0,0 +1,656 @@
+// Console front end for GostSigner: signs files, directories or stdin without
+// any window or COM initialisation, for scripts and CI.
+
+#include "FilePath.h"
+#include "GostSigner.h"
+#include "HashBackend.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace gost;
+
+namespace
+{
+    const wchar_t DEFAULT_PARAMETER_SET[] = L"id-tc26-gost-3410-2012-256-paramSetA";
+    const wchar_t DEFAULT_HASH[] = L"Streebog-256";
+    const char SIGNATURE_EXTENSION[] = ".sig";
+    const char CONTAINER_EXTENSION[] = ".gsig";
+
+    const int EXIT_OK = 0;
+    const int EXIT_SIGN_FAILED = 1;
+    const int EXIT_USAGE = 2;
+
+    const char USAGE[] =
+        "Использование: gostsign [параметры] <файл|каталог|->...\n"
+        "  -k, --key HEX         приватный ключ в hex\n"
+        "      --key-file ФАЙЛ   прочитать приватный ключ из файла\n"
+        "  -p, --params ИМЯ      набор параметров (полное имя или окончание, например 512-paramSetC)\n"
+        "  -H, --hash ИМЯ        Streebog-256, Streebog-512, SHA-256 или SHA-1\n"
+        "  -j, --jobs N          число потоков (по умолчанию все ядра)\n"
+        "  -o, --output КАТАЛОГ  куда писать файлы .sig (по умолчанию рядом с файлом)\n"
+        "      --json            писать результаты строками JSON в stdout вместо файлов .sig\n"
+        "      --binary          писать двоичные файлы .gsig с параметрами, ключом и временем подписи\n"
+        "      --tree [РАЗМЕР]   подписывать корень дерева хешей с блоками РАЗМЕР байт\n"
+        "      --cache ФАЙЛ      кеш хешей файлов\n"
+        "      --deterministic   nonce из ключа и хеша (RFC 6979): одинаковые входы дают одинаковую подпись\n"
+        "      --weak-random     оставлен для совместимости, ни на что не влияет\n"
+        "      --kernels         показать, чем вычисляется каждый хеш на этом процессоре, и выйти\n"
+        "Каталоги обходятся рекурсивно, файлы *.sig и *.gsig пропускаются; '-' читает stdin.\n";
+
+    struct Options
+    {
+        std::wstring privateKeyHex;
+        GostParameters parameters;
+        std::wstring hashName = DEFAULT_HASH;
+        size_t jobs = 0;
+        std::wstring outputDirectory;
+        bool json = false;
+        bool binary = false;
+        bool treeHash = false;
+        unsigned long long treeChunkSize = TreeHashOptions::DEFAULT_CHUNK_SIZE;
+        std::wstring cachePath;
+        NonceMode nonceMode = NonceMode::Random;
+        std::vector<std::wstring> inputs;
+    };
+
+    struct Input
+    {
+        std::wstring path;
+        bool isStdin = false;
+        // Path below the argument it came from; names the signature under -o.
+        std::wstring relative;
+    };
+
+    std::wstring Utf8ToWide(const std::string& value)
+    {
+        std::wstring output;
+        output.reserve(value.size());
+        for (size_t i = 0; i < value.size();)
+        {
+            unsigned char lead = static_cast<unsigned char>(value[i]);
+            size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+            if (length == 0 || i + length > value.size())
+            {
+                output.push_back(L'\xFFFD');
+                ++i;
+                continue;
+            }
+
+            char32_t code = length == 1 ? lead : lead & (0x7F >> length);
+            for (size_t j = 1; j < length; ++j)
+            {
+                code = (code << 6) | (static_cast<unsigned char>(value[i + j]) & 0x3F);
+            }
+            i += length;
+
+            if (sizeof(wchar_t) == 2 && code > 0xFFFF)
+            {
+                code -= 0x10000;
+                output.push_back(static_cast<wchar_t>(0xD800 + (code >> 10)));
+                output.push_back(static_cast<wchar_t>(0xDC00 + (code & 0x3FF)));
+            }
+            else
+            {
+                output.push_back(static_cast<wchar_t>(code));
+            }
+        }
+        return output;
+    }
+
+    std::string WideToUtf8(const std::wstring& value)
+    {
+        std::string output;
+        output.reserve(value.size());
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            char32_t code = static_cast<char32_t>(value[i]);
+            if (sizeof(wchar_t) == 2 && code >= 0xD800 && code < 0xDC00 && i + 1 < value.size())
+            {
+                code = 0x10000 + ((code - 0xD800) << 10) + (static_cast<char32_t>(value[++i]) - 0xDC00);
+            }
+            // Unpaired surrogates, including the bytes of file names that
+            // are not UTF-8 (see NativeToWide).
+            if (code >= 0xD800 && code < 0xE000)
+            {
+                code = 0xFFFD;
+            }
+
+            if (code < 0x80)
+            {
+                output.push_back(static_cast<char>(code));
+            }
+            else if (code < 0x800)
+            {
+                output.push_back(static_cast<char>(0xC0 | (code >> 6)));
+                output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else if (code < 0x10000)
+            {
+                output.push_back(static_cast<char>(0xE0 | (code >> 12)));
+                output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+            else
+            {
+                output.push_back(static_cast<char>(0xF0 | (code >> 18)));
+                output.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+                output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+            }
+        }
+        return output;
+    }
+
+    std::string JsonString(const std::wstring& value)
+    {
+        std::string output = "\"";
+        for (char c : WideToUtf8(value))
+        {
+            switch (c)
+            {
+            case '"':
+                output += "\\\"";
+                break;
+            case '\\':
+                output += "\\\\";
+                break;
+            case '\n':
+                output += "\\n";
+                break;
+            case '\r':
+                output += "\\r";
+                break;
+            case '\t':
+                output += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    output += escaped;
+                }
+                else
+                {
+                    output.push_back(c);
+                }
+                break;
+            }
+        }
+        output.push_back('"');
+        return output;
+    }
+
+    void PrintError(const std::wstring& message)
+    {
+        std::string text = "gostsign: " + WideToUtf8(message) + "\n";
+        std::fwrite(text.data(), 1, text.size(), stderr);
+    }
+
+    bool ParseCount(const std::wstring& text, unsigned long long& value)
+    {
+        if (text.empty() || text.size() > 19)
+        {
+            return false;
+        }
+        value = 0;
+        for (wchar_t c : text)
+        {
+            if (c < L'0' || c > L'9')
+            {
+                return false;
+            }
+            value = value * 10 + static_cast<unsigned long long>(c - L'0');
+        }
+        return true;
+    }
+
+    bool FindParameters(const std::wstring& name, GostParameters& parameters)
+    {
+        for (const auto& candidate : GostSigner::DefaultParameterSets())
+        {
+            const std::wstring& full = candidate.name;
+            if (full == name || (full.size() > name.size() && full.compare(full.size() - name.size(), name.size(), name) == 0 && full[full.size() - name.size() - 1] == L'-'))
+            {
+                parameters = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ReadKeyFile(const std::wstring& path, std::wstring& key)
+    {
+        std::ifstream file(ToPath(path), std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        text.erase(std::remove_if(text.begin(), text.end(), [](char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }), text.end());
+        key = Utf8ToWide(text);
+        return true;
+    }
+
+    bool ParseArguments(const std::vector<std::wstring>& args, Options& options)
+    {
+        if (!FindParameters(DEFAULT_PARAMETER_SET, options.parameters))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::wstring& arg = args[i];
+            auto value = [&](std::wstring& out)
+            {
+                if (i + 1 >= args.size())
+                {
+                    PrintError(L"не задано значение для " + arg);
+                    return false;
+                }
+                out = args[++i];
+                return true;
+            };
+
+            std::wstring text;
+            unsigned long long number = 0;
+            if (arg == L"-h" || arg == L"--help")
+            {
+                std::fwrite(USAGE, 1, sizeof(USAGE) - 1, stdout);
+                std::exit(EXIT_OK);
+            }
+            else if (arg == L"--kernels")
+            {
+                for (const std::wstring& name : HashBackend::Instance().Names())
+                {
+                    std::string line = WideToUtf8(name) + ": " + WideToUtf8(HashBackend::Instance().Implementation(name)) + "\n";
+                    std::fwrite(line.data(), 1, line.size(), stdout);
+                }
+                std::exit(EXIT_OK);
+            }
+            else if (arg == L"-k" || arg == L"--key")
+            {
+                if (!value(options.privateKeyHex))
+                {
+                    return false;
+                }
+            }
+            else if (arg == L"--key-file")
+            {
+                if (!value(text))
+                {
+                    return false;
+                }
+                if (!ReadKeyFile(text, options.privateKeyHex))
+                {
+                    PrintError(L"не удалось прочитать ключ из " + text);
+                    return false;
+                }
+            }
+            else if (arg == L"-p" || arg == L"--params")
+            {
+                if (!value(text))
+                {
+                    return false;
+                }
+                if (!FindParameters(text, options.parameters))
+                {
+                    PrintError(L"неизвестный набор параметров " + text);
+                    return false;
+                }
+            }
+            else if (arg == L"-H" || arg == L"--hash")
+            {
+                if (!value(options.hashName))
+                {
+                    return false;
+                }
+                auto hashes = GostSigner::SupportedHashes();
+                if (std::find(hashes.begin(), hashes.end(), options.hashName) == hashes.end())
+                {
+                    PrintError(L"неизвестный алгоритм хеширования " + options.hashName);
+                    return false;
+                }
+            }
+            else if (arg == L"-j" || arg == L"--jobs")
+            {
+                if (!value(text) || !ParseCount(text, number) || number == 0)
+                {
+                    PrintError(L"число потоков должно быть положительным");
+                    return false;
+                }
+                options.jobs = static_cast<size_t>(number);
+            }
+            else if (arg == L"-o" || arg == L"--output")
+            {
+                if (!value(options.outputDirectory))
+                {
+                    return false;
+                }
+            }
+            else if (arg == L"--json")
+            {
+                options.json = true;
+            }
+            else if (arg == L"--binary")
+            {
+                options.binary = true;
+            }
+            else if (arg == L"--tree")
+            {
+                options.treeHash = true;
+                if (i + 1 < args.size() && ParseCount(args[i + 1], number))
+                {
+                    if (number == 0 || number > TreeHashOptions::MAX_CHUNK_SIZE)
+                    {
+                        PrintError(L"недопустимый размер блока дерева хешей");
+                        return false;
+                    }
+                    options.treeChunkSize = number;
+                    ++i;
+                }
+            }
+            else if (arg == L"--cache")
+            {
+                if (!value(options.cachePath))
+                {
+                    return false;
+                }
+            }
+            else if (arg == L"--deterministic")
+            {
+                options.nonceMode = NonceMode::Deterministic;
+            }
+            else if (arg == L"--weak-random")
+            {
+                // Accepted so that old scripts keep working.
+            }
+            else if (arg.size() > 1 && arg[0] == L'-')
+            {
+                PrintError(L"неизвестный параметр " + arg);
+                return false;
+            }
+            else
+            {
+                options.inputs.push_back(arg);
+            }
+        }
+
+        if (options.privateKeyHex.empty())
+        {
+            PrintError(L"приватный ключ не задан (-k или --key-file)");
+            return false;
+        }
+        if (options.inputs.empty())
+        {
+            PrintError(L"не заданы файлы для подписи");
+            return false;
+        }
+        return true;
+    }
+
+    // Expands directories into their regular files, sorted so output order is stable.
+    bool CollectInputs(const Options& options, std::vector<Input>& inputs)
+    {
+        namespace fs = std::filesystem;
+        bool ok = true;
+        for (const auto& name : options.inputs)
+        {
+            if (name == L"-")
+            {
+                inputs.push_back({ name, true, L"stdin" });
+                continue;
+            }
+
+            std::error_code error;
+            fs::path path = ToPath(name);
+            if (!fs::is_directory(path, error))
+            {
+                inputs.push_back({ name, false, FromPath(path.filename()) });
+                continue;
+            }
+
+            std::vector<std::pair<std::wstring, std::wstring>> files;
+            for (fs::recursive_directory_iterator it(path, fs::directory_options::skip_permission_denied, error), end; !error && it != end; it.increment(error))
+            {
+                if (it->is_regular_file(error) && it->path().extension() != SIGNATURE_EXTENSION && it->path().extension() != CONTAINER_EXTENSION)
+                {
+                    files.emplace_back(FromPath(it->path()), FromPath(it->path().lexically_relative(path)));
+                }
+            }
+            if (error)
+            {
+                PrintError(L"не удалось прочитать каталог " + name);
+                ok = false;
+            }
+            std::sort(files.begin(), files.end());
+            for (auto& file : files)
+            {
+                inputs.push_back({ std::move(file.first), false, std::move(file.second) });
+            }
+        }
+        return ok;
+    }
+
+    // Under -o a file keeps its place relative to the directory argument it
+    // was found in, so equal names from different subdirectories stay apart.
+    std::wstring SignaturePath(const Options& options, const Input& input)
+    {
+        namespace fs = std::filesystem;
+        const char* extension = options.binary ? CONTAINER_EXTENSION : SIGNATURE_EXTENSION;
+        if (!options.outputDirectory.empty())
+        {
+            fs::path path = ToPath(options.outputDirectory) / ToPath(input.relative);
+            path += extension;
+            return FromPath(path.lexically_normal());
+        }
+        fs::path path = ToPath(input.path);
+        path += extension;
+        return FromPath(path);
+    }
+
+    // Hex text, or with --binary the SignatureContainer form.
+    std::string SignatureFileContents(const Options& options, const GostSignature& signature)
+    {
+        if (options.binary)
+        {
+            std::vector<unsigned char> container = EncodeSignature(signature);
+            return std::string(container.begin(), container.end());
+        }
+        return WideToUtf8(signature.signatureHex);
+    }
+
+    bool WriteSignatureFile(const std::wstring& path, const std::string& contents)
+    {
+        if (contents.empty())
+        {
+            return false;
+        }
+        // A directory that cannot be created shows up as the open failing below.
+        std::error_code error;
+        std::filesystem::create_directories(ToPath(path).parent_path(), error);
+        std::ofstream out(ToPath(path), std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        return static_cast<bool>(out);
+    }
+
+    std::string JsonLine(const Input& input, const GostSignature& signature)
+    {
+        bool ok = !signature.signatureHex.empty();
+        std::string line = "{\"file\":" + JsonString(input.isStdin ? L"-" : input.path)
+            + ",\"ok\":" + (ok ? "true" : "false")
+            + ",\"parameterSet\":" + JsonString(signature.parameterSet)
+            + ",\"hash\":" + JsonString(signature.hashAlgorithm);
+        if (ok)
+        {
+            line += ",\"signature\":" + JsonString(signature.signatureHex)
+                + ",\"publicKey\":" + JsonString(signature.publicKeyHex);
+            if (signature.treeChunkSize != 0)
+            {
+                line += ",\"treeChunkSize\":" + std::to_string(signature.treeChunkSize)
+                    + ",\"treeLayout\":" + JsonString(signature.treeLayout);
+            }
+        }
+        line += ",\"status\":" + JsonString(signature.statusMessage) + "}\n";
+        return line;
+    }
+
+    int Run(const std::vector<std::wstring>& args)
+    {
+        Options options;
+        if (!ParseArguments(args, options))
+        {
+            std::fwrite(USAGE, 1, sizeof(USAGE) - 1, stderr);
+            return EXIT_USAGE;
+        }
+
+        std::vector<Input> inputs;
+        bool ok = CollectInputs(options, inputs);
+
+        std::unique_ptr<HashCache> cache;
+        GostSigner signer;
+        if (!options.cachePath.empty())
+        {
+            cache = std::make_unique<HashCache>(options.cachePath);
+            if (!cache->IsOpen())
+            {
+                PrintError(L"кеш хешей недоступен: " + options.cachePath);
+            }
+            signer.SetHashCache(cache.get());
+        }
+
+        // Files go through the parallel batch (or the parallel tree hash, one
+        // file at a time); stdin is read in place.
+        std::vector<GostSignature> results(inputs.size());
+        std::vector<std::wstring> batch;
+        std::vector<size_t> batchIndex;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (inputs[i].isStdin)
+            {
+                if (options.treeHash)
+                {
+                    results[i].parameterSet = options.parameters.name;
+                    results[i].hashAlgorithm = options.hashName;
+                    results[i].statusMessage = L"Дерево хешей строится только для файлов";
+                    continue;
+                }
+                StreamByteSource source(std::cin);
+                results[i] = signer.SignStream(source, options.parameters, options.privateKeyHex, options.hashName, options.nonceMode);
+            }
+            else if (options.treeHash)
+            {
+                TreeHashOptions tree;
+                tree.chunkSize = options.treeChunkSize;
+                tree.concurrency = options.jobs;
+                results[i] = signer.SignFileTree(inputs[i].path, options.parameters, options.privateKeyHex, options.hashName, options.nonceMode, tree);
+            }
+            else
+            {
+                batch.push_back(inputs[i].path);
+                batchIndex.push_back(i);
+            }
+        }
+
+        if (!batch.empty())
+        {
+            BatchOptions batchOptions;
+            batchOptions.concurrency = options.jobs;
+            batchOptions.nonceMode = options.nonceMode;
+            batchOptions.inputMode = FileInputMode::Mapped;
+            auto signatures = signer.SignFiles(batch, options.parameters, options.privateKeyHex, options.hashName, batchOptions);
+            for (size_t i = 0; i < signatures.size(); ++i)
+            {
+                results[batchIndex[i]] = std::move(signatures[i]);
+            }
+        }
+
+        std::set<std::wstring> written;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            const Input& input = inputs[i];
+            const GostSignature& signature = results[i];
+            bool succeeded = !signature.signatureHex.empty();
+            ok = ok && succeeded;
+
+            if (options.json)
+            {
+                std::string line = JsonLine(input, signature);
+                std::fwrite(line.data(), 1, line.size(), stdout);
+                continue;
+            }
+
+            std::wstring name = input.isStdin ? L"-" : input.path;
+            if (!succeeded)
+            {
+                PrintError(name + L": " + signature.statusMessage);
+            }
+            else if (input.isStdin && options.outputDirectory.empty())
+            {
+                std::string contents = SignatureFileContents(options, signature);
+                if (!options.binary)
+                {
+                    contents += "\n";
+                }
+                std::fwrite(contents.data(), 1, contents.size(), stdout);
+            }
+            else
+            {
+                std::wstring path = SignaturePath(options, input);
+                if (!written.insert(path).second)
+                {
+                    PrintError(name + L": подпись другого файла уже сохранена в " + path);
+                    ok = false;
+                }
+                else if (!WriteSignatureFile(path, SignatureFileContents(options, signature)))
+                {
+                    PrintError(name + L": не удалось сохранить подпись");
+                    ok = false;
+                }
+            }
+        }
+
+        std::fflush(stdout);
+        return ok ? EXIT_OK : EXIT_SIGN_FAILED;
+    }
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t** argv)
+{
+    SetConsoleOutputCP(CP_UTF8);
+    _setmode(_fileno(stdin), _O_BINARY);
+    // --binary may write a container to stdout.
+    _setmode(_fileno(stdout), _O_BINARY);
+    return Run(std::vector<std::wstring>(argv + 1, argv + argc));
+}
+#else
+int main(int argc, char** argv)
+{
+    std::vector<std::wstring> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        args.push_back(NativeToWide(argv[i]));
+    }
+    return Run(args);
+}
+#endif
@@ -0,0 +1,278 @@
+// Load generator for gostsignd. Every connection runs on its own thread and
+// keeps --depth requests in flight; at the end one JSON line reports the
+// throughput and the latency distribution, like gostbench does.
+
+#include "SignProtocol.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace gost::sign_protocol;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const char USAGE[] =
+        "Использование: gostload [параметры]\n"
+        "  -s, --socket ПУТЬ       сокет демона (по умолчанию /tmp/gostsignd.sock)\n"
+        "  -c, --connections N     соединений (по умолчанию 4)\n"
+        "  -d, --depth N           запросов в полёте на соединение (по умолчанию 16)\n"
+        "  -t, --duration СЕК      длительность (по умолчанию 5)\n"
+        "  -k, --key N             номер ключа (по умолчанию 0)\n"
+        "      --digest-size N     размер подписываемого хеша (по умолчанию 32)\n"
+        "      --deterministic     детерминированный nonce\n"
+        "      --file ПУТЬ         подписывать файл (SIGN_FILE) вместо хеша\n"
+        "      --hash ИМЯ          хеш для --file (по умолчанию Streebog-256)\n";
+
+    struct Options
+    {
+        std::string socketPath = "/tmp/gostsignd.sock";
+        size_t connections = 4;
+        size_t depth = 16;
+        double duration = 5;
+        uint16_t keyIndex = 0;
+        size_t digestSize = 32;
+        bool deterministic = false;
+        std::string file;
+        std::string hash = "Streebog-256";
+    };
+
+    struct Result
+    {
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        std::vector<uint32_t> latencies;
+    };
+
+    bool ParseArguments(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if ((arg == "-s" || arg == "--socket") && hasValue)
+            {
+                options.socketPath = argv[++i];
+            }
+            else if ((arg == "-c" || arg == "--connections") && hasValue)
+            {
+                options.connections = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if ((arg == "-d" || arg == "--depth") && hasValue)
+            {
+                options.depth = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if ((arg == "-t" || arg == "--duration") && hasValue)
+            {
+                options.duration = std::strtod(argv[++i], nullptr);
+            }
+            else if ((arg == "-k" || arg == "--key") && hasValue)
+            {
+                options.keyIndex = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--digest-size" && hasValue)
+            {
+                options.digestSize = std::strtoul(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--deterministic")
+            {
+                options.deterministic = true;
+            }
+            else if (arg == "--file" && hasValue)
+            {
+                options.file = argv[++i];
+            }
+            else if (arg == "--hash" && hasValue)
+            {
+                options.hash = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return options.duration > 0 && options.digestSize >= 1 && options.digestSize <= MAX_DIGEST_SIZE
+            && options.hash.size() < 256;
+    }
+
+    int Connect(const std::string& path)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return -1;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+
+    bool WriteAll(int fd, const std::vector<unsigned char>& data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            ssize_t count = write(fd, data.data() + written, data.size() - written);
+            if (count <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    void RunConnection(const Options& options, size_t connectionIndex, Clock::time_point deadline, Result& result)
+    {
+        int fd = Connect(options.socketPath);
+        if (fd < 0)
+        {
+            ++result.errors;
+            return;
+        }
+
+        std::vector<unsigned char> payload;
+        RequestType type = SIGN_DIGEST;
+        if (options.file.empty())
+        {
+            for (size_t i = 0; i < options.digestSize; ++i)
+            {
+                payload.push_back(static_cast<unsigned char>(connectionIndex * 31 + i));
+            }
+        }
+        else
+        {
+            type = SIGN_FILE;
+            payload.push_back(static_cast<unsigned char>(options.hash.size()));
+            payload.insert(payload.end(), options.hash.begin(), options.hash.end());
+            payload.insert(payload.end(), options.file.begin(), options.file.end());
+        }
+        const uint8_t flags = options.deterministic ? FLAG_DETERMINISTIC : 0;
+
+        std::deque<Clock::time_point> sent;
+        std::vector<unsigned char> output;
+        std::vector<unsigned char> input;
+        unsigned char buffer[16 << 10];
+        uint32_t nextId = 0;
+        for (;;)
+        {
+            const bool sending = Clock::now() < deadline;
+            if (!sending && sent.empty())
+            {
+                break;
+            }
+            output.clear();
+            while (sending && sent.size() < options.depth)
+            {
+                AppendRequest(output, type, flags, options.keyIndex, nextId++, payload.data(), payload.size());
+                sent.push_back(Clock::now());
+            }
+            if (!output.empty() && !WriteAll(fd, output))
+            {
+                ++result.errors;
+                break;
+            }
+
+            ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count <= 0)
+            {
+                ++result.errors;
+                break;
+            }
+            input.insert(input.end(), buffer, buffer + count);
+
+            size_t offset = 0;
+            while (input.size() - offset >= LENGTH_SIZE)
+            {
+                const size_t length = Load32(input.data() + offset);
+                if (input.size() - offset - LENGTH_SIZE < length)
+                {
+                    break;
+                }
+                const Clock::time_point now = Clock::now();
+                const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - sent.front()).count();
+                sent.pop_front();
+                result.latencies.push_back(static_cast<uint32_t>(latency));
+                ++result.requests;
+                if (length < RESPONSE_HEADER_SIZE || input[offset + LENGTH_SIZE] != STATUS_OK)
+                {
+                    ++result.errors;
+                }
+                offset += LENGTH_SIZE + length;
+            }
+            input.erase(input.begin(), input.begin() + offset);
+        }
+        close(fd);
+    }
+
+    uint32_t Percentile(const std::vector<uint32_t>& sorted, double fraction)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+        size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+        return sorted[index];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        std::fwrite(USAGE, 1, sizeof(USAGE) - 1, stderr);
+        return 2;
+    }
+
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+    for (size_t i = 0; i < options.connections; ++i)
+    {
+        threads.emplace_back(RunConnection, std::cref(options), i, deadline, std::ref(results[i]));
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result total;
+    for (const Result& result : results)
+    {
+        total.requests += result.requests;
+        total.errors += result.errors;
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+
+    std::printf("{\"connections\":%zu,\"depth\":%zu,\"requests\":%llu,\"seconds\":%.3f,\"req_per_s\":%.1f,"
+        "\"p50_us\":%u,\"p99_us\":%u,\"max_us\":%u,\"errors\":%llu}\n",
+        options.connections, options.depth, static_cast<unsigned long long>(total.requests), seconds,
+        total.requests / seconds, Percentile(total.latencies, 0.5), Percentile(total.latencies, 0.99),
+        total.latencies.empty() ? 0u : total.latencies.back(), static_cast<unsigned long long>(total.errors));
+    return total.errors == 0 ? 0 : 1;
+}
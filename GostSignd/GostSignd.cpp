@@ -0,0 +1,740 @@
+// Local signing service: keeps parsed keys and the curve tables resident and
+// signs requests from a Unix domain socket. One thread polls every
+// connection, gathers all complete requests that have arrived into a batch
+// and signs the batch on a WorkStealingPool, so requests that pile up while a
+// batch is being signed are taken together on the next pass. SIGN_FILE
+// requests are hashed on separate file workers instead, so a large file never
+// stalls the loop. The wire format is described in SignProtocol.h.
+
+#include "FilePath.h"
+#include "GostSigner.h"
+#include "SignProtocol.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace gost;
+using namespace gost::sign_protocol;
+
+namespace
+{
+    const char USAGE[] =
+        "Использование: gostsignd [параметры] (-k HEX | --key-file ФАЙЛ)...\n"
+        "  -s, --socket ПУТЬ     сокет (по умолчанию /tmp/gostsignd.sock)\n"
+        "  -p, --params ИМЯ      набор параметров для следующих ключей\n"
+        "  -k, --key HEX         приватный ключ; ключи нумеруются с 0 в порядке задания\n"
+        "      --key-file ФАЙЛ   прочитать приватный ключ из файла\n"
+        "  -j, --jobs N          потоки подписи (по умолчанию все ядра)\n"
+        "      --cache ФАЙЛ      кеш хешей для запросов SIGN_FILE\n";
+
+    const char DEFAULT_SOCKET[] = "/tmp/gostsignd.sock";
+    const char DEFAULT_PARAMETER_SET[] = "256-paramSetA";
+    // Unread input beyond this stops reading from a connection until its
+    // requests have been answered.
+    const size_t MAX_PENDING_INPUT = 1 << 20;
+    // Unsent responses beyond this stop reading from a connection until the
+    // client has taken them.
+    const size_t MAX_PENDING_OUTPUT = 4 << 20;
+    // Unanswered requests beyond this, mostly SIGN_FILE waiting for a file
+    // worker, stop reading from a connection as well.
+    const size_t MAX_PENDING_REQUESTS = 4096;
+
+    std::atomic<bool> g_stop{ false };
+
+    struct Options
+    {
+        std::string socketPath = DEFAULT_SOCKET;
+        size_t jobs = 0;
+        std::string cachePath;
+        std::vector<std::unique_ptr<SigningKey>> keys;
+    };
+
+    struct Request
+    {
+        uint8_t type;
+        uint8_t flags;
+        uint16_t keyIndex;
+        uint32_t requestId;
+        std::vector<unsigned char> payload;
+        Status status;
+        std::vector<unsigned char> result;
+        bool done = false;
+    };
+
+    struct Connection
+    {
+        int fd = -1;
+        std::vector<unsigned char> input;
+        // In arrival order; answered from the front as they are done, since
+        // responses keep request order.
+        std::deque<std::unique_ptr<Request>> requests;
+        std::vector<unsigned char> output;
+        size_t written = 0;
+        bool closed = false;
+
+        // Closed connections are only drained; a full output or a long queue
+        // of unanswered requests waits for the client or the file workers.
+        bool WantsInput() const
+        {
+            return !closed && input.size() < MAX_PENDING_INPUT && requests.size() < MAX_PENDING_REQUESTS
+                && output.size() - written < MAX_PENDING_OUTPUT;
+        }
+    };
+
+    // Never fails: bytes that are not UTF-8 are kept as they are (see NativeToWide).
+    std::wstring Widen(const std::string& text)
+    {
+        return NativeToWide(text);
+    }
+
+    void PrintError(const std::string& message)
+    {
+        std::string text = "gostsignd: " + message + "\n";
+        std::fwrite(text.data(), 1, text.size(), stderr);
+    }
+
+    bool FindParameters(const std::string& name, std::wstring& parameterSet)
+    {
+        const std::wstring wide = Widen(name);
+        for (const auto& candidate : GostSigner::DefaultParameterSets())
+        {
+            const std::wstring& full = candidate.name;
+            if (full == wide || (full.size() > wide.size() && full.compare(full.size() - wide.size(), wide.size(), wide) == 0 && full[full.size() - wide.size() - 1] == L'-'))
+            {
+                parameterSet = full;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ReadKeyFile(const std::string& path, std::string& key)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        key.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool ParseArguments(int argc, char** argv, Options& options)
+    {
+        std::wstring parameterSet;
+        FindParameters(DEFAULT_PARAMETER_SET, parameterSet);
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            std::string key;
+            if ((arg == "-s" || arg == "--socket") && hasValue)
+            {
+                options.socketPath = argv[++i];
+            }
+            else if ((arg == "-p" || arg == "--params") && hasValue)
+            {
+                if (!FindParameters(argv[++i], parameterSet))
+                {
+                    PrintError(std::string("неизвестный набор параметров ") + argv[i]);
+                    return false;
+                }
+            }
+            else if ((arg == "-k" || arg == "--key" || arg == "--key-file") && hasValue)
+            {
+                key = argv[++i];
+                if (arg == "--key-file" && !ReadKeyFile(argv[i], key))
+                {
+                    PrintError(std::string("не удалось прочитать ключ из ") + argv[i]);
+                    return false;
+                }
+
+                std::wstring error;
+                auto signingKey = SigningKey::Create(parameterSet, std::wstring(key.begin(), key.end()), error);
+                std::fill(key.begin(), key.end(), '\0');
+                if (!signingKey)
+                {
+                    PrintError("ключ " + std::to_string(options.keys.size()) + " не принят");
+                    return false;
+                }
+                options.keys.push_back(std::move(signingKey));
+            }
+            else if ((arg == "-j" || arg == "--jobs") && hasValue)
+            {
+                options.jobs = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--cache" && hasValue)
+            {
+                options.cachePath = argv[++i];
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return !options.keys.empty();
+    }
+
+    // Clears the way for bind: nothing at path, or a socket nobody listens on
+    // (left by a daemon that did not exit cleanly). Anything else is kept.
+    bool RemoveStaleSocket(const std::string& path)
+    {
+        struct stat status;
+        if (lstat(path.c_str(), &status) != 0)
+        {
+            if (errno == ENOENT)
+            {
+                return true;
+            }
+            PrintError("не удалось проверить " + path + ": " + std::strerror(errno));
+            return false;
+        }
+        if (!S_ISSOCK(status.st_mode))
+        {
+            PrintError(path + " существует и не является сокетом");
+            return false;
+        }
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0)
+        {
+            return false;
+        }
+        const bool connected = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        const int error = errno;
+        close(probe);
+        if (connected)
+        {
+            PrintError("сокет " + path + " уже используется другим процессом");
+            return false;
+        }
+        if (error != ECONNREFUSED)
+        {
+            PrintError("не удалось проверить сокет " + path + ": " + std::strerror(error));
+            return false;
+        }
+        if (unlink(path.c_str()) != 0)
+        {
+            PrintError("не удалось удалить старый сокет " + path + ": " + std::strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    int Listen(const std::string& path)
+    {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            PrintError("слишком длинный путь к сокету");
+            return -1;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        if (!RemoveStaleSocket(path))
+        {
+            close(fd);
+            return -1;
+        }
+        // Only the owner may connect and sign.
+        mode_t mask = umask(0077);
+        bool bound = bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        umask(mask);
+        if (!bound || listen(fd, SOMAXCONN) != 0)
+        {
+            PrintError("не удалось открыть сокет " + path + ": " + std::strerror(errno));
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    const SigningKey* FindKey(Request& request, const Options& options)
+    {
+        request.status = STATUS_OK;
+        request.result.clear();
+        if (request.keyIndex >= options.keys.size())
+        {
+            request.status = STATUS_UNKNOWN_KEY;
+            return nullptr;
+        }
+        return options.keys[request.keyIndex].get();
+    }
+
+    NonceMode NonceModeOf(const Request& request)
+    {
+        return (request.flags & FLAG_DETERMINISTIC) ? NonceMode::Deterministic : NonceMode::Random;
+    }
+
+    // Everything but SIGN_FILE; quick enough for the poll loop's batches.
+    void Process(Request& request, const Options& options)
+    {
+        const SigningKey* key = FindKey(request, options);
+        if (!key)
+        {
+            return;
+        }
+
+        switch (request.type)
+        {
+        case SIGN_DIGEST:
+            if (request.payload.empty() || request.payload.size() > MAX_DIGEST_SIZE)
+            {
+                request.status = STATUS_BAD_REQUEST;
+                return;
+            }
+            request.result = key->Sign(request.payload, NonceModeOf(request));
+            return;
+        case PUBLIC_KEY:
+            request.result = key->PublicKey();
+            return;
+        default:
+            request.status = STATUS_BAD_REQUEST;
+            return;
+        }
+    }
+
+    // SIGN_FILE, on a file worker.
+    void ProcessFile(Request& request, const Options& options, GostSigner& signer)
+    {
+        const SigningKey* key = FindKey(request, options);
+        if (!key)
+        {
+            return;
+        }
+
+        const std::vector<unsigned char>& payload = request.payload;
+        if (payload.empty() || payload.size() < 1u + payload[0])
+        {
+            request.status = STATUS_BAD_REQUEST;
+            return;
+        }
+        std::wstring hashName(payload.begin() + 1, payload.begin() + 1 + payload[0]);
+        std::string path(payload.begin() + 1 + payload[0], payload.end());
+        const auto hashes = GostSigner::SupportedHashes();
+        // A NUL would cut the name short and name some other file.
+        if (path.empty() || path.find('\0') != std::string::npos
+            || std::find(hashes.begin(), hashes.end(), hashName) == hashes.end())
+        {
+            request.status = STATUS_BAD_REQUEST;
+            return;
+        }
+        // Read, not mapped: a client's file may be truncated while it is
+        // hashed, and a fault on a mapped page would kill the service.
+        auto hash = signer.HashFile(Widen(path), hashName, FileInputMode::Buffered);
+        if (!hash)
+        {
+            request.status = STATUS_FAILED;
+            return;
+        }
+        request.result = key->Sign(*hash, NonceModeOf(request));
+    }
+
+    // Runs handler with every failure answered: nothing a client sends may
+    // stop the service, and the pool's tasks must not throw.
+    template <typename Handler>
+    void Answer(Request& request, Handler handler)
+    {
+        try
+        {
+            handler();
+        }
+        catch (const std::exception&)
+        {
+            request.status = STATUS_FAILED;
+            request.result.clear();
+        }
+    }
+
+    // Hashes and signs SIGN_FILE requests on threads of their own, so a large
+    // file holds up only the answers queued behind it on its own connection,
+    // never the poll loop. Each finished request is handed back through
+    // TakeFinished, and a byte on a pipe wakes the loop to collect it.
+    class FileWorkers
+    {
+    public:
+        FileWorkers(size_t threadCount, const Options& options, HashCache* cache)
+            : m_options(options)
+        {
+            if (pipe2(m_wake, O_CLOEXEC | O_NONBLOCK) != 0)
+            {
+                m_wake[0] = m_wake[1] = -1;
+                return;
+            }
+            for (size_t i = 0; i < threadCount; ++i)
+            {
+                m_threads.emplace_back([this, cache] { Run(cache); });
+            }
+        }
+
+        ~FileWorkers()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_ready.notify_all();
+            for (auto& thread : m_threads)
+            {
+                thread.join();
+            }
+            for (int fd : m_wake)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        }
+
+        FileWorkers(const FileWorkers&) = delete;
+        FileWorkers& operator=(const FileWorkers&) = delete;
+
+        bool IsOpen() const { return m_wake[0] >= 0; }
+        int WakeDescriptor() const { return m_wake[0]; }
+
+        // The request must stay alive until TakeFinished returns it.
+        void Submit(Request* request)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(request);
+            }
+            m_ready.notify_one();
+        }
+
+        std::vector<Request*> TakeFinished()
+        {
+            char buffer[256];
+            while (read(m_wake[0], buffer, sizeof(buffer)) > 0)
+            {
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<Request*> finished;
+            finished.swap(m_finished);
+            return finished;
+        }
+
+    private:
+        void Run(HashCache* cache)
+        {
+            GostSigner signer;
+            signer.SetHashCache(cache);
+            for (;;)
+            {
+                Request* request = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_ready.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                    if (m_stopping)
+                    {
+                        return;
+                    }
+                    request = m_queue.front();
+                    m_queue.pop_front();
+                }
+
+                Answer(*request, [&] { ProcessFile(*request, m_options, signer); });
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_finished.push_back(request);
+                }
+                // A full pipe already holds a wakeup, so a failed write is fine.
+                const char wake = 0;
+                if (write(m_wake[1], &wake, 1) < 0)
+                {
+                }
+            }
+        }
+
+        const Options& m_options;
+        int m_wake[2] = { -1, -1 };
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::condition_variable m_ready;
+        std::deque<Request*> m_queue;
+        std::vector<Request*> m_finished;
+        bool m_stopping = false;
+    };
+
+    // Reads what is available, queues every complete frame on the connection
+    // and adds it to batch.
+    void ReadRequests(Connection& connection, std::vector<Request*>& batch)
+    {
+        unsigned char buffer[64 << 10];
+        while (connection.input.size() < MAX_PENDING_INPUT)
+        {
+            ssize_t count = read(connection.fd, buffer, sizeof(buffer));
+            if (count > 0)
+            {
+                connection.input.insert(connection.input.end(), buffer, buffer + count);
+                continue;
+            }
+            if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                connection.closed = true;
+            }
+            if (count == 0 || errno != EINTR)
+            {
+                break;
+            }
+        }
+
+        size_t offset = 0;
+        const std::vector<unsigned char>& input = connection.input;
+        while (input.size() - offset >= LENGTH_SIZE)
+        {
+            const size_t length = Load32(input.data() + offset);
+            if (length < REQUEST_HEADER_SIZE || length > MAX_FRAME_SIZE)
+            {
+                connection.closed = true;
+                break;
+            }
+            if (input.size() - offset - LENGTH_SIZE < length)
+            {
+                break;
+            }
+
+            const unsigned char* body = input.data() + offset + LENGTH_SIZE;
+            auto request = std::make_unique<Request>();
+            request->type = body[0];
+            request->flags = body[1];
+            request->keyIndex = Load16(body + 2);
+            request->requestId = Load32(body + 4);
+            request->payload.assign(body + REQUEST_HEADER_SIZE, body + length);
+            batch.push_back(request.get());
+            connection.requests.push_back(std::move(request));
+            offset += LENGTH_SIZE + length;
+        }
+        connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+    }
+
+    // Moves the answers at the front of the queue, up to the first request
+    // still being worked on, to the output.
+    void QueueResponses(Connection& connection)
+    {
+        while (!connection.requests.empty() && connection.requests.front()->done)
+        {
+            const Request& request = *connection.requests.front();
+            AppendResponse(connection.output, request.status, request.requestId, request.result.data(), request.result.size());
+            connection.requests.pop_front();
+        }
+    }
+
+    void WriteResponses(Connection& connection)
+    {
+        while (connection.written < connection.output.size())
+        {
+            ssize_t count = write(connection.fd, connection.output.data() + connection.written, connection.output.size() - connection.written);
+            if (count > 0)
+            {
+                connection.written += static_cast<size_t>(count);
+            }
+            else if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    connection.closed = true;
+                    connection.output.clear();
+                    connection.written = 0;
+                }
+                return;
+            }
+        }
+        connection.output.clear();
+        connection.written = 0;
+    }
+
+    void AcceptConnections(int listener, std::vector<std::unique_ptr<Connection>>& connections)
+    {
+        for (;;)
+        {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+            if (fd < 0)
+            {
+                return;
+            }
+            auto connection = std::make_unique<Connection>();
+            connection->fd = fd;
+            connections.push_back(std::move(connection));
+        }
+    }
+
+    void Serve(int listener, const Options& options)
+    {
+        WorkStealingPool pool(options.jobs);
+        std::unique_ptr<HashCache> cache;
+        if (!options.cachePath.empty())
+        {
+            cache = std::make_unique<HashCache>(Widen(options.cachePath));
+        }
+
+        // Declared after the connections so that its threads are joined
+        // before the requests they hold are freed.
+        std::vector<std::unique_ptr<Connection>> connections;
+        FileWorkers files(pool.ThreadCount(), options, cache.get());
+        if (!files.IsOpen())
+        {
+            PrintError(std::string("не удалось создать канал: ") + std::strerror(errno));
+            return;
+        }
+
+        std::vector<pollfd> descriptors;
+        std::vector<Request*> batch;
+        std::vector<Request*> signing;
+        while (!g_stop.load())
+        {
+            descriptors.assign({ pollfd{ listener, POLLIN, 0 }, pollfd{ files.WakeDescriptor(), POLLIN, 0 } });
+            for (const auto& connection : connections)
+            {
+                short events = connection->WantsInput() ? POLLIN : 0;
+                if (!connection->output.empty())
+                {
+                    events |= POLLOUT;
+                }
+                descriptors.push_back(pollfd{ connection->fd, events, 0 });
+            }
+            if (poll(descriptors.data(), descriptors.size(), -1) < 0)
+            {
+                continue;
+            }
+
+            batch.clear();
+            for (size_t i = 0; i < connections.size(); ++i)
+            {
+                const short events = descriptors[i + 2].revents;
+                if ((events & (POLLIN | POLLHUP | POLLERR)) && connections[i]->WantsInput())
+                {
+                    ReadRequests(*connections[i], batch);
+                }
+            }
+
+            // Files go to the file workers; the rest is signed here as one
+            // batch. Worker 0 is this thread, which also handles a lone
+            // request without waking the pool.
+            signing.clear();
+            for (Request* request : batch)
+            {
+                if (request->type == SIGN_FILE)
+                {
+                    files.Submit(request);
+                }
+                else
+                {
+                    signing.push_back(request);
+                }
+            }
+            if (signing.size() == 1)
+            {
+                Answer(*signing[0], [&] { Process(*signing[0], options); });
+            }
+            else if (!signing.empty())
+            {
+                pool.ParallelFor(signing.size(), [&](size_t index, size_t)
+                {
+                    Answer(*signing[index], [&] { Process(*signing[index], options); });
+                });
+            }
+            for (Request* request : signing)
+            {
+                request->done = true;
+            }
+            if (descriptors[1].revents & POLLIN)
+            {
+                for (Request* request : files.TakeFinished())
+                {
+                    request->done = true;
+                }
+            }
+
+            for (auto& connection : connections)
+            {
+                QueueResponses(*connection);
+                WriteResponses(*connection);
+            }
+            connections.erase(std::remove_if(connections.begin(), connections.end(), [](const std::unique_ptr<Connection>& connection)
+            {
+                if (connection->closed && connection->output.empty() && connection->requests.empty())
+                {
+                    close(connection->fd);
+                    return true;
+                }
+                return false;
+            }), connections.end());
+
+            if (descriptors[0].revents & POLLIN)
+            {
+                AcceptConnections(listener, connections);
+            }
+        }
+
+        for (auto& connection : connections)
+        {
+            close(connection->fd);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        std::fwrite(USAGE, 1, sizeof(USAGE) - 1, stderr);
+        return 2;
+    }
+
+    struct sigaction action {};
+    action.sa_handler = [](int) { g_stop.store(true); };
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listener = Listen(options.socketPath);
+    if (listener < 0)
+    {
+        return 1;
+    }
+    std::fprintf(stderr, "gostsignd: %zu ключ(ей), сокет %s\n", options.keys.size(), options.socketPath.c_str());
+
+    Serve(listener, options);
+
+    close(listener);
+    unlink(options.socketPath.c_str());
+    return 0;
+}
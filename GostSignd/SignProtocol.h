@@ -0,0 +1,103 @@
+#pragma once
+
+// Wire format between gostsignd and its clients. Every message is a frame: a
+// 4-byte little-endian length of the body, then the body. A client may send
+// any number of requests without waiting; responses on one connection come
+// back in request order.
+//
+// Request body:
+//    0  type                1   RequestType
+//    1  flags               1   FLAG_DETERMINISTIC
+//    2  key index           2   order of the key on the daemon's command line
+//    4  request id          4   echoed in the response
+//    8  payload
+//         SIGN_DIGEST  the digest as the hash produced it (1..64 bytes)
+//         SIGN_FILE    hash name length (1), hash name, path as the file
+//                      system names it (UTF-8 on most systems), without NUL
+//         PUBLIC_KEY   nothing
+//
+// Response body:
+//    0  status              1   Status
+//    1  reserved            3
+//    4  request id          4
+//    8  payload             r || s, or x || y for PUBLIC_KEY; empty on error
+//
+// All integers are little-endian.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gost
+{
+    namespace sign_protocol
+    {
+        constexpr size_t LENGTH_SIZE = 4;
+        constexpr size_t REQUEST_HEADER_SIZE = 8;
+        constexpr size_t RESPONSE_HEADER_SIZE = 8;
+        constexpr size_t MAX_DIGEST_SIZE = 64;
+        // Longer frames are a protocol error and close the connection.
+        constexpr size_t MAX_FRAME_SIZE = 8 << 10;
+
+        enum RequestType : uint8_t
+        {
+            SIGN_DIGEST = 1,
+            SIGN_FILE = 2,
+            PUBLIC_KEY = 3
+        };
+
+        enum Flags : uint8_t
+        {
+            FLAG_DETERMINISTIC = 1
+        };
+
+        enum Status : uint8_t
+        {
+            STATUS_OK = 0,
+            STATUS_BAD_REQUEST = 1,
+            STATUS_UNKNOWN_KEY = 2,
+            STATUS_FAILED = 3
+        };
+
+        inline uint32_t Load32(const unsigned char* p)
+        {
+            return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+                | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        inline uint16_t Load16(const unsigned char* p)
+        {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        inline void Append32(std::vector<unsigned char>& out, uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+            }
+        }
+
+        inline void AppendRequest(std::vector<unsigned char>& out, RequestType type, uint8_t flags, uint16_t keyIndex,
+            uint32_t requestId, const unsigned char* payload, size_t size)
+        {
+            Append32(out, static_cast<uint32_t>(REQUEST_HEADER_SIZE + size));
+            out.push_back(type);
+            out.push_back(flags);
+            out.push_back(static_cast<unsigned char>(keyIndex));
+            out.push_back(static_cast<unsigned char>(keyIndex >> 8));
+            Append32(out, requestId);
+            out.insert(out.end(), payload, payload + size);
+        }
+
+        inline void AppendResponse(std::vector<unsigned char>& out, Status status, uint32_t requestId,
+            const unsigned char* payload, size_t size)
+        {
+            Append32(out, static_cast<uint32_t>(RESPONSE_HEADER_SIZE + size));
+            out.push_back(status);
+            out.insert(out.end(), 3, 0);
+            Append32(out, requestId);
+            out.insert(out.end(), payload, payload + size);
+        }
+    }
+}
@@ -0,0 +1,215 @@
+// Checks that HashCache returns a stored digest only while the file's size,
+// modification time and identity are unchanged, never stores files still
+// inside the racy window, keeps entries across reopening, and empties slots
+// a dead writer left odd once the cache is opened by nobody else. Prints one
+// line per mismatch and exits with 1 if there was any.
+
+#include "FilePath.h"
+#include "HashCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    const size_t SLOTS = 64;
+    // Layout of the cache file, see HashCache.cpp.
+    const size_t HEADER_SIZE = 64;
+    const size_t WRITERS_OFFSET = 16;
+    const size_t SLOT_SIZE = 128;
+
+    uint32_t g_state = 0x9E3779B9;
+
+    std::vector<unsigned char> RandomVector(size_t size)
+    {
+        std::vector<unsigned char> bytes(size);
+        for (auto& byte : bytes)
+        {
+            g_state ^= g_state << 13;
+            g_state ^= g_state >> 17;
+            g_state ^= g_state << 5;
+            byte = static_cast<unsigned char>(g_state);
+        }
+        return bytes;
+    }
+
+    void WriteFile(const fs::path& path, const std::string& content)
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+    }
+
+    // Moves the modification time out of the racy window.
+    void Age(const fs::path& path, int hours)
+    {
+        std::error_code error;
+        fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::hours(hours), error);
+    }
+
+    FileStamp StampOf(const fs::path& path)
+    {
+        auto stamp = FileStamp::Of(FromPath(path));
+        return stamp ? *stamp : FileStamp{};
+    }
+
+    int Expect(bool condition, const char* message)
+    {
+        if (!condition)
+        {
+            std::printf("HashCache: %s\n", message);
+            return 1;
+        }
+        return 0;
+    }
+
+    int CheckInvalidation(const fs::path& directory)
+    {
+        int failures = 0;
+        const std::wstring cachePath = FromPath(directory / "cache.ghc");
+        const fs::path file = directory / "input.bin";
+        const std::wstring path = FromPath(file);
+        const std::vector<unsigned char> digest = RandomVector(32);
+
+        WriteFile(file, "first contents");
+        FileStamp fresh = StampOf(file);
+        failures += Expect(!fresh.settled, "только что записанный файл считается устоявшимся");
+        {
+            HashCache cache(cachePath, SLOTS);
+            failures += Expect(cache.IsOpen(), "кеш не открылся");
+
+            cache.Store(path, fresh, L"Streebog-256", digest);
+            failures += Expect(!cache.Lookup(path, fresh, L"Streebog-256"), "сохранён хеш файла внутри окна гонки");
+
+            Age(file, 1);
+            FileStamp stamp = StampOf(file);
+            failures += Expect(stamp.settled, "старый файл считается неустоявшимся");
+            cache.Store(path, stamp, L"Streebog-256", digest);
+            failures += Expect(cache.Lookup(path, stamp, L"Streebog-256") == digest, "сохранённый хеш не найден");
+            failures += Expect(!cache.Lookup(path, stamp, L"Streebog-512"), "найден хеш другого алгоритма");
+            failures += Expect(!cache.Lookup(FromPath(directory / "other.bin"), stamp, L"Streebog-256"), "найден хеш другого пути");
+            // The same file under a path that normalizes to it.
+            failures += Expect(cache.Lookup(FromPath(directory / "." / "input.bin"), stamp, L"Streebog-256") == digest,
+                "не найден хеш по равнозначному пути");
+        }
+
+        {
+            HashCache cache(cachePath, SLOTS);
+            FileStamp stamp = StampOf(file);
+            failures += Expect(cache.Lookup(path, stamp, L"Streebog-256") == digest, "хеш потерян после повторного открытия");
+            std::error_code error;
+            const fs::file_time_type originalTime = fs::last_write_time(file, error);
+
+            // Same size, other time.
+            Age(file, 2);
+            FileStamp touched = StampOf(file);
+            failures += Expect(touched.size == stamp.size && !cache.Lookup(path, touched, L"Streebog-256"), "найден хеш после смены времени изменения");
+
+            // Other size, same time.
+            WriteFile(file, "second, longer contents");
+            Age(file, 2);
+            failures += Expect(!cache.Lookup(path, StampOf(file), L"Streebog-256"), "найден хеш после смены размера");
+
+            // Another file moved into place with the original size and time.
+            const fs::path replacement = directory / "replacement.bin";
+            WriteFile(replacement, "first contents");
+            fs::last_write_time(replacement, originalTime, error);
+            FileStamp moved = StampOf(replacement);
+            fs::rename(replacement, file, error);
+            FileStamp after = StampOf(file);
+            failures += Expect(moved == after && after.size == stamp.size && after.modified == stamp.modified,
+                "подменённый файл не совпал с исходным по размеру и времени");
+            failures += Expect(!cache.Lookup(path, after, L"Streebog-256"), "найден хеш файла, подменённого другим");
+
+            // A newer digest for the path replaces the stale entry.
+            const std::vector<unsigned char> newer = RandomVector(64);
+            cache.Store(path, after, L"Streebog-256", newer);
+            failures += Expect(cache.Lookup(path, after, L"Streebog-256") == newer && !cache.Lookup(path, stamp, L"Streebog-256"),
+                "новый хеш не заменил устаревший");
+        }
+
+        failures += Expect(!HashCache(cachePath, SLOTS * 2).IsOpen(), "открыт кеш с другим числом ячеек");
+        std::printf("HashCache: проверка устаревших записей завершена\n");
+        return failures;
+    }
+
+    // What a writer that died inside Store leaves behind: every slot odd and
+    // the header still counting it.
+    void AbandonEveryStore(const std::wstring& cachePath)
+    {
+        std::fstream file(ToPath(cachePath), std::ios::binary | std::ios::in | std::ios::out);
+        for (size_t slot = 0; slot < SLOTS; ++slot)
+        {
+            const std::streamoff offset = static_cast<std::streamoff>(HEADER_SIZE + slot * SLOT_SIZE);
+            uint32_t sequence = 0;
+            file.seekg(offset);
+            file.read(reinterpret_cast<char*>(&sequence), sizeof(sequence));
+            sequence |= 1;
+            file.seekp(offset);
+            file.write(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+        }
+        const uint32_t writers = 1;
+        file.seekp(static_cast<std::streamoff>(WRITERS_OFFSET));
+        file.write(reinterpret_cast<const char*>(&writers), sizeof(writers));
+    }
+
+    int CheckAbandonedSlots(const fs::path& directory)
+    {
+        int failures = 0;
+        const std::wstring cachePath = FromPath(directory / "abandoned.ghc");
+        const fs::path file = directory / "abandoned.bin";
+        const std::wstring path = FromPath(file);
+        WriteFile(file, "contents");
+        Age(file, 1);
+        const FileStamp stamp = StampOf(file);
+        const std::vector<unsigned char> digest = RandomVector(32);
+
+        {
+            HashCache cache(cachePath, SLOTS);
+            cache.Store(path, stamp, L"SHA-256", digest);
+        }
+        {
+            // Still open elsewhere: the odd slots must be left alone.
+            HashCache other(cachePath, SLOTS);
+            AbandonEveryStore(cachePath);
+            HashCache cache(cachePath, SLOTS);
+            failures += Expect(cache.IsOpen(), "кеш с брошенными ячейками не открылся");
+            failures += Expect(!cache.Lookup(path, stamp, L"SHA-256"), "найден хеш из брошенной ячейки");
+            cache.Store(path, stamp, L"SHA-256", digest);
+            failures += Expect(!cache.Lookup(path, stamp, L"SHA-256"), "занята брошенная ячейка, пока кеш открыт в другом месте");
+        }
+        {
+            // Opened by nobody else: the slots are emptied and usable again.
+            HashCache cache(cachePath, SLOTS);
+            failures += Expect(!cache.Lookup(path, stamp, L"SHA-256"), "найден хеш из освобождённой ячейки");
+            cache.Store(path, stamp, L"SHA-256", digest);
+            failures += Expect(cache.Lookup(path, stamp, L"SHA-256") == digest, "брошенные ячейки не освобождены");
+        }
+        {
+            HashCache cache(cachePath, SLOTS);
+            failures += Expect(cache.Lookup(path, stamp, L"SHA-256") == digest, "хеш потерян после освобождения ячеек");
+        }
+        std::printf("HashCache: проверка брошенных ячеек завершена\n");
+        return failures;
+    }
+}
+
+int main()
+{
+    const fs::path directory = fs::temp_directory_path() / "gosttests-hashcache";
+    std::error_code error;
+    fs::remove_all(directory, error);
+    fs::create_directories(directory, error);
+
+    int failures = CheckInvalidation(directory);
+    failures += CheckAbandonedSlots(directory);
+
+    fs::remove_all(directory, error);
+    return failures == 0 ? 0 : 1;
+}
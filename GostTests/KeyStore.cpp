@@ -0,0 +1,228 @@
+// Fills a KeyStore with more users than its first bucket table holds, each
+// with keys whose public half is derived from the private one, then reopens
+// the file and checks that every user, key and lookup survived and that
+// StoredKeyParameterSet finds the set each pair was derived under. Prints one
+// line per mismatch and exits with 1 if there was any.
+
+#include "FilePath.h"
+#include "GostCurve.h"
+#include "GostSigner.h"
+#include "Hex.h"
+#include "KeyStore.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    const size_t USERS = 3 * KeyStore::INITIAL_BUCKETS / 2;
+
+    uint32_t g_state = 0x9E3779B9;
+
+    std::vector<unsigned char> RandomVector(size_t size)
+    {
+        std::vector<unsigned char> bytes(size);
+        for (auto& byte : bytes)
+        {
+            g_state ^= g_state << 13;
+            g_state ^= g_state >> 17;
+            g_state ^= g_state << 5;
+            byte = static_cast<unsigned char>(g_state);
+        }
+        return bytes;
+    }
+
+    // Non-ASCII names too, so the name hash sees every byte of wchar_t.
+    std::wstring UserName(size_t index)
+    {
+        return (index % 2 ? L"пользователь-" : L"user-") + std::to_wstring(index);
+    }
+
+    size_t ParameterSetOf(size_t index)
+    {
+        return index % GostSigner::DefaultParameterSets().size();
+    }
+
+    // A key pair as the key window stores it: the public key is derived.
+    StoredKey MakeKey(size_t parameterSet, long long createdAt)
+    {
+        const GostParameters parameters = GostSigner::DefaultParameterSets()[parameterSet];
+        for (;;)
+        {
+            StoredKey key;
+            key.privateKey = RandomVector(GostCurve::Find(parameters.name)->Size());
+            key.createdAt = createdAt;
+            std::wstring error;
+            auto signingKey = SigningKey::Create(parameters.name, FormatHex(key.privateKey), error);
+            if (signingKey)
+            {
+                key.publicKey = signingKey->PublicKey();
+                return key;
+            }
+        }
+    }
+
+    bool SameKey(const StoredKey& a, const StoredKey& b)
+    {
+        return a.privateKey == b.privateKey && a.publicKey == b.publicKey && a.createdAt == b.createdAt;
+    }
+
+    int Fill(const std::wstring& path, std::vector<std::vector<StoredKey>>& expected)
+    {
+        int failures = 0;
+        KeyStore store(path);
+        if (!store.IsOpen())
+        {
+            std::printf("KeyStore: не удалось создать файл\n");
+            return 1;
+        }
+
+        expected.assign(USERS, {});
+        for (size_t i = 0; i < USERS; ++i)
+        {
+            if (!store.AddUser(UserName(i)))
+            {
+                std::printf("KeyStore: пользователь %zu не добавлен\n", i);
+                ++failures;
+            }
+            for (size_t k = 0; k < 1 + i % 3; ++k)
+            {
+                expected[i].push_back(MakeKey(ParameterSetOf(i), static_cast<long long>(i * 10 + k + 1)));
+                if (!store.AddKey(UserName(i), expected[i].back()))
+                {
+                    std::printf("KeyStore: ключ пользователя %zu не добавлен\n", i);
+                    ++failures;
+                }
+            }
+        }
+
+        int accepted = store.AddUser(UserName(0)) + store.AddUser(L"") + store.AddUser(std::wstring(KeyStore::MAX_NAME_LENGTH + 1, L'x'))
+            + store.AddKey(L"нет такого", MakeKey(0, 0));
+        if (accepted != 0)
+        {
+            std::printf("KeyStore: принято %d неверных добавлений\n", accepted);
+            ++failures;
+        }
+        if (!store.Flush())
+        {
+            std::printf("KeyStore: Flush не удался\n");
+            ++failures;
+        }
+        return failures;
+    }
+
+    int CheckReopened(const std::wstring& path, std::vector<std::vector<StoredKey>>& expected)
+    {
+        int failures = 0;
+        KeyStore store(path);
+        if (!store.IsOpen() || store.UserCount() != USERS)
+        {
+            std::printf("KeyStore: после открытия не те пользователи\n");
+            return 1;
+        }
+
+        const std::vector<std::wstring> users = store.Users();
+        for (size_t i = 0; i < USERS; ++i)
+        {
+            if (i >= users.size() || users[i] != UserName(i) || !store.HasUser(UserName(i)))
+            {
+                std::printf("KeyStore: пользователь %zu не найден или не на своём месте\n", i);
+                ++failures;
+                continue;
+            }
+
+            const std::vector<StoredKey> keys = store.Keys(UserName(i));
+            bool same = keys.size() == expected[i].size();
+            for (size_t k = 0; same && k < keys.size(); ++k)
+            {
+                same = SameKey(keys[k], expected[i][k]);
+            }
+            auto latest = store.LatestKey(UserName(i));
+            if (!same || !latest || !SameKey(*latest, expected[i].back()))
+            {
+                std::printf("KeyStore: ключи пользователя %zu не совпадают\n", i);
+                ++failures;
+                continue;
+            }
+            if (StoredKeyParameterSet(*latest) != ParameterSetOf(i))
+            {
+                std::printf("KeyStore: набор параметров ключа пользователя %zu не определён\n", i);
+                ++failures;
+            }
+        }
+        if (store.HasUser(L"user") || store.HasUser(L"нет такого") || store.LatestKey(L"нет такого"))
+        {
+            std::printf("KeyStore: найден несуществующий пользователь\n");
+            ++failures;
+        }
+
+        // A key appended after reopening becomes the latest.
+        expected[0].push_back(MakeKey(ParameterSetOf(0), 1));
+        if (!store.AddKey(UserName(0), expected[0].back()) || !SameKey(*store.LatestKey(UserName(0)), expected[0].back()))
+        {
+            std::printf("KeyStore: ключ, добавленный после открытия, не стал последним\n");
+            ++failures;
+        }
+        return failures;
+    }
+
+    // Public keys that do not come from the private key, or come from it
+    // under another set, match no set.
+    int CheckMismatchedPairs()
+    {
+        int failures = 0;
+        const size_t sets = GostSigner::DefaultParameterSets().size();
+        for (size_t set = 0; set < sets; ++set)
+        {
+            StoredKey key = MakeKey(set, 0);
+            StoredKey foreign = MakeKey(set, 0);
+            StoredKey damaged = key;
+            damaged.publicKey.back() ^= 1;
+            StoredKey swapped = key;
+            swapped.publicKey = foreign.publicKey;
+            StoredKey empty = key;
+            empty.publicKey.clear();
+            if (StoredKeyParameterSet(key) != set || StoredKeyParameterSet(damaged) || StoredKeyParameterSet(swapped) || StoredKeyParameterSet(empty))
+            {
+                std::printf("KeyStore: StoredKeyParameterSet ошибся на наборе %zu\n", set);
+                ++failures;
+            }
+        }
+        return failures;
+    }
+}
+
+int main()
+{
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::temp_directory_path() / "gosttests-keystore";
+    std::error_code error;
+    fs::remove_all(directory, error);
+    fs::create_directories(directory, error);
+    const std::wstring path = FromPath(directory / "users.gks");
+
+    std::vector<std::vector<StoredKey>> expected;
+    int failures = Fill(path, expected);
+    // Twice, so the key appended by the first pass is checked too.
+    failures += CheckReopened(path, expected);
+    failures += CheckReopened(path, expected);
+    failures += CheckMismatchedPairs();
+
+    // Another format is left alone.
+    const fs::path foreign = directory / "foreign.gks";
+    std::ofstream(foreign, std::ios::binary) << std::string(4096, 'x');
+    if (KeyStore(FromPath(foreign)).IsOpen())
+    {
+        std::printf("KeyStore: открыт файл чужого формата\n");
+        ++failures;
+    }
+
+    fs::remove_all(directory, error);
+    std::printf("KeyStore: проверено %zu пользователей\n", USERS);
+    return failures == 0 ? 0 : 1;
+}
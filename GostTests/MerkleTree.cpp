@@ -0,0 +1,293 @@
+// Checks MerkleTree against a direct recursive implementation of the Merkle
+// tree hash and audit paths of RFC 6962 with SHA-256: the RFC's own test tree,
+// then every leaf count up to a few levels with odd leaves at each level, and
+// HashFileTree on files split into odd numbers of chunks. Audit paths must
+// fold back into the root and stop doing so when anything in them changes.
+// Prints one line per mismatch and exits with 1 if there was any.
+
+#include "FilePath.h"
+#include "GostSigner.h"
+#include "Hex.h"
+#include "MerkleTree.h"
+#include "Sha.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    using Digest = MerkleTree::Digest;
+
+    const size_t MAX_LEAVES = 70;
+
+    uint32_t g_state = 0x9E3779B9;
+
+    std::vector<unsigned char> RandomVector(size_t size)
+    {
+        std::vector<unsigned char> bytes(size);
+        for (auto& byte : bytes)
+        {
+            g_state ^= g_state << 13;
+            g_state ^= g_state >> 17;
+            g_state ^= g_state << 5;
+            byte = static_cast<unsigned char>(g_state);
+        }
+        return bytes;
+    }
+
+    Digest HashWithPrefix(unsigned char prefix, const Digest& left, const Digest& right = {})
+    {
+        std::vector<unsigned char> input(1, prefix);
+        input.insert(input.end(), left.begin(), left.end());
+        input.insert(input.end(), right.begin(), right.end());
+        return Sha256::Hash(input.data(), input.size());
+    }
+
+    std::optional<Digest> HashNode(const Digest& left, const Digest& right)
+    {
+        return HashWithPrefix(MerkleTree::NODE_PREFIX, left, right);
+    }
+
+    // Largest power of two smaller than n (n > 1).
+    size_t Split(size_t n)
+    {
+        size_t k = 1;
+        while (k * 2 < n)
+        {
+            k *= 2;
+        }
+        return k;
+    }
+
+    // MTH(D[n]) of RFC 6962, section 2.1, over leaf digests.
+    Digest ReferenceRoot(const std::vector<Digest>& leaves, size_t begin, size_t end)
+    {
+        if (end - begin == 1)
+        {
+            return leaves[begin];
+        }
+        const size_t k = Split(end - begin);
+        return *HashNode(ReferenceRoot(leaves, begin, begin + k), ReferenceRoot(leaves, begin + k, end));
+    }
+
+    // PATH(m, D[n]) of RFC 6962, section 2.1.1, leaf level first.
+    std::vector<Digest> ReferencePath(const std::vector<Digest>& leaves, size_t m, size_t begin, size_t end)
+    {
+        if (end - begin == 1)
+        {
+            return {};
+        }
+        const size_t k = Split(end - begin);
+        std::vector<Digest> path;
+        if (m < k)
+        {
+            path = ReferencePath(leaves, m, begin, begin + k);
+            path.push_back(ReferenceRoot(leaves, begin + k, end));
+        }
+        else
+        {
+            path = ReferencePath(leaves, m - k, begin + k, end);
+            path.push_back(ReferenceRoot(leaves, begin, begin + k));
+        }
+        return path;
+    }
+
+    std::vector<Digest> LeafDigests(const std::vector<std::vector<unsigned char>>& data)
+    {
+        std::vector<Digest> leaves;
+        for (const auto& entry : data)
+        {
+            leaves.push_back(HashWithPrefix(MerkleTree::LEAF_PREFIX, entry));
+        }
+        return leaves;
+    }
+
+    // The test tree of RFC 6962's reference implementation and the roots of
+    // its first 1..8 leaves.
+    int CheckKnownAnswers()
+    {
+        const std::vector<std::vector<unsigned char>> data = {
+            {},
+            { 0x00 },
+            { 0x10 },
+            { 0x20, 0x21 },
+            { 0x30, 0x31 },
+            { 0x40, 0x41, 0x42, 0x43 },
+            { 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57 },
+            { 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f },
+        };
+        const wchar_t* const roots[] = {
+            L"6e340b9cffb37a989ca544e6bb780a2c78901d3fb33738768511a30617afa01d",
+            L"fac54203e7cc696cf0dfcb42c92a1d9dbaf70ad9e621f4bd8d98662f00e3c125",
+            L"aeb6bcfe274b70a14fb067a5e5578264db0fa9b51af5e0ba159158f329e06e77",
+            L"d37ee418976dd95753c1c73862b9398fa2a2cf9b4ff0fdfe8b30cd95209614b7",
+            L"4e3bbb1f7b478dcfe71fb631631519a3bca12c9aefca1612bfce4c13a86264d4",
+            L"76e67dadbcdf1e10e1b74ddc608abd2f98dfb16fbce75277b5232a127f2087ef",
+            L"ddb89be403809e325750d3d263cd78929c2942b7942a34b77e122c9594a74c8c",
+            L"5dc9da79a70659a9ad559cb701ded9a2ab9d823aad2f4960cfe370eff4604328",
+        };
+
+        int failures = 0;
+        const std::vector<Digest> leaves = LeafDigests(data);
+        for (size_t count = 1; count <= leaves.size(); ++count)
+        {
+            auto tree = MerkleTree::Build(std::vector<Digest>(leaves.begin(), leaves.begin() + count), HashNode);
+            if (!tree || tree->Root() != ParseHex(roots[count - 1]))
+            {
+                std::printf("MerkleTree: неверный корень дерева RFC 6962 из %zu листьев\n", count);
+                ++failures;
+            }
+        }
+        std::printf("MerkleTree: примеры RFC 6962 проверены\n");
+        return failures;
+    }
+
+    int CheckAuditPaths(const MerkleTree& tree, const std::vector<Digest>& leaves)
+    {
+        int failures = 0;
+        const size_t count = leaves.size();
+        for (size_t index = 0; index < count; ++index)
+        {
+            const std::vector<Digest> path = tree.AuditPath(index);
+            if (path != ReferencePath(leaves, index, 0, count))
+            {
+                std::printf("MerkleTree: путь листа %zu из %zu расходится с RFC 6962\n", index, count);
+                ++failures;
+                continue;
+            }
+            if (MerkleTree::RootFromAuditPath(leaves[index], index, count, path, HashNode) != tree.Root())
+            {
+                std::printf("MerkleTree: путь листа %zu из %zu не даёт корень\n", index, count);
+                ++failures;
+            }
+
+            // A changed leaf, sibling, position, leaf count or path length
+            // must not lead to the same root.
+            std::vector<std::optional<Digest>> forged;
+            Digest leaf = leaves[index];
+            leaf[index % leaf.size()] ^= 1;
+            forged.push_back(MerkleTree::RootFromAuditPath(leaf, index, count, path, HashNode));
+            for (size_t i = 0; i < path.size(); ++i)
+            {
+                std::vector<Digest> damaged = path;
+                damaged[i][0] ^= 0x80;
+                forged.push_back(MerkleTree::RootFromAuditPath(leaves[index], index, count, damaged, HashNode));
+            }
+            if (count > 1)
+            {
+                forged.push_back(MerkleTree::RootFromAuditPath(leaves[index], index ^ 1, count, path, HashNode));
+            }
+            std::vector<Digest> longer = path;
+            longer.push_back(leaves[index]);
+            forged.push_back(MerkleTree::RootFromAuditPath(leaves[index], index, count, longer, HashNode));
+            if (!path.empty())
+            {
+                std::vector<Digest> shorter(path.begin(), path.end() - 1);
+                forged.push_back(MerkleTree::RootFromAuditPath(leaves[index], index, count, shorter, HashNode));
+            }
+            forged.push_back(MerkleTree::RootFromAuditPath(leaves[index], count, count, path, HashNode));
+            for (const auto& root : forged)
+            {
+                if (root == tree.Root())
+                {
+                    std::printf("MerkleTree: изменённый путь листа %zu из %zu принят\n", index, count);
+                    ++failures;
+                    break;
+                }
+            }
+        }
+        return failures;
+    }
+
+    // Every count up to MAX_LEAVES, so odd nodes are promoted from every level
+    // and from several levels in one tree.
+    int CheckLeafCounts()
+    {
+        int failures = 0;
+        std::vector<std::vector<unsigned char>> data;
+        for (size_t count = 1; count <= MAX_LEAVES; ++count)
+        {
+            data.push_back(RandomVector(count % 5 * 7));
+            const std::vector<Digest> leaves = LeafDigests(data);
+            auto tree = MerkleTree::Build(leaves, HashNode);
+            if (!tree || tree->LeafCount() != count || tree->Root() != ReferenceRoot(leaves, 0, count))
+            {
+                std::printf("MerkleTree: корень дерева из %zu листьев расходится с RFC 6962\n", count);
+                ++failures;
+                continue;
+            }
+            failures += CheckAuditPaths(*tree, leaves);
+        }
+
+        if (MerkleTree::Build({}, HashNode))
+        {
+            std::printf("MerkleTree: построено дерево без листьев\n");
+            ++failures;
+        }
+        auto failing = [](const Digest&, const Digest&) -> std::optional<Digest> { return std::nullopt; };
+        if (MerkleTree::Build(LeafDigests(data), failing))
+        {
+            std::printf("MerkleTree: построено дерево при ошибке хеширования\n");
+            ++failures;
+        }
+        std::printf("MerkleTree: деревья из 1..%zu листьев проверены\n", MAX_LEAVES);
+        return failures;
+    }
+
+    // Chunk counts of 1, 2, 3, 5, 7 and 13, the last chunk short or full, on
+    // more threads than some of them have chunks.
+    int CheckFileTrees()
+    {
+        namespace fs = std::filesystem;
+        const fs::path directory = fs::temp_directory_path() / "gosttests-merkletree";
+        std::error_code error;
+        fs::remove_all(directory, error);
+        fs::create_directories(directory, error);
+
+        const unsigned long long chunkSize = 4096;
+        int failures = 0;
+        GostSigner signer;
+        for (size_t size : { 1, 4096, 4097, 3 * 4096 - 1, 5 * 4096, 7 * 4096 - 100, 12 * 4096 + 1 })
+        {
+            const std::vector<unsigned char> content = RandomVector(size);
+            const fs::path file = directory / ("input-" + std::to_string(size));
+            std::ofstream(file, std::ios::binary).write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+
+            std::vector<std::vector<unsigned char>> chunks;
+            for (size_t offset = 0; offset < size; offset += chunkSize)
+            {
+                chunks.emplace_back(content.begin() + offset, content.begin() + std::min<size_t>(size, offset + chunkSize));
+            }
+            const std::vector<Digest> leaves = LeafDigests(chunks);
+
+            TreeHashOptions options;
+            options.chunkSize = chunkSize;
+            options.concurrency = 4;
+            auto tree = signer.HashFileTree(FromPath(file), L"SHA-256", options);
+            if (!tree || tree->LeafCount() != leaves.size() || tree->Root() != ReferenceRoot(leaves, 0, leaves.size()))
+            {
+                std::printf("MerkleTree: корень HashFileTree для файла из %zu байт расходится с RFC 6962\n", size);
+                ++failures;
+            }
+        }
+
+        fs::remove_all(directory, error);
+        std::printf("MerkleTree: HashFileTree проверен\n");
+        return failures;
+    }
+}
+
+int main()
+{
+    int failures = CheckKnownAnswers();
+    failures += CheckLeafCounts();
+    failures += CheckFileTrees();
+    return failures == 0 ? 0 : 1;
+}
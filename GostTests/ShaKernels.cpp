@@ -0,0 +1,193 @@
+// Runs every SHA-256 and SHA-1 kernel this build and CPU can run, and every
+// SHA-256 lane width, against the FIPS 180 examples and against the scalar
+// code on messages of every length around the block boundaries. Prints one
+// line per mismatch and exits with 1 if there was any.
+
+#include "Hex.h"
+#include "Sha.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    struct KnownAnswer
+    {
+        std::string message;
+        const wchar_t* sha256;
+        const wchar_t* sha1;
+    };
+
+    const KnownAnswer KNOWN_ANSWERS[] = {
+        { "",
+            L"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            L"da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+        { "abc",
+            L"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            L"a9993e364706816aba3e25717850c26c9cd0d89d" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+            L"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            L"84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+        { std::string(1000000, 'a'),
+            L"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+            L"34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+    };
+
+    // Every length up to four blocks, then a few multi-block ones.
+    std::vector<std::vector<unsigned char>> Messages()
+    {
+        std::vector<size_t> sizes;
+        for (size_t size = 0; size <= 4 * Sha256::BLOCK_SIZE; ++size)
+        {
+            sizes.push_back(size);
+        }
+        for (size_t size : { 1000, 4096, 4096 + 55, 65536 + 63 })
+        {
+            sizes.push_back(size);
+        }
+
+        uint32_t state = 0x9E3779B9;
+        std::vector<std::vector<unsigned char>> messages;
+        for (size_t size : sizes)
+        {
+            std::vector<unsigned char> message(size);
+            for (auto& byte : message)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                byte = static_cast<unsigned char>(state);
+            }
+            messages.push_back(std::move(message));
+        }
+        return messages;
+    }
+
+    // Whole, and fed in uneven pieces so partial blocks are carried between
+    // Update calls.
+    template <typename Sha>
+    std::vector<std::vector<unsigned char>> Digests(const unsigned char* data, size_t size)
+    {
+        std::vector<std::vector<unsigned char>> digests(2, std::vector<unsigned char>(Sha::DIGEST_SIZE));
+        Sha sha;
+        sha.Update(data, size);
+        sha.Finish(digests[0].data());
+
+        size_t offset = 0;
+        for (size_t piece = 1; offset < size; piece = piece * 3 + 1)
+        {
+            const size_t take = std::min(piece, size - offset);
+            sha.Update(data + offset, take);
+            offset += take;
+        }
+        sha.Finish(digests[1].data());
+        return digests;
+    }
+
+    template <typename Sha>
+    int CheckKernels(const char* name, const wchar_t* KnownAnswer::*expected, const std::vector<std::vector<unsigned char>>& messages)
+    {
+        Sha::ForceKernel(ShaKernel::Scalar);
+        std::vector<std::vector<unsigned char>> reference;
+        for (const auto& message : messages)
+        {
+            reference.push_back(Sha::Hash(message.data(), message.size()));
+        }
+
+        int failures = 0;
+        for (ShaKernel kernel : Sha::AvailableKernels())
+        {
+            Sha::ForceKernel(kernel);
+            for (const KnownAnswer& answer : KNOWN_ANSWERS)
+            {
+                const auto* data = reinterpret_cast<const unsigned char*>(answer.message.data());
+                for (const auto& digest : Digests<Sha>(data, answer.message.size()))
+                {
+                    if (digest != ParseHex(answer.*expected))
+                    {
+                        std::printf("%s %s: неверный хеш FIPS-примера длиной %zu\n", name, ShaKernelName(kernel), answer.message.size());
+                        ++failures;
+                    }
+                }
+            }
+            for (size_t i = 0; i < messages.size(); ++i)
+            {
+                for (const auto& digest : Digests<Sha>(messages[i].data(), messages[i].size()))
+                {
+                    if (digest != reference[i])
+                    {
+                        std::printf("%s %s: расходится со scalar на длине %zu\n", name, ShaKernelName(kernel), messages[i].size());
+                        ++failures;
+                    }
+                }
+            }
+            std::printf("%s %s: проверено\n", name, ShaKernelName(kernel));
+        }
+        return failures;
+    }
+
+    // Groups of similar and of mixed lengths, and counts that leave lanes empty.
+    int CheckLanes(const std::vector<std::vector<unsigned char>>& messages)
+    {
+        Sha256::ForceKernel(ShaKernel::Scalar);
+        std::vector<std::vector<unsigned char>> reference;
+        for (const auto& message : messages)
+        {
+            reference.push_back(Sha256::Hash(message.data(), message.size()));
+        }
+
+        int failures = 0;
+        for (size_t lanes : Sha256::AvailableLanes())
+        {
+            Sha256::ForceLanes(lanes);
+            for (size_t stride : { size_t{ 1 }, size_t{ 7 }, size_t{ 37 } })
+            {
+                for (size_t count = 1; count <= 2 * 16 + 1; count += 3)
+                {
+                    std::vector<const unsigned char*> data;
+                    std::vector<size_t> sizes;
+                    std::vector<size_t> indices;
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        const size_t index = (i * stride) % messages.size();
+                        data.push_back(messages[index].data());
+                        sizes.push_back(messages[index].size());
+                        indices.push_back(index);
+                    }
+                    std::vector<std::vector<unsigned char>> digests(count, std::vector<unsigned char>(Sha256::DIGEST_SIZE));
+                    std::vector<unsigned char*> outputs;
+                    for (auto& digest : digests)
+                    {
+                        outputs.push_back(digest.data());
+                    }
+
+                    Sha256::HashLanes(data.data(), sizes.data(), count, outputs.data());
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        if (digests[i] != reference[indices[i]])
+                        {
+                            std::printf("SHA-256 x%zu: расходится со scalar на длине %zu (%zu сообщений)\n", lanes, sizes[i], count);
+                            ++failures;
+                        }
+                    }
+                }
+            }
+            std::printf("SHA-256 x%zu: проверено\n", lanes);
+        }
+        Sha256::ForceLanes(0);
+        return failures;
+    }
+}
+
+int main()
+{
+    const std::vector<std::vector<unsigned char>> messages = Messages();
+    int failures = CheckKernels<Sha256>("SHA-256", &KnownAnswer::sha256, messages);
+    failures += CheckKernels<Sha1>("SHA-1", &KnownAnswer::sha1, messages);
+    failures += CheckLanes(messages);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,345 @@
+// Signs and verifies on every tc26 parameter set, both through the curve
+// Find returns (Edwards form for paramSetA and paramSetC) and through the
+// Jacobian one, and checks that the two agree on keys and signatures, that
+// each accepts the other's signatures and that both reject tampered
+// signatures, digests and keys. Then checks the same through GostSigner and
+// the binary container: hex fields that do not decode, and containers that are
+// truncated, oversized or have a damaged header, must be rejected. Prints one
+// line per mismatch and exits with 1 if there was any.
+
+#include "GostCurve.h"
+#include "GostSigner.h"
+#include "Hex.h"
+#include "SignatureContainer.h"
+#include "Streebog.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    uint32_t g_state = 0x9E3779B9;
+
+    void RandomBytes(unsigned char* buffer, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            g_state ^= g_state << 13;
+            g_state ^= g_state >> 17;
+            g_state ^= g_state << 5;
+            buffer[i] = static_cast<unsigned char>(g_state);
+        }
+    }
+
+    std::vector<unsigned char> RandomVector(size_t size)
+    {
+        std::vector<unsigned char> bytes(size);
+        RandomBytes(bytes.data(), size);
+        return bytes;
+    }
+
+    int CheckCurves(const GostParameters& parameters)
+    {
+        const std::string name(parameters.name.begin(), parameters.name.end());
+        const GostCurve* curves[] = { GostCurve::Find(parameters.name), GostCurve::FindJacobian(parameters.name.c_str()) };
+        const char* paths[] = { "Find", "FindJacobian" };
+        if (!curves[0] || !curves[1])
+        {
+            std::printf("%s: кривая не найдена\n", name.c_str());
+            return 1;
+        }
+        const size_t size = curves[0]->Size();
+
+        int failures = 0;
+        for (int round = 0; round < 4; ++round)
+        {
+            std::vector<unsigned char> privateKey(size);
+            const std::vector<unsigned char> material = RandomVector(size + 8);
+            if (!curves[0]->NormalizePrivateKey(material.data(), material.size(), privateKey.data()))
+            {
+                continue;
+            }
+            const std::vector<unsigned char> publicKey = curves[0]->PublicKey(privateKey.data());
+            if (curves[1]->PublicKey(privateKey.data()) != publicKey)
+            {
+                std::printf("%s: публичные ключи двух путей различаются\n", name.c_str());
+                ++failures;
+            }
+
+            // An all-zero digest is signed as e = 1.
+            const std::string message = "message " + std::to_string(round);
+            const std::vector<unsigned char> digest = round == 0
+                ? std::vector<unsigned char>(size)
+                : Streebog::Hash(reinterpret_cast<const unsigned char*>(message.data()), message.size(), size);
+
+            // With the same k both paths must give the same r || s. Sign draws
+            // again while k >= q, so k is kept below every q.
+            std::vector<unsigned char> nonce = RandomVector(size);
+            nonce[0] &= 0x1F;
+            RandomSource fixed = [&nonce](unsigned char* buffer, size_t count)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    buffer[i] = nonce[i % nonce.size()];
+                }
+            };
+            if (curves[0]->Sign(digest, privateKey.data(), fixed) != curves[1]->Sign(digest, privateKey.data(), fixed))
+            {
+                std::printf("%s: подписи двух путей с одним k различаются\n", name.c_str());
+                ++failures;
+            }
+
+            for (int signer = 0; signer < 2; ++signer)
+            {
+                const std::vector<unsigned char> signature = curves[signer]->Sign(digest, privateKey.data(), RandomBytes);
+                for (int verifier = 0; verifier < 2; ++verifier)
+                {
+                    const GostCurve& curve = *curves[verifier];
+                    if (!curve.Verify(digest, signature, publicKey))
+                    {
+                        std::printf("%s: %s не принимает подпись %s\n", name.c_str(), paths[verifier], paths[signer]);
+                        ++failures;
+                    }
+
+                    // One flipped bit anywhere in r, s, the digest or the key.
+                    int accepted = 0;
+                    for (size_t bit = 0; bit < 8 * signature.size(); bit += 7)
+                    {
+                        std::vector<unsigned char> tampered = signature;
+                        tampered[bit / 8] ^= static_cast<unsigned char>(1u << (bit % 8));
+                        accepted += curve.Verify(digest, tampered, publicKey);
+                    }
+                    // Bit 0 is skipped: e = 0 is signed as 1, so it does not change
+                    // the all-zero digest.
+                    for (size_t bit = 3; bit < 8 * digest.size(); bit += 5)
+                    {
+                        std::vector<unsigned char> tampered = digest;
+                        tampered[bit / 8] ^= static_cast<unsigned char>(1u << (bit % 8));
+                        accepted += curve.Verify(tampered, signature, publicKey);
+                    }
+                    for (size_t bit = 0; bit < 8 * publicKey.size(); bit += 11)
+                    {
+                        std::vector<unsigned char> tampered = publicKey;
+                        tampered[bit / 8] ^= static_cast<unsigned char>(1u << (bit % 8));
+                        accepted += curve.Verify(digest, signature, tampered);
+                    }
+
+                    // r = 0, s = 0, and halves of the wrong length.
+                    std::vector<unsigned char> zeroR = signature;
+                    std::memset(zeroR.data(), 0, size);
+                    std::vector<unsigned char> zeroS = signature;
+                    std::memset(zeroS.data() + size, 0, size);
+                    std::vector<unsigned char> shortSignature(signature.begin(), signature.end() - 1);
+                    std::vector<unsigned char> shortKey(publicKey.begin(), publicKey.end() - 1);
+                    accepted += curve.Verify(digest, zeroR, publicKey);
+                    accepted += curve.Verify(digest, zeroS, publicKey);
+                    accepted += curve.Verify(digest, shortSignature, publicKey);
+                    accepted += curve.Verify(digest, signature, shortKey);
+                    if (accepted != 0)
+                    {
+                        std::printf("%s: %s принял %d испорченных подписей %s\n", name.c_str(), paths[verifier], accepted, paths[signer]);
+                        ++failures;
+                    }
+
+                    // VerifyBatch must agree with Verify, with and without a key table.
+                    std::vector<unsigned char> tampered = signature;
+                    tampered[size] ^= 1;
+                    for (bool withTable : { false, true })
+                    {
+                        auto prepared = curve.PrepareKey(publicKey, withTable);
+                        if (!prepared)
+                        {
+                            std::printf("%s: %s не принял ключ в PrepareKey\n", name.c_str(), paths[verifier]);
+                            ++failures;
+                            continue;
+                        }
+                        const std::vector<bool> results = curve.VerifyBatch({ { &digest, &signature, prepared.get() }, { &digest, &tampered, prepared.get() } });
+                        if (results != std::vector<bool>{ true, false })
+                        {
+                            std::printf("%s: %s VerifyBatch расходится с Verify\n", name.c_str(), paths[verifier]);
+                            ++failures;
+                        }
+                    }
+                }
+            }
+        }
+        std::printf("%s: кривые проверены\n", name.c_str());
+        return failures;
+    }
+
+    // GostSigner round trip on hex fields, and hex that must not decode.
+    int CheckSigner(const GostParameters& parameters)
+    {
+        const std::string name(parameters.name.begin(), parameters.name.end());
+        const std::wstring hashName = GostCurve::Find(parameters.name)->Size() == 64 ? L"Streebog-512" : L"Streebog-256";
+        const std::wstring privateKeyHex = FormatHex(RandomVector(GostCurve::Find(parameters.name)->Size()));
+        const std::string message = "The quick brown fox jumps over the lazy dog";
+
+        int failures = 0;
+        GostSigner signer;
+        MemoryByteSource source(reinterpret_cast<const unsigned char*>(message.data()), message.size());
+        GostSignature signature = signer.SignStream(source, parameters, L" \t" + privateKeyHex + L"\r\n", hashName, NonceMode::Deterministic);
+        if (signature.signatureHex.empty())
+        {
+            std::printf("%s: SignStream не подписал: %ls\n", name.c_str(), signature.statusMessage.c_str());
+            return 1;
+        }
+
+        std::wstring error;
+        auto key = SigningKey::Create(parameters.name, privateKeyHex, error);
+        if (!key || FormatHex(key->PublicKey()) != signature.publicKeyHex)
+        {
+            std::printf("%s: публичный ключ SigningKey не совпадает с ключом подписи\n", name.c_str());
+            ++failures;
+        }
+
+        const std::vector<unsigned char> hash = Streebog::Hash(reinterpret_cast<const unsigned char*>(message.data()), message.size(), hashName == L"Streebog-512" ? 64 : 32);
+        if (!signer.Verify(hash, signature, signature.publicKeyHex) || !signer.Verify(hash, signature, L" " + signature.publicKeyHex + L"\n"))
+        {
+            std::printf("%s: Verify не принимает подпись SignStream: %ls\n", name.c_str(), signer.GetLastError().c_str());
+            ++failures;
+        }
+
+        // Characters next to the hex ranges, a space inside, odd lengths and
+        // non-ASCII digits, at every position so the vector decoders see them.
+        const wchar_t BAD[] = { L'g', L'G', L'/', L':', L'@', L'`', L' ', L'\0', 0x0660, 0x0130, 0xFF10 };
+        int accepted = 0;
+        for (size_t position = 0; position < signature.signatureHex.size(); ++position)
+        {
+            for (wchar_t bad : BAD)
+            {
+                GostSignature tampered = signature;
+                tampered.signatureHex[position] = bad;
+                if (bad == L' ' && (position == 0 || position + 1 == tampered.signatureHex.size()))
+                {
+                    continue;
+                }
+                accepted += signer.Verify(hash, tampered, signature.publicKeyHex);
+
+                std::wstring keyHex = signature.publicKeyHex;
+                keyHex[position % keyHex.size()] = bad;
+                if (bad != L' ' || (position % keyHex.size() != 0 && position % keyHex.size() + 1 != keyHex.size()))
+                {
+                    accepted += signer.Verify(hash, signature, keyHex);
+                }
+
+                std::vector<unsigned char> bytes(signature.signatureHex.size() / 2);
+                accepted += DecodeHex(tampered.signatureHex.data(), tampered.signatureHex.size(), bytes.data());
+                accepted += ParseHex(tampered.signatureHex).has_value();
+                if (bad < 0x80)
+                {
+                    std::string narrow(tampered.signatureHex.begin(), tampered.signatureHex.end());
+                    accepted += DecodeHex(narrow.data(), narrow.size(), bytes.data());
+                }
+            }
+        }
+        GostSignature odd = signature;
+        odd.signatureHex.pop_back();
+        accepted += signer.Verify(hash, odd, signature.publicKeyHex);
+        accepted += ParseHex(odd.signatureHex).has_value();
+        accepted += SigningKey::Create(parameters.name, privateKeyHex + L"0", error) != nullptr;
+        accepted += SigningKey::Create(parameters.name, L"x" + privateKeyHex.substr(1), error) != nullptr;
+        if (accepted != 0)
+        {
+            std::printf("%s: принято %d полей с неверным hex\n", name.c_str(), accepted);
+            ++failures;
+        }
+
+        // Both cases decode, and encoding round-trips at every length.
+        if (ParseHex(L"0aBcDeF9") != std::vector<unsigned char>{ 0x0A, 0xBC, 0xDE, 0xF9 })
+        {
+            std::printf("hex: не разобраны смешанные регистры\n");
+            ++failures;
+        }
+        for (size_t size = 0; size < 200; ++size)
+        {
+            const std::vector<unsigned char> bytes = RandomVector(size);
+            if (ParseHex(FormatHex(bytes)) != bytes)
+            {
+                std::printf("hex: FormatHex/ParseHex не сходятся на длине %zu\n", size);
+                ++failures;
+            }
+        }
+
+        std::printf("%s: GostSigner и hex проверены\n", name.c_str());
+        return failures;
+    }
+
+    // Truncated, oversized and damaged containers must not parse.
+    int CheckContainer(const GostParameters& parameters)
+    {
+        const std::string name(parameters.name.begin(), parameters.name.end());
+        const std::wstring hashName = L"Streebog-256";
+        const std::string message = "container";
+        const std::vector<unsigned char> hash = Streebog::Hash(reinterpret_cast<const unsigned char*>(message.data()), message.size(), 32);
+
+        GostSigner signer;
+        MemoryByteSource source(reinterpret_cast<const unsigned char*>(message.data()), message.size());
+        GostSignature signature = signer.SignStream(source, parameters, FormatHex(RandomVector(32)), hashName, NonceMode::Random);
+        const std::vector<unsigned char> publicKey = *ParseHex(signature.publicKeyHex);
+
+        int failures = 0;
+        for (bool includePublicKey : { true, false })
+        {
+            const std::vector<unsigned char> container = EncodeSignature(signature, includePublicKey);
+            auto view = SignatureView::Parse(container.data(), container.size());
+            if (!view || !signer.Verify(hash, *view, publicKey))
+            {
+                std::printf("%s: контейнер не разобран или не проверен\n", name.c_str());
+                ++failures;
+                continue;
+            }
+
+            int accepted = 0;
+            for (size_t size = 0; size < container.size(); ++size)
+            {
+                std::vector<unsigned char> truncated(container.begin(), container.begin() + size);
+                accepted += SignatureView::Parse(truncated.data(), truncated.size()).has_value();
+            }
+            std::vector<unsigned char> longer = container;
+            longer.push_back(0);
+            accepted += SignatureView::Parse(longer.data(), longer.size()).has_value();
+
+            // Magic, version, unknown ids, declared sizes, reserved bytes, and
+            // a tree layout or chunk size without the other.
+            const std::vector<std::pair<size_t, unsigned char>> damage = {
+                { 0, 0x01 }, { 4, 0x02 }, { 6, 0x7F }, { 7, 0x7F }, { 8, 0xFF }, { 9, 0xFF },
+                { 10, 0x02 }, { 11, 0xFF }, { 12, 0x01 }, { 13, 0x01 }, { 15, 0x80 }, { 16, 0x01 }, { 23, 0x40 },
+            };
+            for (const auto& change : damage)
+            {
+                std::vector<unsigned char> damaged = container;
+                damaged[change.first] ^= change.second;
+                accepted += SignatureView::Parse(damaged.data(), damaged.size()).has_value();
+            }
+
+            std::vector<unsigned char> tampered = container;
+            tampered[SignatureView::HEADER_SIZE] ^= 1;
+            auto tamperedView = SignatureView::Parse(tampered.data(), tampered.size());
+            accepted += tamperedView && signer.Verify(hash, *tamperedView, publicKey);
+            if (accepted != 0)
+            {
+                std::printf("%s: принято %d испорченных контейнеров\n", name.c_str(), accepted);
+                ++failures;
+            }
+        }
+        std::printf("%s: контейнер проверен\n", name.c_str());
+        return failures;
+    }
+}
+
+int main()
+{
+    int failures = 0;
+    for (const GostParameters& parameters : GostSigner::DefaultParameterSets())
+    {
+        failures += CheckCurves(parameters);
+        failures += CheckSigner(parameters);
+        failures += CheckContainer(parameters);
+    }
+    return failures == 0 ? 0 : 1;
+}
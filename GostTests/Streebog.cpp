@@ -0,0 +1,133 @@
+// Checks Streebog-256 and Streebog-512 against the examples M1 and M2 of
+// GOST R 34.11-2012, hashed whole and fed in uneven pieces, and checks that
+// piecewise hashing matches whole-message hashing on every length around the
+// block boundaries. Prints one line per mismatch and exits with 1 if there
+// was any.
+
+#include "Hex.h"
+#include "Streebog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace gost;
+
+namespace
+{
+    struct KnownAnswer
+    {
+        const char* name;
+        // As the standard lists the message bytes, first byte first.
+        const wchar_t* message;
+        const wchar_t* streebog512;
+        const wchar_t* streebog256;
+    };
+
+    const KnownAnswer KNOWN_ANSWERS[] = {
+        // "012345678901234567890123456789012345678901234567890123456789012"
+        { "M1",
+            L"303132333435363738393031323334353637383930313233343536373839303132333435363738393031323334353637383930313233343536373839303132",
+            L"1b54d01a4af5b9d5cc3d86d68d285462b19abc2475222f35c085122be4ba1ffa00ad30f8767b3a82384c6574f024c311e2a481332b08ef7f41797891c1646f48",
+            L"9d151eefd8590b89daa6ba6cb74af9275dd051026bb149a452fd84e5e57b5500" },
+        // "Се ветри, Стрибожи внуци, веютъ с моря стрелами на храбрыя плъкы Игоревы" in CP1251
+        { "M2",
+            L"d1e520e2e5f2f0e82c20d1f2f0e8e1eee6e820e2edf3f6e82c20e2e5fef2fa20f120eceef0ff20f1f2f0e5ebe0ece820ede020f5f0e0e1f0fbff20efebfaeafb20c8e3eef0e5e2fb",
+            L"1e88e62226bfca6f9994f1f2d51569e0daf8475a3b0fe61a5300eee46d961376035fe83549ada2b8620fcd7c496ce5b33f0cb9dddc2b6460143b03dabac9fb28",
+            L"9dd2fe4e90409e5da87f53976d7405b0c0cac628fc669a741d50063c557e8f50" },
+    };
+
+    // Whole, and fed in uneven pieces so partial blocks are carried between
+    // Update calls. The same object is reused to check that Finish resets it.
+    std::vector<std::vector<unsigned char>> Digests(const std::vector<unsigned char>& message, size_t digestSize)
+    {
+        std::vector<std::vector<unsigned char>> digests(2, std::vector<unsigned char>(digestSize));
+        Streebog streebog(digestSize);
+        streebog.Update(message.data(), message.size());
+        streebog.Finish(digests[0].data());
+
+        size_t offset = 0;
+        for (size_t piece = 1; offset < message.size(); piece = piece * 3 + 1)
+        {
+            const size_t take = std::min(piece, message.size() - offset);
+            streebog.Update(message.data() + offset, take);
+            offset += take;
+        }
+        streebog.Finish(digests[1].data());
+        return digests;
+    }
+
+    int CheckKnownAnswers()
+    {
+        int failures = 0;
+        for (const KnownAnswer& answer : KNOWN_ANSWERS)
+        {
+            const std::vector<unsigned char> message = *ParseHex(answer.message);
+            for (const auto& expected : { std::make_pair(size_t{ 64 }, answer.streebog512), std::make_pair(size_t{ 32 }, answer.streebog256) })
+            {
+                for (const auto& digest : Digests(message, expected.first))
+                {
+                    if (digest != ParseHex(expected.second))
+                    {
+                        std::printf("Streebog-%zu: неверный хеш примера %s\n", expected.first * 8, answer.name);
+                        ++failures;
+                    }
+                }
+                if (Streebog::Hash(message.data(), message.size(), expected.first) != ParseHex(expected.second))
+                {
+                    std::printf("Streebog-%zu: Hash расходится с примером %s\n", expected.first * 8, answer.name);
+                    ++failures;
+                }
+            }
+        }
+        std::printf("Streebog: примеры M1 и M2 проверены\n");
+        return failures;
+    }
+
+    // Every length up to four blocks, then a few multi-block ones.
+    int CheckPieces()
+    {
+        std::vector<size_t> sizes;
+        for (size_t size = 0; size <= 4 * Streebog::BLOCK_SIZE; ++size)
+        {
+            sizes.push_back(size);
+        }
+        for (size_t size : { 1000, 4096 + 63, 65536 + 1 })
+        {
+            sizes.push_back(size);
+        }
+
+        int failures = 0;
+        uint32_t state = 0x9E3779B9;
+        for (size_t size : sizes)
+        {
+            std::vector<unsigned char> message(size);
+            for (auto& byte : message)
+            {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                byte = static_cast<unsigned char>(state);
+            }
+            for (size_t digestSize : { size_t{ 64 }, size_t{ 32 } })
+            {
+                const auto digests = Digests(message, digestSize);
+                if (digests[0] != digests[1])
+                {
+                    std::printf("Streebog-%zu: по частям не совпадает с целым на длине %zu\n", digestSize * 8, size);
+                    ++failures;
+                }
+            }
+        }
+        std::printf("Streebog: хеширование по частям проверено\n");
+        return failures;
+    }
+}
+
+int main()
+{
+    int failures = CheckKnownAnswers();
+    failures += CheckPieces();
+    return failures == 0 ? 0 : 1;
+}